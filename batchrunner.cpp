@@ -0,0 +1,581 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "batchrunner.h"
+#include "project.h"
+#include "hotfolder.h"
+#include <QDir>
+#include <QFileInfo>
+#include <QSocketNotifier>
+#include <QTimer>
+#ifdef Q_OS_UNIX
+#include <sys/socket.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+
+// Time between progress lines (ms)
+const int PROGRESS_INTERVAL = 500;
+
+#ifdef Q_OS_UNIX
+//! Sockets carrying termination signals from the handler to the event loop
+static int signalSocket[2] = {-1,-1};
+
+//-----------------------------------------------------------------------------
+/** @brief Handler for the termination signals
+
+Hardly anything may be done in a signal handler, so a byte is written to a
+socket and the signal is dealt with when the event loop sees it.
+*/
+
+static void terminationHandler(int)
+{
+    char signalByte = 1;
+    ssize_t written = ::write(signalSocket[0],&signalByte,sizeof(signalByte));
+    (void) written;
+}
+#endif
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The conversion engine is created and SIGTERM and SIGINT are caught, where the
+platform has them.
+*/
+
+BatchRunner::BatchRunner(QObject* parent) : QObject(parent),
+            signalNotifier_(NULL),out_(stdout),err_(stderr),
+            hotFolder_(NULL),signalCount_(0)
+{
+    conversionEngine_ = new ConversionEngine(this);
+    progressTimer_ = new QTimer(this);
+    progressTimer_->setInterval(PROGRESS_INTERVAL);
+    connect(progressTimer_,SIGNAL(timeout()),this,SLOT(printProgress()));
+    connect(conversionEngine_,
+            SIGNAL(outputFinished(const QString&,const QString&)),
+            this,SLOT(outputFinished(const QString&,const QString&)));
+    connect(conversionEngine_,SIGNAL(outputSkipped(const QString&)),
+            this,SLOT(outputSkipped(const QString&)));
+    connect(conversionEngine_,SIGNAL(outputCached(const QString&)),
+            this,SLOT(outputCached(const QString&)));
+    connect(conversionEngine_,SIGNAL(finished(const QString&)),
+            this,SLOT(conversionFinished(const QString&)));
+#ifdef Q_OS_UNIX
+    if (::socketpair(AF_UNIX,SOCK_STREAM,0,signalSocket) == 0)
+    {
+        signalNotifier_ = new QSocketNotifier(signalSocket[1],
+                                              QSocketNotifier::Read,this);
+        connect(signalNotifier_,SIGNAL(activated(int)),
+                this,SLOT(terminationRequested()));
+        struct sigaction action;
+        memset(&action,0,sizeof(action));
+        action.sa_handler = terminationHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGTERM,&action,NULL);
+        sigaction(SIGINT,&action,NULL);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+The default handling of the signals is restored.
+*/
+
+BatchRunner::~BatchRunner()
+{
+#ifdef Q_OS_UNIX
+    if (signalNotifier_ != NULL)
+    {
+        signal(SIGTERM,SIG_DFL);
+        signal(SIGINT,SIG_DFL);
+        delete signalNotifier_;
+        ::close(signalSocket[0]);
+        ::close(signalSocket[1]);
+    }
+#endif
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the number of conversion workers
+
+@param[in] workers Number of conversions allowed to run at the same time.
+*/
+
+void BatchRunner::setWorkerCount(int workers)
+{
+    conversionEngine_->setWorkerCount(workers);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the minimum length of the segments of a long file
+
+@param[in] seconds Minimum segment length, or zero to never split files.
+*/
+
+void BatchRunner::setSegmentLength(int seconds)
+{
+    conversionEngine_->setSegmentLength(seconds);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the number of sample frames encoded at a time
+
+@param[in] blockSize Sample frames per block, or zero for the default.
+*/
+
+void BatchRunner::setBlockSize(int blockSize)
+{
+    conversionEngine_->setBlockSize(blockSize);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set when the output files are forced out to the disk
+
+@param[in] policy "never", "file" or a number of MB.
+@returns false if the policy is not recognised.
+*/
+
+bool BatchRunner::setFsyncPolicy(const QString& policy)
+{
+    return conversionEngine_->setFsyncPolicy(policy);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set whether outputs that are up to date are skipped
+
+@param[in] isIncremental skip outputs that are up to date.
+*/
+
+void BatchRunner::setIncremental(bool isIncremental)
+{
+    conversionEngine_->setIncremental(isIncremental);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set whether the content of the input files is checked for changes
+
+@param[in] useContentHash hash the content as well as the size and time.
+*/
+
+void BatchRunner::setContentHash(bool useContentHash)
+{
+    conversionEngine_->setContentHash(useContentHash);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the cache of encoded files shared across projects
+
+@param[in] directory Directory holding the cache, or empty for no cache.
+@param[in] sizeMegabytes Limit on the size of the cache in MB.
+*/
+
+void BatchRunner::setCache(const QString& directory, int sizeMegabytes)
+{
+    conversionEngine_->setCache(directory,sizeMegabytes);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the journal of the batch
+
+@param[in] fileName Journal file.
+*/
+
+void BatchRunner::setJournal(const QString& fileName)
+{
+    conversionEngine_->setJournal(fileName);
+}
+//-----------------------------------------------------------------------------
+/** @brief Save a timeline of the batch
+
+@param[in] fileName Chrome trace event JSON file.
+*/
+
+void BatchRunner::setTrace(const QString& fileName)
+{
+    conversionEngine_->setTrace(fileName);
+}
+//-----------------------------------------------------------------------------
+/** @brief Start the batch
+
+The project is loaded and the LAME options of each column compiled. Unlike the
+main form, which skips a column in error, nothing is converted if any column
+has bad options or a missing output directory, or if an input file is missing,
+so that a mistake in a batch set up is found before any time is spent on it.
+@param[in] projectFile kLAME project giving the column settings.
+@param[in] inputs WAV files to be converted.
+@returns BATCH_OK if the batch has been started, otherwise the exit status.
+*/
+
+BatchStatus BatchRunner::start(const QString& projectFile,
+                               const QStringList& inputs)
+{
+    BatchStatus status = loadColumns(projectFile);
+    if (status != BATCH_OK) return status;
+    for (int input = 0; input < inputs.size(); input++)
+    {
+        if (! QFileInfo(inputs[input]).isFile())
+        {
+            err_ << inputs[input] << ": Input file not found.\n";
+            return BATCH_USAGE_ERROR;
+        }
+    }
+    out_ << "start\t" << inputs.size() << "\t"
+         << inputs.size()*columnSettings_.size() << "\n";
+    out_.flush();
+    for (int input = 0; input < inputs.size(); input++)
+        addInput(inputs[input]);
+    startBatch();
+    return BATCH_OK;
+}
+//-----------------------------------------------------------------------------
+/** @brief Watch directories and convert the WAV files as they arrive
+
+The project is loaded as for start(). The files already in the directories and
+those written to them later are converted once they are complete. A file that
+is ready while a batch runs joins it, and one that is written again while the
+batch still holds it waits for the next batch. A batch is only run when there
+are files to convert, and watching goes on until a termination signal.
+@param[in] projectFile kLAME project giving the column settings.
+@param[in] directories Directories to be watched.
+@returns BATCH_OK if watching has started, otherwise the exit status.
+*/
+
+BatchStatus BatchRunner::watch(const QString& projectFile,
+                               const QStringList& directories)
+{
+    BatchStatus status = loadColumns(projectFile);
+    if (status != BATCH_OK) return status;
+    hotFolder_ = new HotFolder(this);
+    for (int n = 0; n < directories.size(); n++)
+    {
+        if (! hotFolder_->addDirectory(directories[n]))
+        {
+            err_ << directories[n] << ": Directory not found.\n";
+            return BATCH_USAGE_ERROR;
+        }
+    }
+    connect(hotFolder_,SIGNAL(fileReady(const QString&)),
+            this,SLOT(inputReady(const QString&)));
+    connect(hotFolder_,SIGNAL(directoryLost(const QString&)),
+            this,SLOT(directoryLost(const QString&)));
+    connect(hotFolder_,SIGNAL(directoryRestored(const QString&)),
+            this,SLOT(directoryRestored(const QString&)));
+    QStringList watched = hotFolder_->directories();
+    for (int n = 0; n < watched.size(); n++)
+        out_ << "watching\t" << watched[n] << "\n";
+    out_.flush();
+    hotFolder_->start();
+    return BATCH_OK;
+}
+//-----------------------------------------------------------------------------
+/** @brief Load the project and compile the settings of its columns
+
+@param[in] projectFile kLAME project giving the column settings.
+@returns BATCH_OK, or the exit status if the project cannot be used.
+*/
+
+BatchStatus BatchRunner::loadColumns(const QString& projectFile)
+{
+    Project project;
+    QString returnCode = loadProject(projectFile,project);
+    if (returnCode != "OK")
+    {
+        err_ << projectFile << ": " << returnCode << "\n";
+        return BATCH_PROJECT_ERROR;
+    }
+    int numberColumns = conversionColumns(project);
+    if (numberColumns == 0)
+    {
+        err_ << projectFile << ": The project has no columns.\n";
+        return BATCH_PROJECT_ERROR;
+    }
+    for (int column = 0; column < numberColumns; column++)
+    {
+        LameSettingsPointer settings(
+                    new LameSettings(project.lameOptionsList[column]));
+        if (! settings->isValid())
+        {
+            err_ << "Column " << column+1 << ": Invalid LAME option "
+                 << settings->returnCode() << "\n";
+            return BATCH_PROJECT_ERROR;
+        }
+        QDir outputDirectory(project.outputDirectoryList[column]);
+        if (! outputDirectory.exists())
+        {
+            err_ << "Column " << column+1 << ": Output directory "
+                 << project.outputDirectoryList[column] << " not found.\n";
+            return BATCH_PROJECT_ERROR;
+        }
+        columnSettings_.append(settings);
+        outputDirectories_.append(outputDirectory);
+        filenameTags_.append(project.filenameTagList[column]);
+    }
+    return BATCH_OK;
+}
+//-----------------------------------------------------------------------------
+/** @brief Add the conversions of an input file for every column
+
+@param[in] inputFile WAV file to be converted.
+*/
+
+void BatchRunner::addInput(const QString& inputFile)
+{
+    QList<ConversionOutput> outputs;
+    for (int column = 0; column < columnSettings_.size(); column++)
+    {
+        ConversionOutput output;
+        output.settings = columnSettings_[column];
+        output.outputFile = outputDirectories_[column].filePath(
+                mp3FileName(inputFile,filenameTags_[column]));
+        outputs.append(output);
+    }
+    conversionEngine_->addConversion(inputFile,outputs);
+}
+//-----------------------------------------------------------------------------
+/** @brief Start the conversions added, with the progress lines
+*/
+
+void BatchRunner::startBatch()
+{
+    conversionEngine_->start();
+    progressMeter_.start();
+    progressTimer_->start();
+}
+//-----------------------------------------------------------------------------
+/** @brief Convert a file in a watched directory that is ready
+
+The file joins the running batch, or starts a batch if there is none. A file
+that the running batch already converts waits until it has finished, as the
+two would write the same outputs.
+@param[in] inputFile WAV file that is complete.
+*/
+
+void BatchRunner::inputReady(const QString& inputFile)
+{
+    if (signalCount_ > 0) return;
+    if (! conversionEngine_->isRunning())
+    {
+        if (! waitingInputs_.contains(inputFile))
+            waitingInputs_.append(inputFile);
+        startWaitingInputs();
+    }
+    else if (batchInputs_.contains(inputFile))
+    {
+        if (! waitingInputs_.contains(inputFile))
+            waitingInputs_.append(inputFile);
+    }
+    else queueInput(inputFile);
+}
+//-----------------------------------------------------------------------------
+/** @brief Report a watched directory that has been removed or moved away
+
+Its files that are waiting for the next batch are dropped, as they have gone
+with it. Watching goes on, and the directory is watched again once it is back.
+@param[in] directory Absolute path of the directory.
+*/
+
+void BatchRunner::directoryLost(const QString& directory)
+{
+    QStringList::iterator input = waitingInputs_.begin();
+    while (input != waitingInputs_.end())
+    {
+        if (QFileInfo(*input).absolutePath() == directory)
+            input = waitingInputs_.erase(input);
+        else ++input;
+    }
+    out_ << "lost\t" << directory << "\n";
+    out_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief Report a watched directory that is back after being lost
+*/
+
+void BatchRunner::directoryRestored(const QString& directory)
+{
+    out_ << "restored\t" << directory << "\n";
+    out_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief Start a batch with the files from the watched directories that are
+waiting, if there are any
+*/
+
+void BatchRunner::startWaitingInputs()
+{
+    if (waitingInputs_.isEmpty()) return;
+    out_ << "start\t" << waitingInputs_.size() << "\t"
+         << waitingInputs_.size()*columnSettings_.size() << "\n";
+    for (int n = 0; n < waitingInputs_.size(); n++)
+        queueInput(waitingInputs_[n]);
+    waitingInputs_.clear();
+    startBatch();
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a file from a watched directory to the batch
+
+@param[in] inputFile WAV file that is complete.
+*/
+
+void BatchRunner::queueInput(const QString& inputFile)
+{
+    out_ << "queued\t" << inputFile << "\n";
+    out_.flush();
+    batchInputs_.insert(inputFile);
+    addInput(inputFile);
+}
+//-----------------------------------------------------------------------------
+/** @brief Resume the journalled batch
+
+The outputs that were not completed are converted with the options recorded in
+the journal.
+@returns BATCH_OK if the batch has been started, otherwise the exit status.
+*/
+
+BatchStatus BatchRunner::resume()
+{
+    int numberInputs,numberOutputs;
+    QString returnCode = conversionEngine_->resume(numberInputs,numberOutputs);
+    if (returnCode != "OK")
+    {
+        err_ << returnCode << "\n";
+        return BATCH_PROJECT_ERROR;
+    }
+    out_ << "start\t" << numberInputs << "\t" << numberOutputs << "\n";
+    out_.flush();
+    startBatch();
+    return BATCH_OK;
+}
+//-----------------------------------------------------------------------------
+/** @brief Print a progress line
+
+The progress is sampled from the engine, so the jobs spend nothing on it.
+*/
+
+void BatchRunner::printProgress()
+{
+    ConversionProgress progress = conversionEngine_->progress();
+    progressMeter_.sample(progress);
+    double remaining = progressMeter_.remainingSeconds();
+    out_ << "progress\t" << progress.bytesDone << "\t" << progress.bytesTotal
+         << "\t" << (qint64)progressMeter_.rate() << "\t"
+         << ((remaining < 0) ? -1 : (qint64)(remaining + 0.5)) << "\n";
+    out_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief Report an output file that has been written
+
+@param[in] fileName output file.
+@param[in] returnCode "OK" or the error in writing the file.
+*/
+
+void BatchRunner::outputFinished(const QString& fileName,
+                                 const QString& returnCode)
+{
+    out_ << "output\t" << fileName << "\t" << returnCode << "\n";
+    out_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief Report an output file that is up to date
+
+@param[in] fileName output file.
+*/
+
+void BatchRunner::outputSkipped(const QString& fileName)
+{
+    out_ << "uptodate\t" << fileName << "\n";
+    out_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief Report an output file placed from the cache
+
+@param[in] fileName output file.
+*/
+
+void BatchRunner::outputCached(const QString& fileName)
+{
+    out_ << "cached\t" << fileName << "\n";
+    out_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief Report the end of the batch and give the exit status
+
+When watching, the next batch is started with the files that are waiting, and
+the exit status is only given once watching is stopped.
+@param[in] returnCode "OK" or the first error of the batch.
+*/
+
+void BatchRunner::conversionFinished(const QString& returnCode)
+{
+    progressTimer_->stop();
+    printProgress();
+    BatchStatus status = BATCH_OK;
+    if (signalCount_ > 0) status = BATCH_INTERRUPTED;
+    else if (returnCode != "OK") status = BATCH_FAILED;
+    if (conversionEngine_->cancelLatency() >= 0)
+        out_ << "cancelled\t"
+             << QString::number(conversionEngine_->cancelLatency(),'f',3)
+             << "\n";
+    if (conversionEngine_->hasCache())
+    {
+        EncodeCacheStatistics cache = conversionEngine_->cacheStatistics();
+        out_ << "cache\t" << cache.hits << "\t" << cache.misses << "\t"
+             << cache.stored << "\t" << cache.evicted << "\t" << cache.size
+             << "\n";
+    }
+    out_ << "finished\t" << status << "\t" << returnCode << "\n";
+    out_.flush();
+    batchInputs_.clear();
+    if ((hotFolder_ != NULL) && (signalCount_ == 0))
+    {
+        startWaitingInputs();
+        return;
+    }
+    emit finished(status);
+}
+//-----------------------------------------------------------------------------
+/** @brief Deal with a termination signal from the event loop
+
+The first signal lets the running jobs finish and drops the rest. A second one
+cancels the running jobs too. When watching, the first signal also stops the
+watching, and ends at once if no batch is running.
+*/
+
+void BatchRunner::terminationRequested()
+{
+#ifdef Q_OS_UNIX
+    char signalByte;
+    ssize_t bytesRead = ::read(signalSocket[1],&signalByte,sizeof(signalByte));
+    (void) bytesRead;
+#endif
+    signalCount_++;
+    out_ << "interrupted\n";
+    out_.flush();
+    if ((hotFolder_ != NULL) && (! conversionEngine_->isRunning()))
+    {
+        out_ << "finished\t" << BATCH_INTERRUPTED << "\tOK\n";
+        out_.flush();
+        emit finished(BATCH_INTERRUPTED);
+    }
+    else if (signalCount_ == 1) conversionEngine_->drain();
+    else conversionEngine_->cancel();
+}
@@ -0,0 +1,146 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QTextStream>
+#include <QList>
+#include <QSet>
+#include <QDir>
+#include "conversionengine.h"
+#include "progress.h"
+
+class QSocketNotifier;
+class QTimer;
+class HotFolder;
+
+//! Exit status of the batch mode
+enum BatchStatus
+{
+    BATCH_OK = 0,                     //!< All conversions done.
+    BATCH_FAILED = 1,                 //!< A conversion failed.
+    BATCH_USAGE_ERROR = 2,            //!< Bad command line.
+    BATCH_PROJECT_ERROR = 3,          //!< Project unreadable or options bad.
+    BATCH_INTERRUPTED = 4             //!< Stopped by SIGTERM or SIGINT.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Headless batch conversion
+
+This runs the conversions of a list of WAV files with the column settings of a
+project, using the same conversion engine as the main form but with no GUI, so
+that kLAME can be run without a display. Every input file is converted for
+every column of the project. In place of a list of files, directories can be
+watched and the WAV files converted as they are written to them.
+
+Progress is written to the standard output as lines of tab separated fields,
+for a controlling program to read:
+- watching, directory watched for WAV files.
+- lost, watched directory that has been removed or moved away. Its files that
+are waiting are dropped and it is watched again once it is back.
+- restored, watched directory that is back after being lost.
+- start, number of input files, number of outputs.
+- queued, input file from a watched directory added to the batch.
+- progress, bytes of WAV data encoded, bytes to be encoded, bytes per second,
+seconds remaining or -1 before anything has been encoded. Every output counts
+its input's bytes once. The progress is sampled from the engine now and then.
+- output, output file, "OK" or the error in converting it.
+- uptodate, output file that is up to date and is not converted again.
+- cached, output file placed from the cache of encoded files.
+- cache, hits, misses, files stored, files evicted, bytes held, when a cache
+is used.
+- interrupted, when a termination signal is caught.
+- cancelled, milliseconds from the cancel until the last running job stopped,
+when the running jobs were cancelled.
+- finished, exit status, "OK" or the first error of the batch. When watching
+this ends each batch, and watching goes on.
+
+Errors in setting up the batch are written to the standard error. On SIGTERM or
+SIGINT no more jobs are started and those running are left to finish, after
+which the batch ends with BATCH_INTERRUPTED. A second signal cancels the
+running jobs as well. When watching, the first signal also stops the watching,
+and the exit status is always BATCH_INTERRUPTED. The batch is journalled, so
+that one that was interrupted or failed can be resumed with only its unfinished
+outputs.
+*/
+
+class BatchRunner : public QObject
+{
+    Q_OBJECT
+public:
+    BatchRunner(QObject* parent = 0);
+    ~BatchRunner();
+    void setWorkerCount(int workers);
+    void setSegmentLength(int seconds);
+    void setBlockSize(int blockSize);
+    bool setFsyncPolicy(const QString& policy);
+    void setIncremental(bool isIncremental);
+    void setContentHash(bool useContentHash);
+    void setCache(const QString& directory, int sizeMegabytes);
+    void setJournal(const QString& fileName);
+    void setTrace(const QString& fileName);
+    BatchStatus start(const QString& projectFile, const QStringList& inputs);
+    BatchStatus resume();
+    BatchStatus watch(const QString& projectFile,
+                      const QStringList& directories);
+signals:
+    void finished(int status);
+private slots:
+    void printProgress();
+    void outputFinished(const QString& fileName, const QString& returnCode);
+    void outputSkipped(const QString& fileName);
+    void outputCached(const QString& fileName);
+    void conversionFinished(const QString& returnCode);
+    void terminationRequested();
+    void inputReady(const QString& inputFile);
+    void directoryLost(const QString& directory);
+    void directoryRestored(const QString& directory);
+private:
+    BatchStatus loadColumns(const QString& projectFile);
+    void addInput(const QString& inputFile);
+    void startBatch();
+    void startWaitingInputs();
+    void queueInput(const QString& inputFile);
+    ConversionEngine* conversionEngine_; //!< Runs the conversion batch.
+    QSocketNotifier* signalNotifier_;   //!< Wakes on a termination signal.
+    QTextStream out_;                   //!< Machine readable progress.
+    QTextStream err_;                   //!< Errors in setting up.
+    QTimer* progressTimer_;             //!< Prints the progress now and then.
+    ProgressMeter progressMeter_;       //!< Throughput and time remaining.
+    QList<LameSettingsPointer> columnSettings_; //!< Settings of each column.
+    QList<QDir> outputDirectories_;     //!< Output directory of each column.
+    QStringList filenameTags_;          //!< File name tag of each column.
+    HotFolder* hotFolder_;              //!< Watched directories, or null.
+    QSet<QString> batchInputs_;         //!< Watched inputs in the batch.
+    QStringList waitingInputs_;         //!< Watched inputs for the next batch.
+    int signalCount_;                   //!< Termination signals caught.
+};
+
+#endif
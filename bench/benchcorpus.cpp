@@ -0,0 +1,205 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - benchmark corpus
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+/** @brief Synthetic WAV corpus
+
+The corpus holds a file of each channel count and sample size for each of a
+list of lengths, from short clips to files hours long. The content depends
+only on the format and length, so a corpus that is kept in a directory can be
+used again by later runs, and results can be compared between builds.
+*/
+
+#include "benchcorpus.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QtEndian>
+#include <math.h>
+#include <string.h>
+
+// Size of the WAV header written
+const int WAV_HEADER_SIZE = 44;
+
+//-----------------------------------------------------------------------------
+/** @brief Size of a corpus file in bytes
+*/
+
+qint64 CorpusFile::bytes() const
+{
+    return WAV_HEADER_SIZE +
+           (qint64)seconds*CORPUS_SAMPLE_RATE*numberChannels*bitsPerSample/8;
+}
+//-----------------------------------------------------------------------------
+/** @brief Write a synthetic WAV file
+
+The signal is a tone in each channel with a little noise so that the encoder
+has something to work on in every band. The noise comes from a fixed sequence,
+so the same file is written every time.
+@param[in] fileName File to be written.
+@param[in] seconds Length of the file.
+@param[in] sampleRate Samples per second.
+@param[in] numberChannels Number of channels (1,2).
+@param[in] bitsPerSample Bits per sample (8,16,24).
+@returns true if the file was written.
+*/
+
+bool writeTestWav(const QString& fileName, uint seconds, uint sampleRate,
+                  uint numberChannels, uint bitsPerSample)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly)) return false;
+    uint bytesPerSample = bitsPerSample/8;
+    uint bytesPerFrame = numberChannels*bytesPerSample;
+    quint32 frames = seconds*sampleRate;
+    uchar header[WAV_HEADER_SIZE];
+    memcpy(header,"RIFF",4);
+    qToLittleEndian<quint32>(36+bytesPerFrame*frames,header+4);
+    memcpy(header+8,"WAVEfmt ",8);
+    qToLittleEndian<quint32>(16,header+16);
+    qToLittleEndian<quint16>(1,header+20);              // PCM
+    qToLittleEndian<quint16>(numberChannels,header+22);
+    qToLittleEndian<quint32>(sampleRate,header+24);
+    qToLittleEndian<quint32>(bytesPerFrame*sampleRate,header+28);
+    qToLittleEndian<quint16>(bytesPerFrame,header+32);
+    qToLittleEndian<quint16>(bitsPerSample,header+34);
+    memcpy(header+36,"data",4);
+    qToLittleEndian<quint32>(bytesPerFrame*frames,header+40);
+    file.write((const char*) header,sizeof(header));
+    QByteArray block(bytesPerFrame*sampleRate,0);
+    uchar* samples = (uchar*) block.data();
+    quint32 noise = 1;
+    for (quint32 frame = 0; frame < frames; frame++)
+    {
+        noise = noise*1664525 + 1013904223;
+        double t = (double)frame/sampleRate;
+        double level[2];                    // On the 16 bit scale
+        level[0] = 8000*sin(2*M_PI*440*t) + (short)(noise >> 16)/32;
+        level[1] = 8000*sin(2*M_PI*660*t) - (short)(noise >> 16)/32;
+        uint n = frame % sampleRate;
+        uchar* sample = samples + bytesPerFrame*n;
+        for (uint channel = 0; channel < numberChannels; channel++)
+        {
+            if (bitsPerSample == 8)
+                sample[0] = (uchar) (128 + (int)(level[channel]/256));
+            else if (bitsPerSample == 16)
+                qToLittleEndian<qint16>((short)level[channel],sample);
+            else
+            {
+                qint32 value = (qint32)(level[channel]*256);
+                sample[0] = value & 0xFF;
+                sample[1] = (value >> 8) & 0xFF;
+                sample[2] = (value >> 16) & 0xFF;
+            }
+            sample += bytesPerSample;
+        }
+        if ((n == sampleRate-1) || (frame == frames-1))
+            file.write(block.constData(),bytesPerFrame*(n+1));
+    }
+    return file.error() == QFile::NoError;
+}
+//-----------------------------------------------------------------------------
+/** @brief Make the corpus in a directory
+
+A file that is already there with the right size is taken to be from an
+earlier run and is not written again.
+@param[in] directory Directory to hold the corpus.
+@param[in] lengths Lengths of the files in seconds.
+@param[out] corpus The files of the corpus.
+@returns true if all files are in place.
+*/
+
+bool makeCorpus(const QString& directory, const QList<uint>& lengths,
+                QList<CorpusFile>& corpus)
+{
+    corpus.clear();
+    QDir corpusDirectory(directory);
+    if (! corpusDirectory.mkpath(".")) return false;
+    const uint bitsList[3] = {8,16,24};
+    for (int length = 0; length < lengths.size(); length++)
+        for (uint numberChannels = 1; numberChannels <= 2; numberChannels++)
+            for (int bits = 0; bits < 3; bits++)
+            {
+                CorpusFile file;
+                file.numberChannels = numberChannels;
+                file.bitsPerSample = bitsList[bits];
+                file.seconds = lengths[length];
+                file.name = QString("%1%2_%3s")
+                        .arg(numberChannels == 1 ? "m" : "s")
+                        .arg(file.bitsPerSample).arg(file.seconds);
+                file.fileName = corpusDirectory.filePath(file.name + ".wav");
+                QFileInfo fileInfo(file.fileName);
+                if ((! fileInfo.isFile()) || (fileInfo.size() != file.bytes()))
+                {
+                    if (! writeTestWav(file.fileName,file.seconds,
+                                       CORPUS_SAMPLE_RATE,numberChannels,
+                                       file.bitsPerSample))
+                        return false;
+                }
+                corpus.append(file);
+            }
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Make a set of 16 bit stereo files of one length in a directory
+
+The files all hold the same signal, but are separate files so that a batch of
+them is read from the disk as a batch of real files would be. As for the
+corpus, files already there with the right size are not written again.
+@param[in] directory Directory to hold the files.
+@param[in] prefix Start of the names of the files.
+@param[in] numberFiles Number of files in the set.
+@param[in] seconds Length of each file.
+@param[out] files The files of the set.
+@returns true if all files are in place.
+*/
+
+bool makeFileSet(const QString& directory, const QString& prefix,
+                 int numberFiles, uint seconds, QList<CorpusFile>& files)
+{
+    files.clear();
+    QDir setDirectory(directory);
+    if (! setDirectory.mkpath(".")) return false;
+    for (int n = 0; n < numberFiles; n++)
+    {
+        CorpusFile file;
+        file.numberChannels = 2;
+        file.bitsPerSample = 16;
+        file.seconds = seconds;
+        file.name = QString("%1_%2_%3s").arg(prefix)
+                        .arg(n,3,10,QChar('0')).arg(seconds);
+        file.fileName = setDirectory.filePath(file.name + ".wav");
+        QFileInfo fileInfo(file.fileName);
+        if ((! fileInfo.isFile()) || (fileInfo.size() != file.bytes()))
+        {
+            if (! writeTestWav(file.fileName,seconds,CORPUS_SAMPLE_RATE))
+                return false;
+        }
+        files.append(file);
+    }
+    return true;
+}
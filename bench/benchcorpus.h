@@ -0,0 +1,55 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - benchmark corpus
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef BENCHCORPUS_H
+#define BENCHCORPUS_H
+
+#include <QString>
+#include <QList>
+
+// Sample rate of all files in the corpus
+const uint CORPUS_SAMPLE_RATE = 44100;
+
+//! One synthetic WAV file of the benchmark corpus
+struct CorpusFile
+{
+    QString fileName;                 //!< Path of the file.
+    QString name;                     //!< Short name for the results.
+    uint numberChannels;              //!< Number of channels (1,2).
+    uint bitsPerSample;               //!< Bits per sample (8,16,24).
+    uint seconds;                     //!< Length of the file.
+    qint64 bytes() const;
+};
+
+bool writeTestWav(const QString& fileName, uint seconds, uint sampleRate,
+                  uint numberChannels = 2, uint bitsPerSample = 16);
+bool makeCorpus(const QString& directory, const QList<uint>& lengths,
+                QList<CorpusFile>& corpus);
+bool makeFileSet(const QString& directory, const QString& prefix,
+                 int numberFiles, uint seconds, QList<CorpusFile>& files);
+
+#endif
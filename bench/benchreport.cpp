@@ -0,0 +1,98 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - benchmark report
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#include "benchreport.h"
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+@param[in] columns Names of the columns.
+*/
+
+BenchTable::BenchTable(const QStringList& columns) : columns_(columns)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a row of results
+
+@param[in] row One value for each column. Reals are printed to four places.
+*/
+
+void BenchTable::addRow(const QVariantList& row)
+{
+    rows_.append(row);
+}
+//-----------------------------------------------------------------------------
+/** @brief Print the table
+
+@param[in] out Stream to print to.
+@param[in] isJson print a JSON array of objects rather than CSV.
+*/
+
+void BenchTable::print(QTextStream& out, bool isJson) const
+{
+    if (isJson)
+    {
+        QJsonArray array;
+        for (int row = 0; row < rows_.size(); row++)
+        {
+            QJsonObject object;
+            for (int column = 0; column < columns_.size(); column++)
+            {
+                QVariant value = rows_[row].value(column);
+                if (value.type() == QVariant::String)
+                    object.insert(columns_[column],value.toString());
+                else object.insert(columns_[column],
+                                   formatValue(value).toDouble());
+            }
+            array.append(object);
+        }
+        out << QJsonDocument(array).toJson();
+        return;
+    }
+    out << columns_.join(",") << "\n";
+    for (int row = 0; row < rows_.size(); row++)
+    {
+        QStringList fields;
+        for (int column = 0; column < columns_.size(); column++)
+            fields.append(formatValue(rows_[row].value(column)));
+        out << fields.join(",") << "\n";
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Text of a value
+*/
+
+QString BenchTable::formatValue(const QVariant& value) const
+{
+    if (value.type() == QVariant::Double)
+        return QString::number(value.toDouble(),'f',4);
+    return value.toString();
+}
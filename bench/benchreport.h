@@ -0,0 +1,58 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - benchmark report
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef BENCHREPORT_H
+#define BENCHREPORT_H
+
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QVariant>
+#include <QTextStream>
+
+//-----------------------------------------------------------------------------
+/** @brief Table of benchmark results
+
+The results of a suite are gathered into rows of named columns and printed at
+the end as CSV or as JSON, so that runs on different builds can be compared
+with a diff or loaded into a spreadsheet or script. Numbers are printed in a
+fixed format so that equal results compare equal as text.
+*/
+
+class BenchTable
+{
+public:
+    BenchTable(const QStringList& columns);
+    void addRow(const QVariantList& row);
+    void print(QTextStream& out, bool isJson) const;
+private:
+    QString formatValue(const QVariant& value) const;
+    QStringList columns_;               //!< Names of the columns.
+    QList<QVariantList> rows_;          //!< Values of each row.
+};
+
+#endif
@@ -0,0 +1,379 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion benchmark
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+/** @brief Conversion benchmarks
+
+Seven suites are provided, chosen with --suite:
+- blocksize, the default, converts a synthetic 16 bit stereo WAV file by a
+  Converter job, run directly on this thread, once for each block size. The
+  best time of a few repeats is taken for each size. The overhead per block is
+  estimated by comparing each time with that of the largest block size, which
+  is taken as having no overhead, and dividing the difference by the number of
+  blocks. The default block size should be chosen where the curve has flattened
+  out, while the block buffers still sit comfortably in the processor caches.
+- stages times each stage of a conversion on its own over a corpus of
+  synthetic files of each channel count and sample size, from short clips to
+  long files.
+- options times compiling and applying sets of LAME options.
+- scaling runs the conversion engine over many short files and a few long
+  ones, with each number of columns and workers given, and gives the
+  throughput, CPU efficiency and peak memory of each run.
+- cancel queues batches of many cells of one short file, with each number of
+  workers given, and times how long each takes to stop when it is cancelled.
+- split converts a file of --seconds as a single job and split into segments of
+  a quarter of its length, with each set of LAME options given, and checks that
+  the two outputs have the same duration. It exits with an error if they do
+  not.
+- parity compares the output of every SIMD kernel set available with that of
+  the scalar kernels, and exits with an error on any difference.
+
+The corpus is written to a temporary directory unless a directory is given, in
+which case it is kept and used again by later runs. The results are printed as
+CSV or JSON on the standard output.
+*/
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTemporaryDir>
+#include <QElapsedTimer>
+#include <QStringList>
+#include <QTextStream>
+#include "converter.h"
+#include "benchcorpus.h"
+#include "benchreport.h"
+#include "stagebench.h"
+#include "scalingbench.h"
+#include "splitbench.h"
+#include "paritybench.h"
+
+static double timeConversion(const QString& inputFile,
+                             const QString& outputFile,
+                             const QString& lameOptions, uint blockSize,
+                             int repeats, QString& returnCode);
+
+int main(int argc,char ** argv)
+{
+    QCoreApplication a(argc,argv);
+    QCommandLineParser parser;
+    parser.setApplicationDescription("kLAME conversion benchmarks");
+    parser.addHelpOption();
+    QCommandLineOption suiteOption("suite",
+            "Benchmark to run: blocksize, stages, options, scaling, cancel, "
+            "split or parity (default blocksize).","suite","blocksize");
+    parser.addOption(suiteOption);
+    QCommandLineOption formatOption("format",
+            "Format of the results: csv or json (default csv).","format","csv");
+    parser.addOption(formatOption);
+    QCommandLineOption secondsOption("seconds",
+            "Length of the block size test file (default 60).","seconds","60");
+    parser.addOption(secondsOption);
+    QCommandLineOption repeatOption("repeat",
+            "Number of runs of each, the best is kept (default 3).",
+            "N","3");
+    parser.addOption(repeatOption);
+    QCommandLineOption optionsOption("lame-options",
+            "LAME options for the conversion (default \"-b 128\").",
+            "options","-b 128");
+    parser.addOption(optionsOption);
+    QCommandLineOption sizesOption("sizes",
+            "Comma separated list of block sizes in frames.","frames",
+            "256,576,1152,2304,4608,9216,16384,32768,65536,131072,262144");
+    parser.addOption(sizesOption);
+    QCommandLineOption corpusOption("corpus",
+            "Directory to keep the corpus in (default a temporary one).",
+            "directory");
+    parser.addOption(corpusOption);
+    QCommandLineOption clipOption("clip-seconds",
+            "Length of the short corpus files (default 10).","seconds","10");
+    parser.addOption(clipOption);
+    QCommandLineOption longOption("long-seconds",
+            "Length of the long corpus files, 0 for none (default 600).",
+            "seconds","600");
+    parser.addOption(longOption);
+    QCommandLineOption iterationsOption("iterations",
+            "Calls timed in each micro-benchmark (default 1000).","N","1000");
+    parser.addOption(iterationsOption);
+    QCommandLineOption writeOption("write-mb",
+            "Data written by the write stage in MB (default 256).","MB","256");
+    parser.addOption(writeOption);
+    QCommandLineOption scalingSecondsOption("scaling-seconds",
+            "Audio in each file set of the scaling suite (default 640).",
+            "seconds","640");
+    parser.addOption(scalingSecondsOption);
+    QCommandLineOption smallFilesOption("small-files",
+            "Files in the set of short files (default 64).","N","64");
+    parser.addOption(smallFilesOption);
+    QCommandLineOption largeFilesOption("large-files",
+            "Files in the set of long files (default 2).","N","2");
+    parser.addOption(largeFilesOption);
+    QCommandLineOption columnsOption("columns",
+            "Comma separated list of column counts (default 1,8).","N","1,8");
+    parser.addOption(columnsOption);
+    QCommandLineOption workersOption("workers",
+            "Comma separated list of worker counts.","N",
+            "1,2,4,8,16,32,64");
+    parser.addOption(workersOption);
+    QCommandLineOption cellsOption("cells",
+            "Comma separated list of cell counts of the cancel suite "
+            "(default 100,1000,10000).","N","100,1000,10000");
+    parser.addOption(cellsOption);
+    QCommandLineOption cancelAfterOption("cancel-after",
+            "Time a batch runs before it is cancelled (default 200).",
+            "ms","200");
+    parser.addOption(cancelAfterOption);
+    QCommandLineOption splitOptionsOption("split-options",
+            "Sets of LAME options of the split suite, separated by '|' "
+            "(default \"-b 128|-V 2|--abr 128\").","options",
+            "-b 128|-V 2|--abr 128");
+    parser.addOption(splitOptionsOption);
+// Used by the scaling suite to run each batch in a child process
+    QCommandLineOption pointOption("scaling-point",
+            "Run one batch of the scaling suite.","columns,workers");
+    pointOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(pointOption);
+    QCommandLineOption outputOption("output",
+            "Directory for the outputs of the batch.","directory");
+    outputOption.setFlags(QCommandLineOption::HiddenFromHelp);
+    parser.addOption(outputOption);
+    parser.process(a);
+
+    QString suite = parser.value(suiteOption);
+    bool isJson = (parser.value(formatOption) == "json");
+    uint seconds = parser.value(secondsOption).toUInt();
+    int repeats = qMax(1,parser.value(repeatOption).toInt());
+    QString lameOptions = parser.value(optionsOption);
+    QList<uint> blockSizes;
+    QStringList sizeList = parser.value(sizesOption).split(",");
+    for (int n = 0; n < sizeList.size(); n++)
+        blockSizes.append(validBlockSize(sizeList[n].toInt()));
+    QTextStream out(stdout);
+    QTextStream err(stderr);
+    if (parser.isSet(pointOption))
+    {
+        QStringList point = parser.value(pointOption).split(",");
+        return runScalingPoint(parser.value(corpusOption),
+                               parser.value(outputOption),lameOptions,
+                               qMax(1,point.value(0).toInt()),
+                               qMax(1,point.value(1).toInt()));
+    }
+    if ((suite != "blocksize") && (suite != "stages") &&
+        (suite != "options") && (suite != "scaling") && (suite != "cancel") &&
+        (suite != "split") && (suite != "parity"))
+    {
+        err << "Unknown suite " << suite << "\n";
+        return 1;
+    }
+
+    if (suite == "parity")
+    {
+        BenchTable table(parityBenchColumns());
+        int mismatches = runParityBench(table);
+        table.print(out,isJson);
+        if (mismatches > 0)
+        {
+            err << mismatches
+                << " conversions differ from the scalar kernels\n";
+            return 1;
+        }
+        return 0;
+    }
+
+    QTemporaryDir directory;
+    if (! directory.isValid())
+    {
+        err << "Could not create a temporary directory\n";
+        return 1;
+    }
+    StageBenchSettings settings;
+    settings.repeats = repeats;
+    settings.blockSize = DEFAULT_BLOCK_SIZE;
+    settings.lameOptions = lameOptions;
+    settings.iterations = qMax(1,parser.value(iterationsOption).toInt());
+    settings.writeMegabytes = qMax(1,parser.value(writeOption).toInt());
+    settings.directory = directory.path();
+    if (suite == "options")
+    {
+        BenchTable table(stageBenchColumns());
+        runOptionBench(settings,table);
+        table.print(out,isJson);
+        return 0;
+    }
+    QString corpusDirectory = directory.path() + "/corpus";
+    if (parser.isSet(corpusOption))
+        corpusDirectory = parser.value(corpusOption);
+    if (suite == "scaling")
+    {
+        ScalingBenchSettings scalingSettings;
+        scalingSettings.corpusDirectory = corpusDirectory;
+        scalingSettings.outputDirectory = directory.path() + "/output";
+        scalingSettings.lameOptions = lameOptions;
+        scalingSettings.audioSeconds =
+                        qMax(1u,parser.value(scalingSecondsOption).toUInt());
+        scalingSettings.smallFiles = parser.value(smallFilesOption).toInt();
+        scalingSettings.largeFiles = parser.value(largeFilesOption).toInt();
+        QStringList columnList = parser.value(columnsOption).split(",");
+        for (int n = 0; n < columnList.size(); n++)
+            scalingSettings.columnCounts.append(qMax(1,columnList[n].toInt()));
+        QStringList workerList = parser.value(workersOption).split(",");
+        for (int n = 0; n < workerList.size(); n++)
+            scalingSettings.workerCounts.append(qMax(1,workerList[n].toInt()));
+        scalingSettings.repeats = repeats;
+        BenchTable table(scalingBenchColumns());
+        QString returnCode = runScalingBench(scalingSettings,table);
+        if (returnCode != "OK")
+        {
+            err << returnCode << "\n";
+            return 1;
+        }
+        table.print(out,isJson);
+        return 0;
+    }
+    if (suite == "cancel")
+    {
+        CancelBenchSettings cancelSettings;
+        cancelSettings.directory = directory.path();
+        cancelSettings.lameOptions = lameOptions;
+        cancelSettings.seconds = qMax(1u,parser.value(clipOption).toUInt());
+        QStringList cellList = parser.value(cellsOption).split(",");
+        for (int n = 0; n < cellList.size(); n++)
+            cancelSettings.cellCounts.append(qMax(1,cellList[n].toInt()));
+        QStringList workerList = parser.value(workersOption).split(",");
+        for (int n = 0; n < workerList.size(); n++)
+            cancelSettings.workerCounts.append(qMax(1,workerList[n].toInt()));
+        cancelSettings.cancelAfter =
+                        qMax(0,parser.value(cancelAfterOption).toInt());
+        BenchTable table(cancelBenchColumns());
+        QString returnCode = runCancelBench(cancelSettings,table);
+        if (returnCode != "OK")
+        {
+            err << returnCode << "\n";
+            return 1;
+        }
+        table.print(out,isJson);
+        return 0;
+    }
+    if (suite == "split")
+    {
+        SplitBenchSettings splitSettings;
+        splitSettings.directory = directory.path();
+        splitSettings.seconds = qMax(4u,seconds);
+        splitSettings.segmentLength = splitSettings.seconds/4;
+        splitSettings.optionSets =
+                        parser.value(splitOptionsOption).split("|");
+        BenchTable table(splitBenchColumns());
+        QString returnCode = runSplitBench(splitSettings,table);
+        table.print(out,isJson);
+        if (returnCode != "OK")
+        {
+            err << returnCode << "\n";
+            return 1;
+        }
+        return 0;
+    }
+    if (suite == "stages")
+    {
+        QList<uint> lengths;
+        lengths.append(qMax(1u,parser.value(clipOption).toUInt()));
+        uint longSeconds = parser.value(longOption).toUInt();
+        if (longSeconds > 0) lengths.append(longSeconds);
+        QList<CorpusFile> corpus;
+        if (! makeCorpus(corpusDirectory,lengths,corpus))
+        {
+            err << "Could not write the corpus\n";
+            return 1;
+        }
+        BenchTable table(stageBenchColumns());
+        runStageBench(corpus,settings,table);
+        table.print(out,isJson);
+        return 0;
+    }
+    QString inputFile = directory.path() + "/bench.wav";
+    QString outputFile = directory.path() + "/bench.mp3";
+    if (! writeTestWav(inputFile,seconds,CORPUS_SAMPLE_RATE))
+    {
+        err << "Could not write the test file\n";
+        return 1;
+    }
+// Warm the page cache and the encoder before anything is timed
+    QString returnCode = "OK";
+    timeConversion(inputFile,outputFile,lameOptions,DEFAULT_BLOCK_SIZE,1,
+                   returnCode);
+    if (returnCode != "OK")
+    {
+        err << returnCode << "\n";
+        return 1;
+    }
+    QList<double> times;
+    for (int n = 0; n < blockSizes.size(); n++)
+        times.append(timeConversion(inputFile,outputFile,lameOptions,
+                                    blockSizes[n],repeats,returnCode));
+    double baseTime = times.last();
+    BenchTable table(QStringList() << "block_frames" << "blocks" << "seconds"
+                     << "realtime_factor" << "overhead_us_per_block");
+    for (int n = 0; n < blockSizes.size(); n++)
+    {
+        ulong blocks = ((ulong)seconds*CORPUS_SAMPLE_RATE)/blockSizes[n] + 1;
+        double overhead = (times[n] - baseTime)*1e6/blocks;
+        table.addRow(QVariantList() << blockSizes[n] << (qulonglong)blocks
+                     << times[n] << seconds/times[n] << overhead);
+    }
+    table.print(out,isJson);
+    return 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Time the conversion of the test file with one block size
+
+@param[in] inputFile WAV file to convert.
+@param[in] outputFile mp3 file to write.
+@param[in] lameOptions LAME options for the conversion.
+@param[in] blockSize Sample frames per block.
+@param[in] repeats Number of runs, the fastest of which is returned.
+@param[out] returnCode error message of a failed run.
+@returns time of the fastest run in seconds.
+*/
+
+static double timeConversion(const QString& inputFile,
+                             const QString& outputFile,
+                             const QString& lameOptions, uint blockSize,
+                             int repeats, QString& returnCode)
+{
+    double best = 0;
+    LameSettingsPointer settings(new LameSettings(lameOptions));
+    for (int run = 0; run < repeats; run++)
+    {
+        Converter job;
+        job.setInputFileName(inputFile);
+        job.addOutput(settings,outputFile);
+        job.setBlockSize(blockSize);
+        QElapsedTimer timer;
+        timer.start();
+        job.run();
+        double time = timer.nsecsElapsed()*1e-9;
+        if (job.getReturnCode() != "OK") returnCode = job.getReturnCode();
+        if ((run == 0) || (time < best)) best = time;
+    }
+    return best;
+}
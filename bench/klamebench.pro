@@ -0,0 +1,60 @@
+PROJECT =       klamebench
+TEMPLATE        = app
+TARGET          = klamebench
+DEPENDPATH     += . ..
+INCLUDEPATH    += . ..
+LANGUAGE	    = C++
+OBJECTS_DIR     = obj
+MOC_DIR         = moc
+CONFIG	       += qt thread warn_on release console c++14
+CONFIG         -= app_bundle
+QT             -= gui
+
+# Look in the qt installation parent directory under Linux. Use -L to change.
+unix:LIBS	   += -L/usr/lib/x86_64-linux-gnu -lmp3lame
+# Change this to search in the appropriate MinGW library directory
+win32:LIBS	   += -LD:/Development/MinGW/lib -lmp3lame
+
+# Input
+HEADERS        += ../converter.h \
+                  ../wavreader.h \
+                  ../pcmconvert.h \
+                  ../mp3writer.h \
+                  ../lamesettings.h \
+                  ../lameoptions.h \
+                  ../encodecache.h \
+                  ../lame.h \
+                  benchcorpus.h \
+                  benchreport.h \
+                  stagebench.h \
+                  scalingbench.h \
+                  splitbench.h \
+                  paritybench.h \
+                  ../conversionengine.h \
+                  ../manifest.h \
+                  ../journal.h \
+                  ../trace.h \
+                  ../progress.h \
+                  ../cancel.h \
+                  ../jobtable.h
+SOURCES        += klamebench.cpp \
+                  benchcorpus.cpp \
+                  benchreport.cpp \
+                  stagebench.cpp \
+                  scalingbench.cpp \
+                  splitbench.cpp \
+                  paritybench.cpp \
+                  ../conversionengine.cpp \
+                  ../manifest.cpp \
+                  ../journal.cpp \
+                  ../trace.cpp \
+                  ../progress.cpp \
+                  ../cancel.cpp \
+                  ../jobtable.cpp \
+                  ../converter.cpp \
+                  ../wavreader.cpp \
+                  ../pcmconvert.cpp \
+                  ../mp3writer.cpp \
+                  ../lamesettings.cpp \
+                  ../lameoptions.cpp \
+                  ../encodecache.cpp
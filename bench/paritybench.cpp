@@ -0,0 +1,183 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - kernel parity check
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+/** @brief Kernel parity check
+
+Every SIMD kernel set that is built and supported by the processor is compared
+with the scalar set, which is the reference, for 8, 16 and 24 bit mono and
+stereo samples. The samples are random, the input and output buffers start at
+each offset from an aligned address up to a vector width, and the lengths run
+either side of multiples of the vector widths, so that the vector loops, their
+tails and the unaligned loads and stores are all covered. The output buffers
+are filled with a guard value beforehand and compared past their ends, so that
+a kernel writing beyond the frames it was given is caught as well.
+
+The comparison is also run by the pcmparity test, so that a mismatch fails
+"make check".
+*/
+
+#include "paritybench.h"
+#include <QVector>
+#include <random>
+#include <string.h>
+
+// Sample frames converted in each case, either side of the vector widths
+static const uint parityLengths[] =
+    {0,1,2,3,4,5,7,8,9,15,16,17,31,32,33,47,48,63,64,65,127,128,129,1000,4099};
+// Offsets of the buffers from an aligned address, in bytes
+static const uint parityOffsets[] = {0,1,2,3,5,8,15,16,31};
+// Random blocks converted for each length and offset
+const int PARITY_ROUNDS = 4;
+// Frames past the end of the outputs that must be left alone
+const uint PARITY_GUARD = 64;
+// Value the outputs are filled with beforehand
+const short PARITY_GUARD_VALUE = 0x5a5a;
+// Alignment of the buffers before they are offset
+const uint PARITY_ALIGNMENT = 64;
+
+static short* alignedShorts(QVector<short>& buffer, uint offset);
+
+//-----------------------------------------------------------------------------
+/** @brief Names of the columns of the parity check results
+*/
+
+QStringList parityBenchColumns()
+{
+    return QStringList() << "kernels" << "bits" << "channels" << "cases"
+                         << "mismatches";
+}
+//-----------------------------------------------------------------------------
+/** @brief Run the parity check
+
+The kernel set selected beforehand is selected again at the end.
+@param[out] table Results, a row for each kernel set and sample format.
+@returns the number of cases in which a kernel set differed from the scalar
+set.
+*/
+
+int runParityBench(BenchTable& table)
+{
+    static const PcmKernelSet kernelSets[] = {PCM_SSE2,PCM_AVX2,PCM_NEON};
+    static const uint bits[] = {8,16,24};
+    PcmKernelSet selected = selectedPcmKernels();
+    int mismatches = 0;
+    for (uint set = 0; set < sizeof(kernelSets)/sizeof(kernelSets[0]); set++)
+    {
+        if (! selectPcmKernels(kernelSets[set])) continue;
+        for (uint size = 0; size < sizeof(bits)/sizeof(bits[0]); size++)
+        {
+            for (uint channels = 1; channels <= 2; channels++)
+            {
+                int cases = 0;
+                int failed = comparePcmKernels(kernelSets[set],channels,
+                                               bits[size],cases);
+                table.addRow(QVariantList()
+                             << pcmKernelName(kernelSets[set]) << bits[size]
+                             << channels << cases << failed);
+                mismatches += failed;
+            }
+        }
+    }
+    selectPcmKernels(selected);
+    return mismatches;
+}
+//-----------------------------------------------------------------------------
+/** @brief Compare a kernel set with the scalar set for one sample format
+
+The samples are drawn from a fixed seed, so that a failure can be repeated.
+The kernel set is left selected, and the caller selects the set it wants after.
+@param[in] kernelSet Kernel set to compare, which must be supported.
+@param[in] numberChannels Number of channels (1,2).
+@param[in] bitsPerSample Bits per sample (8,16,24).
+@param[out] cases Number of cases compared.
+@returns the number of cases whose outputs differed.
+*/
+
+int comparePcmKernels(PcmKernelSet kernelSet, uint numberChannels,
+                      uint bitsPerSample, int& cases)
+{
+    std::mt19937 random(12345 + 16*bitsPerSample + numberChannels);
+    uint frameBytes = numberChannels*bitsPerSample/8;
+    uint maxFrames = parityLengths[sizeof(parityLengths)/
+                                   sizeof(parityLengths[0]) - 1];
+    uint outputSize = maxFrames + PARITY_GUARD + PARITY_ALIGNMENT;
+    QVector<uchar> input(maxFrames*frameBytes + 2*PARITY_ALIGNMENT);
+    QVector<short> referenceLeft(outputSize),referenceRight(outputSize);
+    QVector<short> left(outputSize),right(outputSize);
+    int mismatches = 0;
+    cases = 0;
+    for (uint length = 0;
+         length < sizeof(parityLengths)/sizeof(parityLengths[0]); length++)
+    {
+        uint frames = parityLengths[length];
+        for (uint offset = 0;
+             offset < sizeof(parityOffsets)/sizeof(parityOffsets[0]); offset++)
+        {
+            for (int round = 0; round < PARITY_ROUNDS; round++)
+            {
+                uchar* samples = input.data() + PARITY_ALIGNMENT -
+                        ((quintptr)input.data() % PARITY_ALIGNMENT) +
+                        parityOffsets[offset];
+                for (uint n = 0; n < frames*frameBytes; n++)
+                    samples[n] = (uchar)random();
+// The outputs are offset by whole samples, as the buffers are arrays of short
+                uint outputOffset = parityOffsets[offset] % 8;
+                short* outputs[4] =
+                    {alignedShorts(referenceLeft,outputOffset),
+                     alignedShorts(referenceRight,outputOffset),
+                     alignedShorts(left,outputOffset),
+                     alignedShorts(right,outputOffset)};
+                selectPcmKernels(PCM_SCALAR);
+                convertPcm(samples,outputs[0],outputs[1],numberChannels,
+                           bitsPerSample,frames);
+                selectPcmKernels(kernelSet);
+                convertPcm(samples,outputs[2],outputs[3],numberChannels,
+                           bitsPerSample,frames);
+                cases++;
+                size_t compared = (frames + PARITY_GUARD)*sizeof(short);
+                if ((memcmp(outputs[0],outputs[2],compared) != 0) ||
+                    (memcmp(outputs[1],outputs[3],compared) != 0))
+                    mismatches++;
+            }
+        }
+    }
+    return mismatches;
+}
+//-----------------------------------------------------------------------------
+/** @brief Fill a buffer with the guard value and offset into it
+
+@param[in] buffer Buffer of at least PARITY_ALIGNMENT more samples than used.
+@param[in] offset Samples past the first aligned address.
+@returns the start of the output.
+*/
+
+static short* alignedShorts(QVector<short>& buffer, uint offset)
+{
+    buffer.fill(PARITY_GUARD_VALUE);
+    uint misalignment = (quintptr)buffer.data() % PARITY_ALIGNMENT;
+    return buffer.data() + (PARITY_ALIGNMENT - misalignment)/sizeof(short) +
+           offset;
+}
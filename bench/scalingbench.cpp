@@ -0,0 +1,407 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - scaling benchmark
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+/** @brief Scaling benchmark
+
+The conversion engine is run over two sets of files holding the same amount of
+audio, one of many short files and one of a few long ones, with each number of
+columns and each number of workers given. Each run is made in a child process
+of the benchmark, so that its CPU time and peak memory are its own.
+
+The results give, for each run:
+- throughput, the seconds of audio encoded (for all columns) per second.
+- speedup, against the first number of workers given.
+- cpu_efficiency, the CPU time used over the time that the workers could have
+  used, where there cannot be more workers running than there are processors.
+- peak_rss_mb, the peak resident memory of the child process.
+
+A change to the way work is spread over the workers then shows up as a change
+in the shape of these curves.
+
+The cancel benchmark queues a batch of many cells, one output each of the same
+short file, cancels it while it is running and gives the time taken to stop.
+This should stay short and flat as the number of cells pending grows.
+*/
+
+#include "scalingbench.h"
+#include "benchcorpus.h"
+#include "conversionengine.h"
+#include <QCoreApplication>
+#include <QProcess>
+#include <QThread>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QTimer>
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+//! A set of files to be converted by the scaling benchmark
+struct FileSetShape
+{
+    const char* name;
+    bool isSmall;
+};
+
+static const FileSetShape fileSetShapes[2] =
+{
+    {"many_small",true},
+    {"few_large",false}
+};
+
+//! Result of one run of the scaling benchmark
+struct ScalingResult
+{
+    double wallSeconds;
+    double cpuSeconds;
+    qint64 peakBytes;
+};
+
+static QString runChild(const QString& inputDirectory,
+                        const QString& outputDirectory,
+                        const QString& lameOptions, int columns, int workers,
+                        ScalingResult& result);
+static void processUsage(double& cpuSeconds, qint64& peakBytes);
+
+//-----------------------------------------------------------------------------
+/** @brief Columns of the scaling results
+*/
+
+QStringList scalingBenchColumns()
+{
+    return QStringList() << "suite" << "shape" << "files" << "file_seconds"
+                         << "columns" << "workers" << "audio_seconds"
+                         << "wall_seconds" << "cpu_seconds" << "throughput"
+                         << "speedup" << "cpu_efficiency" << "peak_rss_mb";
+}
+//-----------------------------------------------------------------------------
+/** @brief Run the engine over each shape, number of columns and workers
+
+@param[in] settings Settings of the benchmark.
+@param[out] table Table to add the results to.
+@returns "OK" or the first error met.
+*/
+
+QString runScalingBench(const ScalingBenchSettings& settings,
+                        BenchTable& table)
+{
+    int processors = QThread::idealThreadCount();
+    for (int shape = 0; shape < 2; shape++)
+    {
+        int numberFiles = fileSetShapes[shape].isSmall ? settings.smallFiles
+                                                       : settings.largeFiles;
+        numberFiles = qMax(1,numberFiles);
+        uint seconds = qMax(1u,settings.audioSeconds/numberFiles);
+        QString inputDirectory =
+            QDir(settings.corpusDirectory).filePath(fileSetShapes[shape].name);
+        QList<CorpusFile> files;
+        if (! makeFileSet(inputDirectory,fileSetShapes[shape].name,
+                          numberFiles,seconds,files))
+            return "Could not write the corpus";
+        for (int column = 0; column < settings.columnCounts.size(); column++)
+        {
+            int columns = settings.columnCounts[column];
+            double baseTime = 0;
+            for (int worker = 0; worker < settings.workerCounts.size(); worker++)
+            {
+                int workers = settings.workerCounts[worker];
+                ScalingResult best;
+                for (int run = 0; run < settings.repeats; run++)
+                {
+                    ScalingResult result;
+                    QString returnCode = runChild(inputDirectory,
+                                            settings.outputDirectory,
+                                            settings.lameOptions,columns,
+                                            workers,result);
+                    if (returnCode != "OK") return returnCode;
+                    if ((run == 0) || (result.wallSeconds < best.wallSeconds))
+                        best = result;
+                }
+                if (worker == 0) baseTime = best.wallSeconds;
+                double audioSeconds = (double)numberFiles*seconds*columns;
+                double wall = qMax(best.wallSeconds,1e-9);
+                int running = qMin(workers,processors);
+                table.addRow(QVariantList() << QString("scaling")
+                             << QString(fileSetShapes[shape].name)
+                             << numberFiles << seconds << columns << workers
+                             << audioSeconds << best.wallSeconds
+                             << best.cpuSeconds << audioSeconds/wall
+                             << baseTime/wall
+                             << best.cpuSeconds/(wall*running)
+                             << best.peakBytes/1048576.0);
+            }
+        }
+    }
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Columns of the cancel results
+*/
+
+QStringList cancelBenchColumns()
+{
+    return QStringList() << "suite" << "cells" << "workers" << "plan_seconds"
+                         << "cancel_after_ms" << "stop_ms" << "finish_ms"
+                         << "result";
+}
+//-----------------------------------------------------------------------------
+/** @brief Cancel batches of each number of cells and workers
+
+Each batch is planned, started and cancelled once it has run for the time
+given. The results give the time the engine took from the cancel until the
+last running job had stopped, and the time until the batch had ended, which
+also covers the outputs being discarded and the manifests saved. A batch that
+ended before it could be cancelled has a stop time of -1.
+@param[in] settings Settings of the benchmark.
+@param[out] table Table to add the results to.
+@returns "OK" or the first error met.
+*/
+
+QString runCancelBench(const CancelBenchSettings& settings, BenchTable& table)
+{
+    QString inputFile = QDir(settings.directory).filePath("cancel.wav");
+    if (! writeTestWav(inputFile,settings.seconds,CORPUS_SAMPLE_RATE))
+        return "Could not write the test file";
+    LameSettingsPointer lameSettings(new LameSettings(settings.lameOptions));
+    if (! lameSettings->isValid()) return lameSettings->returnCode();
+    QDir outputDirectory(QDir(settings.directory).filePath("cancel"));
+    for (int cell = 0; cell < settings.cellCounts.size(); cell++)
+    {
+        int cells = settings.cellCounts[cell];
+        for (int worker = 0; worker < settings.workerCounts.size(); worker++)
+        {
+            int workers = settings.workerCounts[worker];
+            outputDirectory.mkpath(".");
+            ConversionEngine engine;
+            engine.setWorkerCount(workers);
+            engine.setIncremental(false);
+            QElapsedTimer timer;
+            timer.start();
+            for (int n = 0; n < cells; n++)
+            {
+                ConversionOutput output;
+                output.settings = lameSettings;
+                output.outputFile = outputDirectory.filePath(
+                                        QString("cell%1.mp3").arg(n));
+                engine.addConversion(inputFile,QList<ConversionOutput>()
+                                                << output);
+            }
+            double planSeconds = timer.nsecsElapsed()*1e-9;
+            ScalingRun run;
+            QObject::connect(&engine,SIGNAL(finished(const QString&)),
+                    &run,SLOT(batchFinished(const QString&)));
+            engine.start();
+// Let the workers get going before the batch is cancelled
+            QEventLoop wait;
+            QTimer::singleShot(settings.cancelAfter,&wait,SLOT(quit()));
+            wait.exec();
+            double finishMs = -1;
+            if (engine.isRunning())
+            {
+                timer.restart();
+                engine.cancel();
+                if (engine.isRunning()) run.exec();
+                finishMs = timer.nsecsElapsed()*1e-6;
+            }
+            table.addRow(QVariantList() << QString("cancel") << cells
+                         << workers << planSeconds << settings.cancelAfter
+                         << engine.cancelLatency() << finishMs
+                         << run.returnCode());
+            outputDirectory.removeRecursively();
+        }
+    }
+    QFile::remove(inputFile);
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Run one batch of the scaling benchmark in this process
+
+This is the body of the child process. Every file in the input directory is
+converted for each column into a directory of its own, and a line is printed
+with the wall time, CPU time and peak memory of the process, and the result
+of the batch.
+@param[in] inputDirectory Directory holding the WAV files.
+@param[in] outputDirectory Directory for the mp3 outputs.
+@param[in] lameOptions LAME options for every column.
+@param[in] columns Number of columns.
+@param[in] workers Number of conversion workers.
+@returns exit status, 0 if the batch was run.
+*/
+
+int runScalingPoint(const QString& inputDirectory,
+                    const QString& outputDirectory,
+                    const QString& lameOptions, int columns, int workers)
+{
+    QTextStream out(stdout);
+    QDir inputs(inputDirectory);
+    QStringList inputFiles = inputs.entryList(QStringList() << "*.wav",
+                                              QDir::Files,QDir::Name);
+    LameSettingsPointer settings(new LameSettings(lameOptions));
+    if (! settings->isValid())
+    {
+        out << "point\t0\t0\t0\t" << settings->returnCode() << "\n";
+        return 1;
+    }
+    QList<QDir> columnDirectories;
+    for (int column = 0; column < columns; column++)
+    {
+        QDir directory(QDir(outputDirectory).filePath(
+                            QString("column%1").arg(column)));
+        directory.mkpath(".");
+        columnDirectories.append(directory);
+    }
+    ConversionEngine engine;
+    engine.setWorkerCount(workers);
+    engine.setIncremental(false);
+    for (int n = 0; n < inputFiles.size(); n++)
+    {
+        QList<ConversionOutput> outputs;
+        for (int column = 0; column < columns; column++)
+        {
+            ConversionOutput output;
+            output.settings = settings;
+            output.outputFile = columnDirectories[column].filePath(
+                        QFileInfo(inputFiles[n]).completeBaseName() + ".mp3");
+            outputs.append(output);
+        }
+        engine.addConversion(inputs.filePath(inputFiles[n]),outputs);
+    }
+    double cpuStart;
+    qint64 peakBytes;
+    processUsage(cpuStart,peakBytes);
+    ScalingRun run;
+    QObject::connect(&engine,SIGNAL(finished(const QString&)),
+            &run,SLOT(batchFinished(const QString&)));
+    QElapsedTimer timer;
+    timer.start();
+    engine.start();
+    QString returnCode = run.exec();
+    double wallSeconds = timer.nsecsElapsed()*1e-9;
+    double cpuEnd;
+    processUsage(cpuEnd,peakBytes);
+    out << "point\t" << QString::number(wallSeconds,'f',6) << "\t"
+        << QString::number(cpuEnd - cpuStart,'f',6) << "\t" << peakBytes
+        << "\t" << returnCode << "\n";
+    return 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Run one batch in a child process and read its results
+
+The outputs are removed afterwards, so that each run writes fresh files and the
+disk does not fill over a long sweep.
+@returns "OK" or the error of the run.
+*/
+
+static QString runChild(const QString& inputDirectory,
+                        const QString& outputDirectory,
+                        const QString& lameOptions, int columns, int workers,
+                        ScalingResult& result)
+{
+    QProcess child;
+    child.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    child.start(QCoreApplication::applicationFilePath(),QStringList()
+                << "--scaling-point" << QString("%1,%2").arg(columns)
+                                                        .arg(workers)
+                << "--corpus" << inputDirectory
+                << "--output" << outputDirectory
+                << "--lame-options" << lameOptions);
+    bool isFinished = child.waitForFinished(-1);
+    QDir(outputDirectory).removeRecursively();
+    if ((! isFinished) || (child.exitStatus() != QProcess::NormalExit))
+        return "The benchmark child process failed";
+    QStringList fields = QString::fromLocal8Bit(child.readAllStandardOutput())
+                            .trimmed().split("\t");
+    if ((fields.size() != 5) || (fields[0] != "point"))
+        return "The benchmark child process gave no result";
+    if (fields[4] != "OK") return fields[4];
+    result.wallSeconds = fields[1].toDouble();
+    result.cpuSeconds = fields[2].toDouble();
+    result.peakBytes = fields[3].toLongLong();
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief CPU time and peak resident memory of this process
+
+Where these are not available they are given as zero.
+@param[out] cpuSeconds User and system time used so far.
+@param[out] peakBytes Peak resident memory so far.
+*/
+
+static void processUsage(double& cpuSeconds, qint64& peakBytes)
+{
+    cpuSeconds = 0;
+    peakBytes = 0;
+#ifdef Q_OS_UNIX
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF,&usage) != 0) return;
+    cpuSeconds = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec*1e-6 +
+                 usage.ru_stime.tv_sec + usage.ru_stime.tv_usec*1e-6;
+#ifdef Q_OS_MACOS
+    peakBytes = usage.ru_maxrss;                        // bytes
+#else
+    peakBytes = (qint64)usage.ru_maxrss*1024;           // kilobytes
+#endif
+#endif
+}
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+*/
+
+ScalingRun::ScalingRun() : returnCode_("OK")
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Run the event loop until the batch is finished
+
+@returns the result of the batch.
+*/
+
+QString ScalingRun::exec()
+{
+    loop_.exec();
+    return returnCode_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Result of the batch, once it has finished
+*/
+
+QString ScalingRun::returnCode() const
+{
+    return returnCode_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Keep the result of the batch and stop the event loop
+*/
+
+void ScalingRun::batchFinished(const QString& returnCode)
+{
+    returnCode_ = returnCode;
+    loop_.quit();
+}
@@ -0,0 +1,93 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - scaling benchmark
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef SCALINGBENCH_H
+#define SCALINGBENCH_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QEventLoop>
+#include "benchreport.h"
+
+//! Settings of the scaling benchmark
+struct ScalingBenchSettings
+{
+    QString corpusDirectory;          //!< Directory holding the file sets.
+    QString outputDirectory;          //!< Directory for the mp3 outputs.
+    QString lameOptions;              //!< LAME options for every column.
+    uint audioSeconds;                //!< Audio in each file set.
+    int smallFiles;                   //!< Files in the set of small files.
+    int largeFiles;                   //!< Files in the set of large files.
+    QList<int> columnCounts;          //!< Numbers of columns to run.
+    QList<int> workerCounts;          //!< Numbers of workers to run.
+    int repeats;                      //!< Runs of each, the best is kept.
+};
+
+//! Settings of the cancel benchmark
+struct CancelBenchSettings
+{
+    QString directory;                //!< Directory for the input and outputs.
+    QString lameOptions;              //!< LAME options for every cell.
+    uint seconds;                     //!< Length of the input file.
+    QList<int> cellCounts;            //!< Numbers of cells to run.
+    QList<int> workerCounts;          //!< Numbers of workers to run.
+    int cancelAfter;                  //!< Time before the cancel (ms).
+};
+
+QStringList scalingBenchColumns();
+QString runScalingBench(const ScalingBenchSettings& settings,
+                        BenchTable& table);
+QStringList cancelBenchColumns();
+QString runCancelBench(const CancelBenchSettings& settings, BenchTable& table);
+int runScalingPoint(const QString& inputDirectory,
+                    const QString& outputDirectory,
+                    const QString& lameOptions, int columns, int workers);
+
+//-----------------------------------------------------------------------------
+/** @brief Wait for a conversion batch to finish
+
+The batch result is kept and the event loop stopped when the engine signals the
+end of the batch.
+*/
+
+class ScalingRun : public QObject
+{
+    Q_OBJECT
+public:
+    ScalingRun();
+    QString exec();
+    QString returnCode() const;
+public slots:
+    void batchFinished(const QString& returnCode);
+private:
+    QEventLoop loop_;                   //!< Runs until the batch is done.
+    QString returnCode_;                //!< Result of the batch.
+};
+
+#endif
@@ -0,0 +1,201 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - split check
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+/** @brief Split check
+
+A long file is converted twice with each set of LAME options, once as a single
+job and once with segments short enough that it is split where the options
+allow it, and the durations of the two mp3 files are compared. The duration is
+taken from the Xing/LAME tag frame if the file has one, and otherwise from the
+number of frames, so a split output that had lost the tag of a VBR stream, or
+had gained or lost frames where the segments were joined, shows up as a
+difference. The check fails if any pair differs by more than one frame.
+*/
+
+#include "splitbench.h"
+#include "benchcorpus.h"
+#include "scalingbench.h"
+#include "conversionengine.h"
+#include "lamesettings.h"
+#include <QDir>
+#include <QFile>
+#include <QByteArray>
+#include <cstring>
+
+static QString convert(const QString& inputFile, const QString& outputFile,
+                       LameSettingsPointer settings, uint segmentLength);
+
+//-----------------------------------------------------------------------------
+/** @brief Names of the columns of the split check results
+*/
+
+QStringList splitBenchColumns()
+{
+    return QStringList() << "options" << "can_split" << "serial_seconds"
+                         << "split_seconds" << "difference_ms";
+}
+//-----------------------------------------------------------------------------
+/** @brief Run the split check
+
+@param[in] settings Settings of the check.
+@param[out] table Results, a row for each set of options.
+@returns "OK", the error of a conversion, or the number of outputs that differ.
+*/
+
+QString runSplitBench(const SplitBenchSettings& settings, BenchTable& table)
+{
+    QString inputFile = QDir(settings.directory).filePath("split.wav");
+    if (! writeTestWav(inputFile,settings.seconds,CORPUS_SAMPLE_RATE))
+        return "Could not write the test file";
+    double frameSeconds = (double)MP3_FRAME_SAMPLES/CORPUS_SAMPLE_RATE;
+    int differ = 0;
+    for (int n = 0; n < settings.optionSets.size(); n++)
+    {
+        LameSettingsPointer lameSettings(
+                    new LameSettings(settings.optionSets[n]));
+        if (! lameSettings->isValid()) return lameSettings->returnCode();
+        QString serialFile = QDir(settings.directory).filePath("serial.mp3");
+        QString splitFile = QDir(settings.directory).filePath("split.mp3");
+        QString returnCode = convert(inputFile,serialFile,lameSettings,0);
+        if (returnCode == "OK")
+            returnCode = convert(inputFile,splitFile,lameSettings,
+                                 settings.segmentLength);
+        if (returnCode != "OK") return returnCode;
+        double serialSeconds,splitSeconds;
+        if ((! mp3Duration(serialFile,serialSeconds)) ||
+            (! mp3Duration(splitFile,splitSeconds)))
+            return "Could not read the duration of an output";
+        double difference = splitSeconds - serialSeconds;
+        if (qAbs(difference) > frameSeconds) differ++;
+        table.addRow(QVariantList() << settings.optionSets[n]
+                     << lameSettings->canSplit(2,CORPUS_SAMPLE_RATE)
+                     << serialSeconds << splitSeconds << difference*1000);
+        QFile::remove(serialFile);
+        QFile::remove(splitFile);
+    }
+    QFile::remove(inputFile);
+    if (differ > 0)
+        return QString("%1 split outputs differ from a serial encode")
+                    .arg(differ);
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Convert a file by the conversion engine
+
+@param[in] inputFile WAV file to convert.
+@param[in] outputFile mp3 file to write.
+@param[in] settings LAME settings of the output.
+@param[in] segmentLength Minimum segment length, or zero to never split.
+@returns "OK" or the error of the batch.
+*/
+
+static QString convert(const QString& inputFile, const QString& outputFile,
+                       LameSettingsPointer settings, uint segmentLength)
+{
+    ConversionEngine engine;
+    engine.setIncremental(false);
+    engine.setSegmentLength(segmentLength);
+    ConversionOutput output;
+    output.settings = settings;
+    output.outputFile = outputFile;
+    engine.addConversion(inputFile,QList<ConversionOutput>() << output);
+    ScalingRun run;
+    QObject::connect(&engine,SIGNAL(finished(const QString&)),
+            &run,SLOT(batchFinished(const QString&)));
+    engine.start();
+    return run.exec();
+}
+//-----------------------------------------------------------------------------
+/** @brief Duration of an MPEG layer III file
+
+If the first frame is a Xing or Info tag frame with a frame count, the count is
+taken from it, as a player would. Otherwise the frames are counted. ID3v2 tags
+at the start are skipped and the count stops at anything that is not a frame,
+such as an ID3v1 tag.
+@param[in] fileName mp3 file.
+@param[out] seconds Duration of the audio frames.
+@returns false if the file could not be read or holds no frames.
+*/
+
+bool mp3Duration(const QString& fileName, double& seconds)
+{
+    static const int bitrates[2][16] =
+        {{0,8,16,24,32,40,48,56,64,80,96,112,128,144,160,0},
+         {0,32,40,48,56,64,80,96,112,128,160,192,224,256,320,0}};
+    static const int sampleRates[3] = {44100,48000,32000};
+    QFile file(fileName);
+    if (! file.open(QIODevice::ReadOnly)) return false;
+    QByteArray data = file.readAll();
+    const uchar* bytes = (const uchar*)data.constData();
+    qint64 size = data.size();
+    qint64 position = 0;
+    if ((size >= 10) && (data.startsWith("ID3")))
+        position = 10 + ((bytes[6] & 0x7f) << 21) + ((bytes[7] & 0x7f) << 14) +
+                   ((bytes[8] & 0x7f) << 7) + (bytes[9] & 0x7f);
+    quint64 frames = 0;
+    int frameSamples = 0;
+    int sampleRate = 0;
+    while (position + 4 <= size)
+    {
+        const uchar* header = bytes + position;
+        int version = (header[1] >> 3) & 3;       // 3 MPEG1, 2 MPEG2, 0 MPEG2.5
+        int bitrateIndex = header[2] >> 4;
+        int rateIndex = (header[2] >> 2) & 3;
+        if ((header[0] != 0xff) || ((header[1] & 0xe0) != 0xe0) ||
+            (version == 1) || (((header[1] >> 1) & 3) != 1) ||
+            (bitrates[version == 3][bitrateIndex] == 0) || (rateIndex == 3))
+            break;
+        bool isMpeg1 = (version == 3);
+        sampleRate = sampleRates[rateIndex] >>
+                     (isMpeg1 ? 0 : ((version == 2) ? 1 : 2));
+        frameSamples = isMpeg1 ? 1152 : 576;
+        int frameBytes = (isMpeg1 ? 144000 : 72000)*
+                         bitrates[isMpeg1][bitrateIndex]/sampleRate +
+                         ((header[2] >> 1) & 1);
+/* The tag follows the side information, whose size depends on the version and
+on whether the frame is mono. */
+        if (frames == 0)
+        {
+            bool isMono = ((header[3] >> 6) == 3);
+            int sideBytes = isMpeg1 ? (isMono ? 17 : 32) : (isMono ? 9 : 17);
+            qint64 tag = position + 4 + sideBytes;
+            if ((tag + 12 <= size) &&
+                ((memcmp(bytes + tag,"Xing",4) == 0) ||
+                 (memcmp(bytes + tag,"Info",4) == 0)) && (bytes[tag+7] & 1))
+            {
+                frames = ((quint64)bytes[tag+8] << 24) |
+                         ((quint64)bytes[tag+9] << 16) |
+                         ((quint64)bytes[tag+10] << 8) | bytes[tag+11];
+                break;
+            }
+        }
+        frames++;
+        position += frameBytes;
+    }
+    if ((frames == 0) || (sampleRate == 0)) return false;
+    seconds = (double)frames*frameSamples/sampleRate;
+    return true;
+}
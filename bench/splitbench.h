@@ -0,0 +1,49 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - split check
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+
+#ifndef SPLITBENCH_H
+#define SPLITBENCH_H
+
+#include <QString>
+#include <QStringList>
+#include "benchreport.h"
+
+//! Settings of the split check
+struct SplitBenchSettings
+{
+    QString directory;                //!< Directory for the input and outputs.
+    uint seconds;                     //!< Length of the input file.
+    uint segmentLength;               //!< Minimum segment length (s).
+    QStringList optionSets;           //!< LAME options of each output.
+};
+
+QStringList splitBenchColumns();
+QString runSplitBench(const SplitBenchSettings& settings, BenchTable& table);
+bool mp3Duration(const QString& fileName, double& seconds);
+
+#endif
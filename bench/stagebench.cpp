@@ -0,0 +1,386 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - stage benchmarks
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+/** @brief Stage benchmarks
+
+Each stage of a conversion is timed on its own over every file of the corpus,
+so that a change to one stage shows up without being lost in the others:
+- header, opening a file and checking its header.
+- read, reading the samples, touching every page so that a mapping is paged in.
+- convert, converting the samples into a buffer for each channel.
+- encode, encoding the converted samples with LAME.
+- write, writing mp3 data through the writer thread, with and without fsync.
+
+For the convert and encode stages the earlier stages are run but not timed.
+The option benchmarks time compiling a set of LAME options, applying the
+compiled options to a set of LAME flags, and creating the flags for a job.
+*/
+
+#include "stagebench.h"
+#include "wavreader.h"
+#include "pcmconvert.h"
+#include "converter.h"
+#include "mp3writer.h"
+#include "lamesettings.h"
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <QByteArray>
+#include <QElapsedTimer>
+
+//! A set of LAME options for the option benchmarks
+struct OptionSet
+{
+    const char* name;
+    const char* options;
+};
+
+static const OptionSet optionSets[] =
+{
+    {"cbr","-b 128"},
+    {"vbr","-V 2 -q 2 --vbr-new"},
+    {"tagged","-h -b 192 -m j --lowpass 19.5 --resample 44.1 "
+              "--tt A Long Title --ta Artist --tl Album --ty 2006 "
+              "--tc Recorded live"}
+};
+
+static double timeHeader(const CorpusFile& file, int count);
+static double timeRead(const CorpusFile& file, uint blockSize);
+static double timeConvert(const CorpusFile& file, uint blockSize);
+static double timeEncode(const CorpusFile& file, uint blockSize,
+                         const LameSettings& settings);
+static double timeWrite(const QString& fileName, int megabytes,
+                        const QString& fsyncPolicy);
+static double bestOf(int repeats, double time, double best);
+static void addStageRow(BenchTable& table, const QString& stage,
+                        const QString& input, const CorpusFile* file,
+                        qint64 bytes, int count, double time);
+
+// Stops the compiler from dropping the reads that are timed
+static volatile uint checksum = 0;
+
+//-----------------------------------------------------------------------------
+/** @brief Columns of the stage and option results
+
+Rates that do not apply to a stage are given as zero.
+*/
+
+QStringList stageBenchColumns()
+{
+    return QStringList() << "suite" << "stage" << "input" << "channels"
+                         << "bits" << "audio_seconds" << "bytes" << "count"
+                         << "wall_seconds" << "mb_per_s" << "realtime"
+                         << "ns_per_op";
+}
+//-----------------------------------------------------------------------------
+/** @brief Time each stage of a conversion over the corpus
+
+@param[in] corpus Files to be converted.
+@param[in] settings Settings of the benchmarks.
+@param[out] table Table to add the results to.
+*/
+
+void runStageBench(const QList<CorpusFile>& corpus,
+                   const StageBenchSettings& settings, BenchTable& table)
+{
+    LameSettings lameSettings(settings.lameOptions);
+    for (int n = 0; n < corpus.size(); n++)
+    {
+        double header = 0,read = 0,convert = 0,encode = 0;
+        for (int run = 0; run < settings.repeats; run++)
+        {
+            header = bestOf(run,timeHeader(corpus[n],settings.iterations),
+                            header);
+            read = bestOf(run,timeRead(corpus[n],settings.blockSize),read);
+            convert = bestOf(run,timeConvert(corpus[n],settings.blockSize),
+                             convert);
+            if (lameSettings.isValid())
+                encode = bestOf(run,timeEncode(corpus[n],settings.blockSize,
+                                               lameSettings),encode);
+        }
+        addStageRow(table,"header",corpus[n].name,&corpus[n],0,
+                    settings.iterations,header);
+        addStageRow(table,"read",corpus[n].name,&corpus[n],corpus[n].bytes(),
+                    1,read);
+        addStageRow(table,"convert",corpus[n].name,&corpus[n],
+                    corpus[n].bytes(),1,convert);
+        if (lameSettings.isValid())
+            addStageRow(table,"encode",corpus[n].name,&corpus[n],
+                        corpus[n].bytes(),1,encode);
+    }
+    QString fileName = QDir(settings.directory).filePath("stagebench.mp3");
+    const char* policies[2] = {"never","file"};
+    for (int policy = 0; policy < 2; policy++)
+    {
+        double write = 0;
+        for (int run = 0; run < settings.repeats; run++)
+            write = bestOf(run,timeWrite(fileName,settings.writeMegabytes,
+                                         policies[policy]),write);
+        addStageRow(table,"write",QString("fsync_") + policies[policy],NULL,
+                    (qint64)settings.writeMegabytes << 20,1,write);
+    }
+    QFile::remove(fileName);
+}
+//-----------------------------------------------------------------------------
+/** @brief Time the handling of LAME options
+
+@param[in] settings Settings of the benchmarks.
+@param[out] table Table to add the results to.
+*/
+
+void runOptionBench(const StageBenchSettings& settings, BenchTable& table)
+{
+    int sets = sizeof(optionSets)/sizeof(optionSets[0]);
+    for (int set = 0; set < sets; set++)
+    {
+        QString options = optionSets[set].options;
+        double compile = 0,apply = 0,create = 0;
+        for (int run = 0; run < settings.repeats; run++)
+        {
+            QElapsedTimer timer;
+            timer.start();
+            for (int n = 0; n < settings.iterations; n++)
+                checksum += compileOptions(options).size();
+            compile = bestOf(run,timer.nsecsElapsed()*1e-9,compile);
+/* The options are applied over and over to one set of flags, as LAME only
+stores them until lame_init_params() is called. */
+            QVector<LameOption> compiled = compileOptions(options);
+            lame_global_flags* gfp = lame_init();
+            id3tag_init(gfp);
+            timer.restart();
+            for (int n = 0; n < settings.iterations; n++)
+                for (int option = 0; option < compiled.size(); option++)
+                    checksum += setLameSetting(gfp,compiled[option]).size();
+            apply = bestOf(run,timer.nsecsElapsed()*1e-9,apply);
+            lame_close(gfp);
+            LameSettings lameSettings(options);
+            QString returnCode;
+            timer.restart();
+            for (int n = 0; n < settings.iterations; n++)
+            {
+                gfp = lameSettings.createFlags(returnCode);
+                if (gfp != NULL) lame_close(gfp);
+            }
+            create = bestOf(run,timer.nsecsElapsed()*1e-9,create);
+        }
+        addStageRow(table,"compile",optionSets[set].name,NULL,0,
+                    settings.iterations,compile);
+        addStageRow(table,"apply",optionSets[set].name,NULL,0,
+                    settings.iterations,apply);
+        addStageRow(table,"create",optionSets[set].name,NULL,0,
+                    settings.iterations,create);
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Time opening a file and checking its header
+
+@returns time of all the opens in seconds.
+*/
+
+static double timeHeader(const CorpusFile& file, int count)
+{
+    QElapsedTimer timer;
+    timer.start();
+    for (int n = 0; n < count; n++)
+    {
+        WavReader reader;
+        if (reader.open(file.fileName) == "OK")
+            checksum += reader.numberFrames();
+    }
+    return timer.nsecsElapsed()*1e-9;
+}
+//-----------------------------------------------------------------------------
+/** @brief Time reading all the samples of a file
+
+One byte of each page is read so that a mapped file is paged in, as it would be
+by the conversion.
+@returns time in seconds.
+*/
+
+static double timeRead(const CorpusFile& file, uint blockSize)
+{
+    WavReader reader;
+    if (reader.open(file.fileName) != "OK") return 0;
+    uint bytesPerFrame = reader.bytesPerFrame();
+    QElapsedTimer timer;
+    timer.start();
+    ulong remaining = reader.numberFrames();
+    while (remaining > 0)
+    {
+        ulong frames = qMin<ulong>(remaining,blockSize);
+        const uchar* samples = reader.readFrames(frames);
+        if (samples == NULL) break;
+        for (ulong byte = 0; byte < frames*bytesPerFrame; byte += 4096)
+            checksum += samples[byte];
+        remaining -= frames;
+    }
+    return timer.nsecsElapsed()*1e-9;
+}
+//-----------------------------------------------------------------------------
+/** @brief Time converting all the samples of a file
+
+Only the conversion is timed, not the reading.
+@returns time in seconds.
+*/
+
+static double timeConvert(const CorpusFile& file, uint blockSize)
+{
+    WavReader reader;
+    if (reader.open(file.fileName) != "OK") return 0;
+    QVector<short> buffer(2*blockSize);
+    qint64 nanoseconds = 0;
+    QElapsedTimer timer;
+    ulong remaining = reader.numberFrames();
+    while (remaining > 0)
+    {
+        ulong frames = qMin<ulong>(remaining,blockSize);
+        const uchar* samples = reader.readFrames(frames);
+        if (samples == NULL) break;
+        timer.start();
+        convertPcm(samples,buffer.data(),buffer.data()+blockSize,
+                   reader.numberChannels(),reader.bitsPerSample(),frames);
+        nanoseconds += timer.nsecsElapsed();
+        checksum += buffer[0];
+        remaining -= frames;
+    }
+    return nanoseconds*1e-9;
+}
+//-----------------------------------------------------------------------------
+/** @brief Time encoding all the samples of a file
+
+The samples are converted into a buffer for each channel, as for 8 and 24 bit
+files in a conversion, and only the calls to LAME are timed.
+@returns time in seconds.
+*/
+
+static double timeEncode(const CorpusFile& file, uint blockSize,
+                         const LameSettings& settings)
+{
+    WavReader reader;
+    if (reader.open(file.fileName) != "OK") return 0;
+    QString returnCode;
+    lame_global_flags* gfp = settings.createFlags(returnCode);
+    if (gfp == NULL) return 0;
+    lame_set_num_channels(gfp,reader.numberChannels());
+    lame_set_in_samplerate(gfp,reader.sampleRate());
+    if (lame_init_params(gfp) < 0)
+    {
+        lame_close(gfp);
+        return 0;
+    }
+    QVector<short> buffer(2*blockSize);
+    short* left = buffer.data();
+    short* right = left + blockSize;
+    QVector<uchar> output(mp3BufferSize(blockSize));
+    qint64 nanoseconds = 0;
+    QElapsedTimer timer;
+    ulong remaining = reader.numberFrames();
+    while (remaining > 0)
+    {
+        ulong frames = qMin<ulong>(remaining,blockSize);
+        const uchar* samples = reader.readFrames(frames);
+        if (samples == NULL) break;
+        convertPcm(samples,left,right,reader.numberChannels(),
+                   reader.bitsPerSample(),frames);
+        timer.start();
+        checksum += lame_encode_buffer(gfp,left,right,frames,output.data(),
+                                       output.size());
+        nanoseconds += timer.nsecsElapsed();
+        remaining -= frames;
+    }
+    timer.start();
+    checksum += lame_encode_flush(gfp,output.data(),output.size());
+    nanoseconds += timer.nsecsElapsed();
+    lame_close(gfp);
+    return nanoseconds*1e-9;
+}
+//-----------------------------------------------------------------------------
+/** @brief Time writing data through the writer thread
+
+The time runs until the writer thread has closed the file, which it does
+before it stops.
+@returns time in seconds.
+*/
+
+static double timeWrite(const QString& fileName, int megabytes,
+                        const QString& fsyncPolicy)
+{
+    QByteArray frames(WRITE_BUFFER_SIZE/4,'\xff');
+    qint64 bytes = (qint64)megabytes << 20;
+    QElapsedTimer timer;
+    timer.start();
+    Mp3Writer* writer = new Mp3Writer;
+    writer->setFsyncPolicy(fsyncPolicy);
+    writer->start();
+    Mp3OutputStream stream(writer,fileName);
+    stream.open(QIODevice::WriteOnly);
+    for (qint64 written = 0; written < bytes; written += frames.size())
+        stream.write(frames);
+    stream.commit();
+    delete writer;                          // Waits for the file to close
+    return timer.nsecsElapsed()*1e-9;
+}
+//-----------------------------------------------------------------------------
+/** @brief Keep the best of a number of runs
+
+@param[in] run Index of the run, the first run being taken whatever its time.
+@param[in] time Time of this run.
+@param[in] best Best time so far.
+@returns the new best time.
+*/
+
+static double bestOf(int run, double time, double best)
+{
+    if ((run == 0) || (time < best)) return time;
+    return best;
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a row of results with its rates
+
+@param[out] table Table to add the row to.
+@param[in] stage Name of the stage.
+@param[in] input Name of the input.
+@param[in] file Corpus file, or null if the stage has none.
+@param[in] bytes Bytes handled, or zero.
+@param[in] count Number of operations timed.
+@param[in] time Time of all the operations in seconds.
+*/
+
+static void addStageRow(BenchTable& table, const QString& stage,
+                        const QString& input, const CorpusFile* file,
+                        qint64 bytes, int count, double time)
+{
+    uint seconds = (file != NULL) ? file->seconds : 0;
+    double rate = (time > 0) ? bytes/time/1e6 : 0;
+    double realtime = (time > 0) ? seconds/time : 0;
+    double perOperation = (count > 0) ? time*1e9/count : 0;
+    table.addRow(QVariantList() << QString("stages") << stage << input
+                 << ((file != NULL) ? file->numberChannels : 0)
+                 << ((file != NULL) ? file->bitsPerSample : 0)
+                 << seconds << bytes << count << time << rate << realtime
+                 << perOperation);
+}
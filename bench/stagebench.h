@@ -0,0 +1,52 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - stage benchmarks
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef STAGEBENCH_H
+#define STAGEBENCH_H
+
+#include <QString>
+#include <QList>
+#include "benchcorpus.h"
+#include "benchreport.h"
+
+//! Settings shared by the stage and option benchmarks
+struct StageBenchSettings
+{
+    int repeats;                      //!< Runs of each, the best is kept.
+    uint blockSize;                   //!< Sample frames per block.
+    QString lameOptions;              //!< LAME options for the encoder.
+    int iterations;                   //!< Calls timed in each micro-benchmark.
+    int writeMegabytes;               //!< Data written by the write stage.
+    QString directory;                //!< Directory for files written.
+};
+
+QStringList stageBenchColumns();
+void runStageBench(const QList<CorpusFile>& corpus,
+                   const StageBenchSettings& settings, BenchTable& table);
+void runOptionBench(const StageBenchSettings& settings, BenchTable& table);
+
+#endif
@@ -0,0 +1,104 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#include "cancel.h"
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+@param[in] parent Token that also cancels this one, or null.
+*/
+
+CancelToken::CancelToken(CancelToken* parent) : parent_(parent),
+                                                cancelled_(0),latency_(-1)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the token that also cancels this one
+
+This must be done before the token is shared with the workers.
+@param[in] parent Token that also cancels this one, or null.
+*/
+
+void CancelToken::setParent(CancelToken* parent)
+{
+    parent_ = parent;
+}
+//-----------------------------------------------------------------------------
+/** @brief Clear the token for a new batch
+
+No worker may be testing the token while it is cleared.
+*/
+
+void CancelToken::reset()
+{
+    cancelled_.storeRelease(0);
+    latency_.store(-1);
+}
+//-----------------------------------------------------------------------------
+/** @brief Cancel the token
+
+The clock is started before the token is marked as cancelled, so a worker that
+sees the cancel also sees the clock. A token is only cancelled from one thread,
+and a second cancel is ignored.
+*/
+
+void CancelToken::cancel()
+{
+    if (cancelled_.loadAcquire() != 0) return;
+    latency_.store(0);
+    clock_.start();
+    cancelled_.storeRelease(1);
+}
+//-----------------------------------------------------------------------------
+/** @brief Acknowledge that a worker has stopped on a cancel
+
+The time since the cancel is kept if it is the longest so far. This is passed
+on to the parent, so that the batch token keeps the longest time of any job.
+*/
+
+void CancelToken::acknowledge()
+{
+    if (cancelled_.loadAcquire() != 0)
+    {
+        qint64 elapsed = clock_.nsecsElapsed();
+        qint64 longest = latency_.load();
+        while ((elapsed > longest) &&
+               (! latency_.testAndSetRelaxed(longest,elapsed,longest)));
+    }
+    if (parent_ != NULL) parent_->acknowledge();
+}
+//-----------------------------------------------------------------------------
+/** @brief Longest time from the cancel to a worker stopping
+
+@returns nanoseconds, or -1 if the token has not been cancelled.
+*/
+
+qint64 CancelToken::latency() const
+{
+    return latency_.load();
+}
@@ -0,0 +1,69 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef CANCEL_H
+#define CANCEL_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+
+//-----------------------------------------------------------------------------
+/** @brief Cancellation token of a batch or a job
+
+A token is cancelled from the thread that controls the batch and tested by the
+workers as they go, with no lock and no queued signal, so that a cancel takes
+effect at the next test whatever the event loops are doing. A job's token has
+the token of its batch as parent, and is cancelled when either is.
+
+Each worker acknowledges the cancel when it has stopped. The token keeps the
+longest time from the cancel to an acknowledgement, so that the time taken to
+stop a batch can be reported.
+*/
+
+class CancelToken
+{
+public:
+    CancelToken(CancelToken* parent = NULL);
+    void setParent(CancelToken* parent);
+    void reset();
+    void cancel();
+    bool isCancelled() const
+    {
+        return (cancelled_.loadAcquire() != 0) ||
+               ((parent_ != NULL) && parent_->isCancelled());
+    }
+    void acknowledge();
+    qint64 latency() const;
+private:
+    CancelToken* parent_;               //!< Token of the batch, or null.
+    QAtomicInt cancelled_;              //!< Set once cancelled.
+    QElapsedTimer clock_;               //!< Started when cancelled.
+    QAtomicInteger<qint64> latency_;    //!< Longest time to stop (ns).
+};
+
+#endif
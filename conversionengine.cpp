@@ -0,0 +1,986 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "conversionengine.h"
+#include <QSharedPointer>
+#include <QTimer>
+#include <QThread>
+#include <QFileInfo>
+
+// Jobs queued on the pool at a time for each worker
+const int JOBS_QUEUED_PER_WORKER = 2;
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The engine starts with one worker per core and the default segment length and
+block size. The writer thread is started and runs for the life of the engine.
+*/
+
+ConversionEngine::ConversionEngine(QObject* parent) : QObject(parent),
+            workerCount_(defaultWorkerCount()),
+            segmentLength_(DEFAULT_SEGMENT_LENGTH),
+            blockSize_(DEFAULT_BLOCK_SIZE),nextJob_(0),
+            framesDone_(0),bytesDone_(0),jobsRemaining_(0),outputsOpen_(0),
+            isRunning_(false),isStopping_(false),
+            returnCode_("OK"),isIncremental_(true),useContentHash_(false),
+            cache_(NULL),journal_(NULL),trace_(NULL),cancelLatency_(-1)
+{
+    ConversionProgress noProgress = {0,0,0,0};
+    lastProgress_ = noProgress;
+    connect(&writer_,SIGNAL(fileOpened(const QString&)),
+            this,SLOT(outputOpened()));
+    connect(&writer_,SIGNAL(fileClosed(const QString&,const QString&)),
+            this,SLOT(outputClosed(const QString&,const QString&)));
+    connect(&writer_,SIGNAL(fileDiscarded(const QString&)),
+            this,SLOT(outputDiscarded(const QString&)));
+    writer_.start();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+The jobs of any running batch are cancelled or dropped, and the running ones
+are allowed to stop before they are deleted. The batch is not ended, so nothing
+is signalled. The writer thread then finishes writing what it has been given.
+*/
+
+ConversionEngine::~ConversionEngine()
+{
+    batchCancel_.cancel();
+    dropQueuedJobs();
+    conversionPool_.waitForDone();
+    qDeleteAll(running_.keys());
+    qDeleteAll(retired_);
+    qDeleteAll(manifests_);
+    delete cache_;
+    delete journal_;
+    delete trace_;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Set the number of conversion workers
+
+@param[in] workers Number of conversions allowed to run at the same time.
+Values less than one select the default of one per core.
+*/
+
+void ConversionEngine::setWorkerCount(int workers)
+{
+    if (workers < 1) workers = defaultWorkerCount();
+    workerCount_ = workers;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of conversion workers
+*/
+
+int ConversionEngine::workerCount() const
+{
+    return workerCount_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the minimum length of the segments of a long file
+
+Files at least twice this length are split into segments that are encoded in
+parallel.
+@param[in] seconds Minimum segment length, or zero to never split files.
+*/
+
+void ConversionEngine::setSegmentLength(int seconds)
+{
+    if (seconds < 0) seconds = 0;
+    segmentLength_ = seconds;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the number of sample frames encoded at a time
+
+This applies to batches started after it is set.
+@param[in] blockSize Sample frames per block, or zero for the default.
+*/
+
+void ConversionEngine::setBlockSize(int blockSize)
+{
+    blockSize_ = validBlockSize(blockSize);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set when the output files are forced out to the disk
+
+@param[in] policy "never", "file" or a number of MB, see Mp3Writer.
+@returns false if the policy is not recognised.
+*/
+
+bool ConversionEngine::setFsyncPolicy(const QString& policy)
+{
+    return writer_.setFsyncPolicy(policy);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set whether outputs that are up to date are skipped
+
+When this is off every output is converted again, but the manifests are still
+brought up to date for the next batch.
+@param[in] isIncremental skip outputs that are up to date.
+*/
+
+void ConversionEngine::setIncremental(bool isIncremental)
+{
+    isIncremental_ = isIncremental;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set whether the content of the inputs is hashed
+
+By default an input is taken to be unchanged if its size and modification time
+are. This applies to conversions added after it is set.
+@param[in] useContentHash include a hash of the content in the fingerprints.
+*/
+
+void ConversionEngine::setContentHash(bool useContentHash)
+{
+    useContentHash_ = useContentHash;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the cache of encoded files
+
+This applies to batches started after it is set, and is ignored while a batch
+is running.
+@param[in] directory Directory holding the cache, or empty for no cache.
+@param[in] sizeMegabytes Limit on the size of the cache in MB.
+*/
+
+void ConversionEngine::setCache(const QString& directory, int sizeMegabytes)
+{
+    if (isRunning_) return;
+    if ((cache_ != NULL) && (cache_->directory() != directory))
+    {
+        delete cache_;
+        cache_ = NULL;
+    }
+    if (directory.isEmpty()) return;
+    if (cache_ == NULL) cache_ = new EncodeCache(directory,sizeMegabytes);
+    else cache_->setSizeLimit(sizeMegabytes);
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate if a cache of encoded files is in use
+*/
+
+bool ConversionEngine::hasCache() const
+{
+    return cache_ != NULL;
+}
+//-----------------------------------------------------------------------------
+/** @brief What the cache did during the last batch
+
+@returns the counts, all zero if there is no cache.
+*/
+
+EncodeCacheStatistics ConversionEngine::cacheStatistics() const
+{
+    if (cache_ != NULL) return cache_->statistics();
+    EncodeCacheStatistics statistics = {0,0,0,0,0};
+    return statistics;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the journal of the batches
+
+This is ignored while a batch is running.
+@param[in] fileName Journal file, or empty for no journal.
+*/
+
+void ConversionEngine::setJournal(const QString& fileName)
+{
+    if (isRunning_) return;
+    delete journal_;
+    journal_ = NULL;
+    if (! fileName.isEmpty()) journal_ = new BatchJournal(fileName);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the file the timeline of each batch is saved to
+
+Each batch overwrites the trace of the one before. This is ignored while a
+batch is running.
+@param[in] fileName Chrome trace event JSON file, or empty for no trace.
+*/
+
+void ConversionEngine::setTrace(const QString& fileName)
+{
+    if (isRunning_) return;
+    delete trace_;
+    trace_ = NULL;
+    if (! fileName.isEmpty()) trace_ = new ConversionTrace(fileName);
+    writer_.setTrace(trace_);
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that there is an unfinished batch in the journal
+*/
+
+bool ConversionEngine::canResume() const
+{
+    return (journal_ != NULL) && journal_->exists();
+}
+//-----------------------------------------------------------------------------
+/** @brief Add the unfinished conversions of the journalled batch
+
+The outputs completed before the batch was stopped are recorded in their
+manifests, as the batch did not get as far as doing so, and the rest are added
+as conversions again, grouped by input file. The options of each column are
+compiled again, once for all of its outputs. The batch is then started as
+usual.
+@param[out] numberInputs number of input files with unfinished outputs.
+@param[out] numberOutputs number of unfinished outputs.
+@returns "OK" or an error message.
+*/
+
+QString ConversionEngine::resume(int& numberInputs, int& numberOutputs)
+{
+    numberInputs = 0;
+    numberOutputs = 0;
+    if (journal_ == NULL) return "There is no batch to resume";
+    QList<JournalCell> cells;
+    QHash<QString,QByteArray> completed;
+    QString journalReturnCode = journal_->read(cells,completed);
+    if (journalReturnCode != "OK") return journalReturnCode;
+    QHash<QString,QByteArray>::const_iterator output;
+    for (output = completed.constBegin(); output != completed.constEnd();
+         ++output)
+    {
+        if (output.value().isEmpty()) continue;
+        QFileInfo outputInfo(output.key());
+        if (outputInfo.isFile())
+            manifest(outputInfo.absolutePath())->record(outputInfo.fileName(),
+                                                        output.value());
+    }
+    QHash<QString,LameSettingsPointer> columnSettings;
+    QStringList inputFiles;
+    QHash<QString,QList<ConversionOutput> > inputOutputs;
+    for (int n = 0; n < cells.size(); n++)
+    {
+        LameSettingsPointer settings = columnSettings.value(cells[n].lameOptions);
+        if (settings.isNull())
+        {
+            settings = LameSettingsPointer(
+                        new LameSettings(cells[n].lameOptions));
+            columnSettings.insert(cells[n].lameOptions,settings);
+        }
+        if (! settings->isValid())
+        {
+            setReturnCode(settings->returnCode());
+            continue;
+        }
+        if (! inputOutputs.contains(cells[n].inputFile))
+            inputFiles.append(cells[n].inputFile);
+        ConversionOutput conversionOutput;
+        conversionOutput.settings = settings;
+        conversionOutput.outputFile = cells[n].outputFile;
+        inputOutputs[cells[n].inputFile].append(conversionOutput);
+        numberOutputs++;
+    }
+    numberInputs = inputFiles.size();
+    for (int n = 0; n < inputFiles.size(); n++)
+        addConversion(inputFiles[n],inputOutputs.value(inputFiles[n]));
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Add the conversions of one input file to the batch
+
+The job for a file reads it once and feeds the samples to one LAME encoder for
+each output. A long file is split into segments that are encoded by separate
+jobs, so that it does not hold up the batch on one worker. Outputs that LAME
+resamples cannot be joined up and are converted by a single job for the whole
+file.
+
+An output that another conversion of the batch already writes is refused, as
+only one of them could survive. Outputs that are up to date are dropped next,
+so that a file with nothing to be done is not even opened. They are still
+entered in the job table, so that a later conversion that would overwrite one
+is refused as well. The manifest entries of the rest are removed until they
+have been written again.
+
+The conversions are entered in the job table, and the job objects are only
+made when the jobs are run. Conversions added while a batch is running join it,
+their jobs being queued after those already planned, unless the batch is being
+stopped, in which case they are ignored.
+@param[in] inputFile WAV file to be converted.
+@param[in] allOutputs mp3 outputs to be converted from the file.
+*/
+
+void ConversionEngine::addConversion(const QString& inputFile,
+                                     const QList<ConversionOutput>& allOutputs)
+{
+    if (isStopping_) return;
+    int firstJob = table_.numberJobs();
+    planConversion(inputFile,allOutputs);
+    if (isRunning_) joinBatch(firstJob);
+}
+//-----------------------------------------------------------------------------
+/** @brief Enter the conversions of one input file in the job table
+
+See addConversion().
+@param[in] inputFile WAV file to be converted.
+@param[in] allOutputs mp3 outputs to be converted from the file.
+*/
+
+void ConversionEngine::planConversion(const QString& inputFile,
+                                      const QList<ConversionOutput>& allOutputs)
+{
+    QList<ConversionOutput> outputs;
+    QList<QByteArray> outputPrints;
+    QByteArray inputPrint;
+    if (! allOutputs.isEmpty())
+        inputPrint = inputFingerprint(inputFile,useContentHash_);
+    for (int n = 0; n < allOutputs.size(); n++)
+    {
+        QString outputFile = allOutputs[n].outputFile;
+        bool isDuplicate = table_.hasOutput(outputFile);
+        for (int m = 0; m < outputs.size(); m++)
+            if (outputs[m].outputFile == outputFile) isDuplicate = true;
+        if (isDuplicate)
+        {
+            setReturnCode("Two conversions would write " + outputFile);
+            continue;
+        }
+        quint16 column = table_.addSettings(allOutputs[n].settings);
+        QFileInfo outputInfo(outputFile);
+        BuildManifest* outputManifest = manifest(outputInfo.absolutePath());
+        QByteArray outputPrint;
+        if (! inputPrint.isEmpty())
+        {
+            outputPrint = outputFingerprint(inputPrint,*allOutputs[n].settings);
+            if (isIncremental_ &&
+                outputManifest->isUpToDate(outputInfo.fileName(),outputPrint))
+            {
+                quint32 cell = table_.addCell(outputFile,column,QByteArray());
+                table_.setCellFlag(cell,CELL_SKIPPED);
+                emit outputSkipped(outputFile);
+                continue;
+            }
+        }
+        outputManifest->remove(outputInfo.fileName());
+        outputs.append(allOutputs[n]);
+        outputPrints.append(outputPrint);
+    }
+    if (outputs.isEmpty()) return;
+// A file that cannot be probed is left to its job to report, with no work
+    int segments = 1;
+    uint numberChannels = 0,bitsPerSample = 0,sampleRate = 0;
+    ulong numberFrames = 0;
+    if (Converter::probeWavFile(inputFile,numberChannels,bitsPerSample,
+                                sampleRate,numberFrames))
+        segments = segmentCount(numberFrames,sampleRate,segmentLength_,
+                                workerCount_);
+    TableJob job;
+    job.inputFrames = numberFrames;
+    job.cost = 0;
+    job.inputFile = table_.addInput(inputFile);
+    job.segment = 0;
+    job.segmentPlan = -1;
+    job.numberChannels = numberChannels;
+    job.bitsPerSample = bitsPerSample;
+// The cells of the whole file job are added first, then those of the segments
+    QList<ConversionOutput> splitOutputs;
+    QList<QByteArray> splitPrints;
+    job.firstCell = table_.numberCells();
+    for (int n = 0; n < outputs.size(); n++)
+    {
+        if ((segments > 1) && outputs[n].settings->canSplit(numberChannels,
+                                                            sampleRate))
+        {
+            splitOutputs.append(outputs[n]);
+            splitPrints.append(outputPrints[n]);
+        }
+        else table_.addCell(outputs[n].outputFile,
+                            table_.addSettings(outputs[n].settings),
+                            outputPrints[n]);
+    }
+    job.numberCells = table_.numberCells() - job.firstCell;
+    if (job.numberCells > 0) planJob(job);
+    if (splitOutputs.isEmpty()) return;
+    SegmentPlan plan;
+    plan.shared = QSharedPointer<SegmentedConversion>(
+                new SegmentedConversion(segments,splitOutputs));
+    plan.segmentFrames =                    // whole number of blocks
+                numberFrames/segments/MP3_FRAME_SAMPLES*MP3_FRAME_SAMPLES;
+    plan.numberSegments = segments;
+    job.segmentPlan = table_.addSegmentPlan(plan);
+    job.firstCell = table_.numberCells();
+    for (int n = 0; n < splitOutputs.size(); n++)
+        table_.addCell(splitOutputs[n].outputFile,
+                       table_.addSettings(splitOutputs[n].settings),
+                       splitPrints[n]);
+    job.numberCells = splitOutputs.size();
+    for (int segment = 0; segment < segments; segment++)
+    {
+        job.segment = segment;
+        planJob(job);
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Enter a job in the job table
+
+The cost of the job is the sample frames it encodes weighted by the channels
+and by the settings of each output, with an allowance for opening and closing
+the files, so that the jobs can be started longest first.
+@param[in] job Job with its cells already in the table.
+*/
+
+void ConversionEngine::planJob(TableJob& job)
+{
+    quint64 frames,bytes;
+    jobWork(job,frames,bytes);
+    double weight = 0;
+    for (quint32 cell = job.firstCell; cell < job.firstCell + job.numberCells;
+         cell++)
+        weight += table_.settings(table_.cell(cell).column)->costWeight();
+    job.cost = (double)frames/job.numberCells*job.numberChannels*weight +
+               JOB_COST_OVERHEAD*job.numberCells;
+    table_.addJob(job,frames,bytes);
+}
+//-----------------------------------------------------------------------------
+/** @brief The work a job has to do, for all of its outputs
+
+@param[in] job Job in the job table.
+@param[out] frames Sample frames to be encoded.
+@param[out] bytes Bytes of WAV data to be encoded.
+*/
+
+void ConversionEngine::jobWork(const TableJob& job, quint64& frames,
+                               quint64& bytes) const
+{
+    ulong readStart,readEnd;
+    if (job.segmentPlan < 0)
+        segmentReadRange(job.inputFrames,0,job.inputFrames,true,true,
+                         readStart,readEnd);
+    else
+    {
+        const SegmentPlan& plan = table_.segmentPlan(job.segmentPlan);
+        ulong firstFrame = job.segment*plan.segmentFrames;
+        segmentReadRange(job.inputFrames,firstFrame,
+                         firstFrame + plan.segmentFrames,job.segment == 0,
+                         job.segment == plan.numberSegments-1,
+                         readStart,readEnd);
+    }
+    frames = (quint64)(readEnd - readStart)*job.numberCells;
+    bytes = frames*(job.numberChannels*job.bitsPerSample/8);
+}
+//-----------------------------------------------------------------------------
+/** @brief Record an error found while setting up the batch
+
+The first error of the batch is the one reported when it finishes.
+@param[in] returnCode error message.
+*/
+
+void ConversionEngine::setReturnCode(const QString& returnCode)
+{
+    if (returnCode_ == "OK") returnCode_ = returnCode;
+}
+//-----------------------------------------------------------------------------
+/** @brief Start the batch
+
+The jobs are put in order, longest first, and the first of them are queued on
+the worker pool, and this returns straight away. The rest are queued as the
+first finish. The finished() signal is emitted when all jobs are done,
+including the case where there are no jobs at all, in which case it is emitted
+from the event loop.
+
+The manifests are saved first without the outputs about to be written, so that
+an output left unfinished by a crash is not taken to be up to date, and the
+outputs of the batch are written to the journal.
+@returns false if a batch is already running.
+*/
+
+bool ConversionEngine::start()
+{
+    if (isRunning_) return false;
+    isRunning_ = true;
+    if (trace_ != NULL)
+    {
+        trace_->start();
+        trace_->nameThread(QThread::currentThread(),"engine");
+        trace_->nameThread(&writer_,"writer");
+    }
+    saveManifests();
+    if (journal_ != NULL)
+    {
+        QString journalReturnCode = journal_->begin();
+        journalJobs(0);
+        if (journalReturnCode == "OK") journalReturnCode = journal_->commit();
+        if (journalReturnCode != "OK") setReturnCode(journalReturnCode);
+    }
+    if (cache_ != NULL)
+    {
+        cache_->resetStatistics();
+        QString cacheReturnCode = cache_->load();
+        if (cacheReturnCode != "OK") setReturnCode(cacheReturnCode);
+    }
+    conversionPool_.setMaxThreadCount(workerCount_);
+    batchCancel_.reset();
+    cancelLatency_ = -1;
+    isStopping_ = false;
+/* The jobs are queued longest first, so that a long file added late does not
+leave one worker busy at the end of the batch while the rest stand idle. */
+    table_.sortByCost();
+    jobsRemaining_ = table_.numberJobs();
+    nextJob_ = 0;
+    if (jobsRemaining_ == 0)
+    {
+        QTimer::singleShot(0,this,SLOT(jobFinished()));
+        return true;
+    }
+    dispatchJobs();
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Write the outputs of jobs of the table to the journal
+
+@param[in] firstJob First job to be journalled, the rest following it.
+*/
+
+void ConversionEngine::journalJobs(int firstJob)
+{
+    for (int n = firstJob; n < table_.numberJobs(); n++)
+    {
+// The segments of a file share its cells, which are journalled once
+        const TableJob& job = table_.job(n);
+        if (job.segment > 0) continue;
+        JournalCell journalCell;
+        journalCell.inputFile = table_.inputFile(job.inputFile);
+        for (quint32 cell = job.firstCell;
+             cell < job.firstCell + job.numberCells; cell++)
+        {
+            journalCell.outputFile = table_.outputFile(cell);
+            journalCell.lameOptions =
+                    table_.settings(table_.cell(cell).column)->options();
+            journal_->addCell(journalCell);
+        }
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Add jobs planned while the batch runs to the batch
+
+The jobs are journalled and counted, and are queued in the order they were
+added as workers come free, behind those already planned.
+@param[in] firstJob First of the jobs added, the rest following it.
+*/
+
+void ConversionEngine::joinBatch(int firstJob)
+{
+    if (journal_ != NULL) journalJobs(firstJob);
+    jobsRemaining_ += table_.numberJobs() - firstJob;
+    dispatchJobs();
+}
+//-----------------------------------------------------------------------------
+/** @brief Queue jobs on the pool until it has enough to keep the workers busy
+
+Only a few jobs for each worker are made and queued at a time, so that the
+memory taken by job objects does not grow with the size of the batch.
+*/
+
+void ConversionEngine::dispatchJobs()
+{
+    int queued = workerCount_*JOBS_QUEUED_PER_WORKER;
+    while ((nextJob_ < table_.numberJobs()) && (running_.size() < queued))
+    {
+        int n = nextJob_++;
+        Converter* job = createJob(table_.job(n));
+        running_.insert(job,n);
+        conversionPool_.start(job);
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Make the job object of a job in the table
+
+The outputs of the job are noted, so that the files reported by the writer
+thread can be matched to their cells.
+@param[in] planned Job in the job table.
+@returns the job, ready to be queued.
+*/
+
+Converter* ConversionEngine::createJob(const TableJob& planned)
+{
+    Converter* job = new Converter;
+    job->setInputFileName(table_.inputFile(planned.inputFile));
+    job->setBlockSize(blockSize_);
+    job->setWriter(&writer_);
+    job->setCache(cache_);
+    job->setTrace(trace_);
+    job->setBatchCancel(&batchCancel_);
+    for (quint32 cell = planned.firstCell;
+         cell < planned.firstCell + planned.numberCells; cell++)
+    {
+        QString outputFile = table_.outputFile(cell);
+        job->addOutput(table_.settings(table_.cell(cell).column),outputFile);
+        openCells_.insert(outputFile,cell);
+    }
+    if (planned.segmentPlan >= 0)
+    {
+        const SegmentPlan& plan = table_.segmentPlan(planned.segmentPlan);
+        ulong firstFrame = planned.segment*plan.segmentFrames;
+        job->setSegment(plan.shared,planned.segment,firstFrame,
+                        firstFrame + plan.segmentFrames,
+                        planned.segment == plan.numberSegments-1);
+    }
+    job->planWork(planned.inputFrames,planned.numberChannels,
+                  planned.bitsPerSample);
+    connect(job,SIGNAL(outputCached(const QString&)),
+            this,SLOT(outputFromCache(const QString&)));
+    connect(job,SIGNAL(finished()),this,SLOT(jobFinished()));
+    return job;
+}
+//-----------------------------------------------------------------------------
+/** @brief Take the results of a job that is done with
+
+The first error is kept as the return code of the batch and the outputs of a
+job that failed are marked, so that they are not recorded as up to date. The
+cache keys of a job that succeeded are kept to store its outputs in the cache.
+The job is kept until its worker is known to be done with it.
+@param[in] job Job that has finished or been dropped.
+*/
+
+void ConversionEngine::retireJob(Converter* job)
+{
+    QString jobReturnCode = job->getReturnCode();
+    if (jobReturnCode == "OK")
+    {
+        if (cache_ != NULL) cacheKeys_.unite(job->cacheKeys());
+    }
+    else
+    {
+        setReturnCode(jobReturnCode);
+        const TableJob& planned = table_.job(running_.value(job));
+        for (quint32 cell = planned.firstCell;
+             cell < planned.firstCell + planned.numberCells; cell++)
+            table_.setCellFlag(cell,CELL_FAILED);
+    }
+    framesDone_ += job->progress().framesDone();
+    bytesDone_ += job->progress().bytesDone();
+    running_.remove(job);
+    retired_.append(job);
+    jobsRemaining_--;
+}
+//-----------------------------------------------------------------------------
+/** @brief Delete the jobs that their workers are done with
+*/
+
+void ConversionEngine::deleteFinishedJobs()
+{
+    for (int n = retired_.size()-1; n >= 0; n--)
+        if (retired_[n]->isFinished()) delete retired_.takeAt(n);
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate if a batch is running
+*/
+
+bool ConversionEngine::isRunning() const
+{
+    return isRunning_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Progress of the batch
+
+This only reads the counters of the running jobs and the totals kept for the
+rest, and may be called as often as the display is to be updated. Between
+batches it gives the progress at the end of the last batch.
+*/
+
+ConversionProgress ConversionEngine::progress() const
+{
+    if (! isRunning_) return lastProgress_;
+    ConversionProgress total = {framesDone_,table_.framesTotal(),
+                                bytesDone_,table_.bytesTotal()};
+    QHash<Converter*,int>::const_iterator job;
+    for (job = running_.constBegin(); job != running_.constEnd(); ++job)
+    {
+        const ProgressCounters& counters = job.key()->progress();
+        total.framesDone += counters.framesDone();
+        total.bytesDone += counters.bytesDone();
+    }
+    return total;
+}
+//-----------------------------------------------------------------------------
+/** @brief Cancel the batch
+
+The batch token is cancelled, so running jobs stop at their next test of it,
+which comes at least once for every output of every block. Jobs not yet taken
+by a worker are dropped. The finished() signal still follows in due course.
+*/
+
+void ConversionEngine::cancel()
+{
+    if (! isRunning_) return;
+    isStopping_ = true;
+    setReturnCode("Conversion cancelled");
+    batchCancel_.cancel();
+    dropQueuedJobs();
+    batchCancel_.acknowledge();
+    checkBatchEnd();
+}
+//-----------------------------------------------------------------------------
+/** @brief Time taken to stop the last batch that was cancelled
+
+This runs from the cancel until the queued jobs had been dropped and the last
+running job had stopped.
+@returns milliseconds, or -1 if the last batch was not cancelled.
+*/
+
+double ConversionEngine::cancelLatency() const
+{
+    return cancelLatency_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Stop the batch once the running jobs are done
+
+Jobs that have not been started are taken off the queue and dropped, while the
+running jobs are left to finish their files. The segments of a long file that
+was not completed are discarded, so no output is left partly written. The
+finished() signal follows when the running jobs are done.
+*/
+
+void ConversionEngine::drain()
+{
+    if (! isRunning_) return;
+    isStopping_ = true;
+    setReturnCode("Conversion interrupted");
+    dropQueuedJobs();
+    checkBatchEnd();
+}
+//-----------------------------------------------------------------------------
+/** @brief Drop the jobs that no worker has taken
+
+The queue of the pool is cleared in one go rather than job by job, which would
+search the queue for each job. A worker may have taken a job off the queue
+just before it was cleared, so each job is claimed from its worker as well,
+and only the jobs that the engine claims are counted off here. The pool runs
+nothing else, and it does not own the jobs. The jobs in the table that were
+never queued are counted off without being made.
+*/
+
+void ConversionEngine::dropQueuedJobs()
+{
+    conversionPool_.clear();
+    QList<Converter*> queued = running_.keys();
+    for (int n = 0; n < queued.size(); n++)
+        if (queued[n]->drop()) retireJob(queued[n]);
+    for (; nextJob_ < table_.numberJobs(); nextJob_++)
+    {
+        quint64 frames,bytes;
+        jobWork(table_.job(nextJob_),frames,bytes);
+        framesDone_ += frames;
+        bytesDone_ += bytes;
+        jobsRemaining_--;
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Count off a finished job
+
+This is delivered through the event loop as each job finishes. The next jobs
+are queued in its place, and the jobs that are done with are deleted.
+*/
+
+void ConversionEngine::jobFinished()
+{
+    Converter* job = qobject_cast<Converter*>(sender());
+    if ((job != NULL) && running_.contains(job))
+    {
+        retireJob(job);
+        deleteFinishedJobs();
+        dispatchJobs();
+    }
+    checkBatchEnd();
+}
+//-----------------------------------------------------------------------------
+/** @brief Count an output file opened by a job
+
+A job opens its files before it signals that it has finished, so all of its
+files have been counted by the time its finished signal is delivered.
+*/
+
+void ConversionEngine::outputOpened()
+{
+    outputsOpen_++;
+}
+//-----------------------------------------------------------------------------
+/** @brief Count off an output file closed by the writer thread
+
+The outcome for the file is passed on to anyone following the progress of the
+batch file by file.
+@param[in] fileName File that has been written.
+@param[in] returnCode error in writing the file, or "OK".
+*/
+
+void ConversionEngine::outputClosed(const QString& fileName,
+                                    const QString& returnCode)
+{
+    if (outputsOpen_ > 0) outputsOpen_--;
+    QHash<QString,quint32>::iterator cell = openCells_.find(fileName);
+    if (returnCode != "OK") setReturnCode(returnCode + " " + fileName);
+    else if (cell != openCells_.end())
+    {
+        table_.setCellFlag(cell.value(),CELL_WRITTEN);
+        if (journal_ != NULL)
+            journal_->markDone(fileName,table_.fingerprint(cell.value()));
+    }
+    if (cell != openCells_.end()) openCells_.erase(cell);
+    emit outputFinished(fileName,returnCode);
+    checkBatchEnd();
+}
+//-----------------------------------------------------------------------------
+/** @brief Count an output placed from the cache by a job
+
+The output is complete and is treated as one that has been written.
+@param[in] fileName File that has been placed.
+*/
+
+void ConversionEngine::outputFromCache(const QString& fileName)
+{
+    QHash<QString,quint32>::iterator cell = openCells_.find(fileName);
+    if (cell != openCells_.end())
+    {
+        table_.setCellFlag(cell.value(),CELL_WRITTEN);
+        if (journal_ != NULL)
+            journal_->markDone(fileName,table_.fingerprint(cell.value()));
+        openCells_.erase(cell);
+    }
+    emit outputCached(fileName);
+}
+//-----------------------------------------------------------------------------
+/** @brief Count off an output file dropped by the writer thread
+
+The job that dropped the file reports why. Any earlier file of the same name is
+left as it was.
+@param[in] fileName File that has been dropped.
+*/
+
+void ConversionEngine::outputDiscarded(const QString& fileName)
+{
+    if (outputsOpen_ > 0) outputsOpen_--;
+    openCells_.remove(fileName);
+    emit outputFinished(fileName,"Discarded");
+    checkBatchEnd();
+}
+//-----------------------------------------------------------------------------
+/** @brief End the batch once all jobs are done and all files written
+*/
+
+void ConversionEngine::checkBatchEnd()
+{
+    if (isRunning_ && (jobsRemaining_ == 0) && (outputsOpen_ == 0))
+        endBatch();
+}
+//-----------------------------------------------------------------------------
+/** @brief End the batch
+
+The first error of any job is taken as the return code of the batch. An output
+is recorded in its manifest only if it was written without error by jobs that
+all succeeded, as a job that failed or was cancelled may still have closed its
+files. The same goes for the outputs added to the cache, after which the cache is
+brought back within its size limit. The journal is removed if the batch
+finished without error, and otherwise kept for it to be resumed, and any trace
+of the batch is saved. The jobs and the job table are cleared and the engine is
+made ready for the next batch. All jobs have signalled by now, so waiting for
+the pool only lets the workers step out of the last job.
+*/
+
+void ConversionEngine::endBatch()
+{
+    conversionPool_.waitForDone();
+    qDeleteAll(retired_);
+    retired_.clear();
+    lastProgress_ = progress();
+    if (batchCancel_.latency() >= 0)
+        cancelLatency_ = batchCancel_.latency()/1e6;
+    for (int cell = 0; cell < table_.numberCells(); cell++)
+    {
+        quint8 flags = table_.cell(cell).flags;
+        if ((! (flags & CELL_WRITTEN)) || (flags & CELL_FAILED)) continue;
+        QString outputFile = table_.outputFile(cell);
+        if (cache_ != NULL)
+        {
+            QByteArray cacheKey = cacheKeys_.value(outputFile);
+            if (! cacheKey.isEmpty()) cache_->store(cacheKey,outputFile);
+        }
+        if (! (flags & CELL_HAS_FINGERPRINT)) continue;
+        QFileInfo outputInfo(outputFile);
+        manifest(outputInfo.absolutePath())->record(outputInfo.fileName(),
+                                                    table_.fingerprint(cell));
+    }
+    if (cache_ != NULL)
+    {
+        cache_->evict();
+        QString cacheReturnCode = cache_->save();
+        if (cacheReturnCode != "OK") setReturnCode(cacheReturnCode);
+    }
+    saveManifests();
+    qDeleteAll(manifests_);
+    manifests_.clear();
+    table_.clear();
+    openCells_.clear();
+    cacheKeys_.clear();
+    framesDone_ = 0;
+    bytesDone_ = 0;
+    nextJob_ = 0;
+    if (journal_ != NULL) journal_->end(returnCode_ == "OK");
+    if (trace_ != NULL)
+    {
+        trace_->addSpan("batch",QString(),0,trace_->now());
+        QString traceReturnCode = trace_->save();
+        if (traceReturnCode != "OK") setReturnCode(traceReturnCode);
+    }
+    QString returnCode = returnCode_;
+    returnCode_ = "OK";
+    isRunning_ = false;
+    isStopping_ = false;
+    emit finished(returnCode);
+}
+//-----------------------------------------------------------------------------
+/** @brief The manifest of an output directory
+
+The manifest is read the first time the directory is met in a batch.
+@param[in] directory absolute path of the output directory.
+*/
+
+BuildManifest* ConversionEngine::manifest(const QString& directory)
+{
+    BuildManifest* outputManifest = manifests_.value(directory);
+    if (outputManifest == NULL)
+    {
+        outputManifest = new BuildManifest(directory);
+        QString manifestReturnCode = outputManifest->load();
+        if (manifestReturnCode != "OK") setReturnCode(manifestReturnCode);
+        manifests_.insert(directory,outputManifest);
+    }
+    return outputManifest;
+}
+//-----------------------------------------------------------------------------
+/** @brief Write back the manifests that have changed
+*/
+
+void ConversionEngine::saveManifests()
+{
+    QHash<QString,BuildManifest*>::const_iterator entry;
+    for (entry = manifests_.constBegin(); entry != manifests_.constEnd(); ++entry)
+    {
+        QString manifestReturnCode = entry.value()->save();
+        if (manifestReturnCode != "OK") setReturnCode(manifestReturnCode);
+    }
+}
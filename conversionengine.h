@@ -0,0 +1,182 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef CONVERSIONENGINE_H
+#define CONVERSIONENGINE_H
+
+#include <QObject>
+#include <QThreadPool>
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include "converter.h"
+#include "mp3writer.h"
+#include "manifest.h"
+#include "encodecache.h"
+#include "journal.h"
+#include "trace.h"
+#include "cancel.h"
+#include "jobtable.h"
+
+//-----------------------------------------------------------------------------
+/** @brief Conversion engine
+
+The conversion engine runs a batch of conversions asynchronously. Conversions
+are added for each input file with the list of its outputs, and are planned into
+jobs when added, with long files being split into segments. The header of each
+input is read as it is planned, and each job is given a cost from the length
+and channels of its input and the settings of its outputs. The jobs are held in
+a compact job table, and an output that two conversions would write is refused
+when the second is added. When the batch is started the jobs are put in order,
+longest first, and control returns to the caller's event loop straight away.
+Conversions added while the batch runs join it behind the jobs already planned.
+The job objects are only made as the jobs are queued on a pool of worker
+threads, a few for each worker at a time, and are deleted once they are done,
+so that a batch of many thousands of outputs takes little memory.
+
+Each job signals when it has finished and the engine counts them off, so that
+nothing is spent on polling. The progress of the jobs is kept in counters that
+the jobs bump as they go and that the caller samples with progress() as often
+as it wants to update its display, so that progress costs the workers nothing
+but a few atomic adds per block. The output files are written by a writer thread
+owned by the engine, which signals as each file is opened and closed. When the
+last job is done and the last file closed the engine signals the end of the
+batch with the first error that occurred, or "OK".
+
+Builds are incremental: an output whose fingerprint is recorded as up to date
+in the manifest of its directory is skipped when its conversion is added, and
+the outputs that are written without error are recorded when the batch ends.
+Where a cache of encoded files is set, outputs held in it are placed by the
+jobs instead of being encoded, and the outputs encoded are added to it when the
+batch ends.
+
+Where a journal is set, the outputs of the batch and each output as it is
+completed are recorded in it, so that a batch that is cancelled or cut short by
+a crash can be resumed with only its unfinished outputs.
+
+A cancel is passed to the jobs through a token that the workers test on their
+hot path, with no queued signal, and the jobs that no worker has taken yet are
+dropped from the queue in one pass however many there are. The time from the
+cancel until the last running job stopped is kept for the caller to report.
+
+Where a trace file is set, the work of each job and of the writer thread is
+recorded as a timeline and saved to it when the batch ends.
+
+The engine has no dependence on the GUI.
+*/
+
+class ConversionEngine : public QObject
+{
+    Q_OBJECT
+public:
+    ConversionEngine(QObject* parent = 0);
+    ~ConversionEngine();
+    void setWorkerCount(int workers);
+    int workerCount() const;
+    void setSegmentLength(int seconds);
+    void setBlockSize(int blockSize);
+    bool setFsyncPolicy(const QString& policy);
+    void setIncremental(bool isIncremental);
+    void setContentHash(bool useContentHash);
+    void setCache(const QString& directory, int sizeMegabytes);
+    bool hasCache() const;
+    EncodeCacheStatistics cacheStatistics() const;
+    void setJournal(const QString& fileName);
+    bool canResume() const;
+    QString resume(int& numberInputs, int& numberOutputs);
+    void setTrace(const QString& fileName);
+    void addConversion(const QString& inputFile,
+                       const QList<ConversionOutput>& outputs);
+    void setReturnCode(const QString& returnCode);
+    bool start();
+    bool isRunning() const;
+    ConversionProgress progress() const;
+    double cancelLatency() const;
+public slots:
+    void cancel();
+    void drain();
+signals:
+    void finished(const QString& returnCode);       // Batch is complete
+    void outputFinished(const QString& fileName,    // Output file written
+                        const QString& returnCode);
+    void outputSkipped(const QString& fileName);    // Output is up to date
+    void outputCached(const QString& fileName);     // Output placed from cache
+private slots:
+    void jobFinished();
+    void outputOpened();
+    void outputClosed(const QString& fileName, const QString& returnCode);
+    void outputFromCache(const QString& fileName);
+    void outputDiscarded(const QString& fileName);
+private:
+    void planConversion(const QString& inputFile,
+                        const QList<ConversionOutput>& allOutputs);
+    void planJob(TableJob& job);
+    void jobWork(const TableJob& job, quint64& frames, quint64& bytes) const;
+    void journalJobs(int firstJob);
+    void joinBatch(int firstJob);
+    void dispatchJobs();
+    Converter* createJob(const TableJob& planned);
+    void retireJob(Converter* job);
+    void deleteFinishedJobs();
+    void dropQueuedJobs();
+    void checkBatchEnd();
+    void endBatch();
+    BuildManifest* manifest(const QString& directory);
+    void saveManifests();
+    Mp3Writer writer_;                  //!< Thread writing the output files.
+    QThreadPool conversionPool_;        //!< Workers running the conversions.
+    int workerCount_;                   //!< Number of conversion workers.
+    uint segmentLength_;                //!< Minimum segment length (s).
+    uint blockSize_;                    //!< Sample frames encoded per call.
+    JobTable table_;                    //!< Jobs and outputs of the batch.
+    int nextJob_;                       //!< First job of the table not queued.
+    QHash<Converter*,int> running_;     //!< Queued jobs and their table index.
+    QList<Converter*> retired_;         //!< Done with, awaiting their worker.
+//! Cells of the outputs of the queued jobs, by output file.
+    QHash<QString,quint32> openCells_;
+//! Cache keys of the outputs encoded by jobs that succeeded.
+    QHash<QString,QByteArray> cacheKeys_;
+    quint64 framesDone_;                //!< Frames of jobs done with.
+    quint64 bytesDone_;                 //!< Bytes of jobs done with.
+    int jobsRemaining_;                 //!< Jobs not yet finished.
+    int outputsOpen_;                   //!< Output files not yet closed.
+    bool isRunning_;                    //!< A batch has been started.
+    bool isStopping_;                   //!< Batch is cancelled or drained.
+    QString returnCode_;                //!< First error of the batch.
+    bool isIncremental_;                //!< Skip outputs that are up to date.
+    bool useContentHash_;               //!< Fingerprint the input content.
+//! Manifests of the output directories of the batch, by directory.
+    QHash<QString,BuildManifest*> manifests_;
+    EncodeCache* cache_;                //!< Cache of encoded files, or null.
+    BatchJournal* journal_;             //!< Journal of the batch, or null.
+    ConversionTrace* trace_;            //!< Timeline of the batch, or null.
+    ConversionProgress lastProgress_;   //!< Progress at the end of the batch.
+    CancelToken batchCancel_;           //!< Cancels every job of the batch.
+    double cancelLatency_;              //!< Time taken to stop the last batch.
+};
+
+#endif
@@ -0,0 +1,892 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "converter.h"
+#include "wavreader.h"
+#include "pcmconvert.h"
+#include <QSaveFile>
+#include <QBuffer>
+#include <QThread>
+#include <QString>
+#include <QMutexLocker>
+
+static bool trimFrames(QByteArray& stream, int dropFrames, int keepFrames);
+static bool commitOutput(QIODevice* outDevice);
+static void fetchFromCache(EncodeCache* cache, const QString& inputFile,
+                           QList<ConversionOutput>& outputs,
+                           QHash<QString,QByteArray>& keys,
+                           QStringList& cached);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The job is not deleted by the thread pool when it finishes, as the caller
+collects its return code afterwards.
+*/
+
+Converter::Converter() : returnCode_("OK"),state_(JOB_QUEUED),
+                         blockSize_(DEFAULT_BLOCK_SIZE),writer_(NULL),
+                         cache_(NULL),trace_(NULL),
+                         segment_(0),firstFrame_(0),endFrame_(0),
+                         isLastSegment_(true)
+{
+    setAutoDelete(false);
+}
+//-----------------------------------------------------------------------------
+/** @brief Job body run by a worker thread of the conversion pool
+
+The conversion is done, then a signal is emitted so that the caller can count
+off its jobs as they complete. The worker first claims the job, and a job that
+the engine has already dropped returns at once without signalling, as the
+engine has counted it off. A job that is only reached after the conversions
+have been cancelled returns without doing any work. Outputs that can be placed
+from the cache are taken off the job first, and a job left with none has
+nothing to convert. Whatever the outcome, the job's progress is complete once
+it has finished. Marking the job finished is the last thing it does, after which
+its owner may delete it.
+*/
+
+void Converter::run()
+{
+    if (! state_.testAndSetOrdered(JOB_QUEUED,JOB_RUNNING)) return;
+    if (! cancel_.isCancelled())
+    {
+        TraceSpan jobSpan(trace_,segments_.isNull() ? "job" : "segment",
+                          inputFile_);
+        if (cache_ != NULL) fetchCachedOutputs();
+        if (! outputs_.isEmpty()) convertFile();
+    }
+    if (cancel_.isCancelled()) cancel_.acknowledge();
+    progress_.complete();
+    emit finished();
+    state_.storeRelease(JOB_FINISHED);
+}
+//-----------------------------------------------------------------------------
+/** @brief Place the outputs that are held in the cache
+
+The outputs of the segments of a long file are looked up only once, by the
+first segment to run, and all segments are left with the same outputs.
+*/
+
+void Converter::fetchCachedOutputs()
+{
+    TraceSpan cacheSpan(trace_,"cache");
+    QStringList cached;
+    if (segments_.isNull())
+        fetchFromCache(cache_,inputFile_,outputs_,cacheKeys_,cached);
+    else outputs_ = segments_->fetchCachedOutputs(cache_,inputFile_,
+                                                  cacheKeys_,cached);
+    for (int n = 0; n < cached.size(); n++) emit outputCached(cached[n]);
+}
+//-----------------------------------------------------------------------------
+/** @brief Conversion member function to convert a single file
+
+A number of quantities must be setup before the job is started to identify the
+file and the LAME options for each of its outputs.
+
+Setup the data buffers, open the files, and start conversion block by block.
+Though mp3 has a block structure, we don't need to be concerned about it. We
+only do conversion in blocks to minimize memory use and to allow the progress to
+be monitored and cancelled if necessary.
+
+The input file is read and converted to PCM samples only once. Each block is
+then passed in turn to the LAME encoder of every output, so that the cost of
+reading the file is the same however many columns it is converted for.
+
+When the job covers a segment of a long file, the encoding starts a little
+before the segment and runs on a little past it so that the encoder has settled
+at each join. The frames encoded from the overlap are then dropped and the
+remaining frames are handed to the shared SegmentedConversion object.
+*/
+
+void Converter::convertFile()
+{
+    QVector<short> inputBuffer(2*blockSize_);   // PCM sample block buffer
+    short* leftBuffer = inputBuffer.data();
+    short* rightBuffer = leftBuffer + blockSize_;
+    int outputBufferSize = mp3BufferSize(blockSize_);
+    QVector<uchar> outputBufferStore(outputBufferSize);
+    uchar* outputBuffer = outputBufferStore.data(); // mp3 block output buffer
+/** The WAVE file header is checked and only certain parameters are allowed,
+namely 1 or 2 channels, and 8, 16 or 24 bit samples. The reader maps the samples
+into memory where it can, so that each block is taken straight from the
+mapping. Compute the number of input blocks for the loop, and pass the
+blocksize in samples to the mp3 conversion, ensuring that the last blocksize is
+computed correctly as the leftover part of a full block. */
+    TraceSpan headerSpan(trace_,"header");
+    WavReader reader;
+    QString readerReturnCode = reader.open(inputFile_);
+    if (readerReturnCode != "OK")
+    {
+        returnCode_ = readerReturnCode;
+        return;
+    }
+    uint numberChannels = reader.numberChannels();
+    uint bitsPerSample = reader.bitsPerSample();
+    uint sampleRate = reader.sampleRate();
+    ulong inputFrames = reader.numberFrames();
+// Work out the part of the file to be read, including any overlap
+    ulong readStart,readEnd;
+    readRange(inputFrames,readStart,readEnd);
+    if (! segments_.isNull())
+    {
+        if (! reader.seekFrame(readStart))
+        {
+            returnCode_ = "Corrupted WAV File. Premature EOF";
+            return;
+        }
+    }
+    headerSpan.end();
+/** A LAME encoder and an output device are set up for each column. A whole file
+goes straight to the output file through the writer thread, while a segment is
+held in memory until all segments are done. A column that cannot be set up is
+dropped and the remaining columns are still converted. */
+    TraceSpan openSpan(trace_,"open");
+    int numberOutputs = outputs_.size();
+    QList<lame_global_flags*> gfp;
+    QList<QIODevice*> outDevices;
+    QList<QByteArray> parts;
+    for (int n = 0; n < numberOutputs; n++) parts.append(QByteArray());
+    for (int n = 0; n < numberOutputs; n++)
+    {
+        QString lameReturnCode = "OK";
+        lame_global_flags* flags =
+                    outputs_[n].settings->createFlags(lameReturnCode);
+        QIODevice* outDevice = 0;
+        if (flags != NULL)
+        {
+            lame_set_num_channels(flags,numberChannels);
+            lame_set_in_samplerate(flags,sampleRate);
+/* Segments are joined frame by frame, so each must be free of the bit
+reservoir of the frames dropped before it. Only CBR outputs are split, which
+need no tag frame, so none is written into the segments. */
+            if (! segments_.isNull())
+            {
+                lame_set_bWriteVbrTag(flags,0);
+                if (segment_ > 0) lame_set_disable_reservoir(flags,1);
+            }
+            if (lame_init_params(flags) < 0)
+                lameReturnCode = "Parameter Error";
+        }
+        if (lameReturnCode == "OK")
+        {
+            if (! segments_.isNull()) outDevice = new QBuffer(&parts[n]);
+            else if (writer_ != NULL)
+                outDevice = new Mp3OutputStream(writer_,outputs_[n].outputFile);
+            else outDevice = new QSaveFile(outputs_[n].outputFile);
+            if (! outDevice->open(QIODevice::WriteOnly))
+            {
+                lameReturnCode = "Could not open an output file.";
+                delete outDevice;
+                outDevice = 0;
+            }
+        }
+        if (lameReturnCode != "OK")
+        {
+            returnCode_ = lameReturnCode;
+            if (flags != NULL) lame_close(flags);
+            flags = NULL;
+        }
+        gfp.append(flags);
+        outDevices.append(outDevice);
+    }
+    openSpan.end();
+    ulong inputBlocks = readEnd - readStart;
+// Split input into blocks
+    uint numBlocks = (inputBlocks/blockSize_)+1;
+    uint bytesPerFrame = reader.bytesPerFrame();
+    bool isInputComplete = true;
+    for (uint call=0; call<numBlocks; call++)
+    {
+        uint blockSize = blockSize_;            // Last block may be smaller
+        if (call == numBlocks-1) blockSize=
+                                    inputBlocks-blockSize*(numBlocks-1);
+        TraceSpan readSpan(trace_,"read");
+        const uchar* samples = reader.readFrames(blockSize);
+        if (samples == NULL)
+        {
+            returnCode_ = "Corrupted WAV File. Premature EOF";
+            isInputComplete = false;
+            break;                              // Premature end
+        }
+/** 16 bit samples are already in the form LAME wants on a little-endian host,
+so they are passed to it straight from the reader, interleaved for stereo.
+This saves a copy and a pass over every sample. Other formats are first
+converted into a buffer for each channel. */
+        const short* pcm = NULL;
+        if ((bitsPerSample == 16) && (Q_BYTE_ORDER == Q_LITTLE_ENDIAN) &&
+            (((quintptr) samples & 1) == 0))
+            pcm = (const short*) samples;
+        else convertPcm(samples, leftBuffer, rightBuffer,
+                        numberChannels, bitsPerSample, blockSize);
+        readSpan.end();
+        TraceSpan encodeSpan(trace_,"encode");
+        for (int n = 0; n < numberOutputs; n++)
+        {
+            if (outDevices[n] == 0) continue;   // Column has been dropped
+            if (cancel_.isCancelled()) break;   // Stop between outputs
+            int buffSize;
+            if (pcm == NULL) buffSize = lame_encode_buffer(gfp[n],
+                                        leftBuffer,rightBuffer,
+                                        blockSize,outputBuffer,
+                                        outputBufferSize);
+// LAME only reads the samples, which may be in a read-only mapping
+            else if (numberChannels == 2)
+                buffSize = lame_encode_buffer_interleaved(gfp[n],
+                                        const_cast<short*>(pcm),
+                                        blockSize,outputBuffer,
+                                        outputBufferSize);
+            else buffSize = lame_encode_buffer(gfp[n],pcm,pcm,
+                                        blockSize,outputBuffer,
+                                        outputBufferSize);
+            if (buffSize < 0)
+            {
+                returnCode_ = "mp3 Conversion Error Occurred";
+                delete outDevices[n];           // Abandon this column only
+                outDevices[n] = 0;
+            }
+            else if (buffSize > 0)
+            {                               // Dump converted block to output
+                outDevices[n]->write((const char*) outputBuffer,buffSize);
+            }
+        }
+/** After each block the progress counters are bumped, for the GUI to pick up
+when it next samples them, and the cancel token is tested. The token is also
+tested between outputs, so that a job with many columns stops without encoding
+the block for the rest of them.*/
+        progress_.add((quint64)blockSize*numberOutputs,
+                      (quint64)blockSize*bytesPerFrame*numberOutputs);
+        if (cancel_.isCancelled()) break;       // Abort conversion
+    }
+// A cancelled job leaves its outputs unfinished, which must not pass as OK
+    bool isCancelled = cancel_.isCancelled();
+    if (isCancelled) returnCode_ = "Conversion cancelled";
+/** Only an output that has been encoded in full is committed. Any other output
+file is discarded, so that no dud mp3 file is left in its place. */
+    TraceSpan flushSpan(trace_,"flush");
+    QList<bool> isPartOk;
+    for (int n = 0; n < numberOutputs; n++)
+    {
+        bool isOk = (outDevices[n] != 0) && (! isCancelled) &&
+                    isInputComplete;
+        if (outDevices[n] != 0)
+        {
+            int buffSize = lame_encode_flush(gfp[n],outputBuffer,
+                                             outputBufferSize);
+            if (buffSize < 0)
+            {
+                returnCode_ = "mp3 Conversion Error Occurred";
+                isOk = false;
+            }
+            else if (buffSize > 0)
+            {
+// Dump converted block to output
+                outDevices[n]->write((const char*) outputBuffer,buffSize);
+            }
+            if (isOk && (! commitOutput(outDevices[n])))
+            {
+                returnCode_ = "Could not write an output file.";
+                isOk = false;
+            }
+            delete outDevices[n];               // Discards if not committed
+        }
+/* Trim the frames encoded from the overlaps off the segment. The segment
+boundaries are whole numbers of frames, so the frames of all segments line
+up with those that would be produced by encoding the file in one pass. */
+        if (isOk && (! segments_.isNull()))
+        {
+            uint frameSize = lame_get_framesize(gfp[n]);
+            int dropFrames = (readStart < firstFrame_) ?
+                            (firstFrame_ - readStart)/frameSize : 0;
+            int keepFrames = -1;            // The last segment keeps the lot
+            if (! isLastSegment_) keepFrames = (endFrame_-firstFrame_)/frameSize;
+            if (! trimFrames(parts[n],dropFrames,keepFrames))
+            {
+                returnCode_ = "Could not split the mp3 stream into frames.";
+                isOk = false;
+            }
+        }
+        isPartOk.append(isOk);
+        if (gfp[n] != NULL) lame_close(gfp[n]);
+    }
+    reader.close();
+    flushSpan.end();
+/** When all segments have been stored the last job to finish writes the joined
+segments to the output files. */
+    if ((! segments_.isNull()) &&
+        segments_->storeSegment(segment_,parts,isPartOk))
+    {
+        TraceSpan joinSpan(trace_,"join",inputFile_);
+        QString writeReturnCode = segments_->writeOutputs(writer_);
+        if (writeReturnCode != "OK") returnCode_ = writeReturnCode;
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Cancel the job
+
+The job's token is cancelled, and the job stops at its next test of it.
+*/
+
+void Converter::setCancelled()
+{
+    cancel_.cancel();
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the cancel token of the batch
+
+The job is also cancelled when the batch is. This must be set before the job
+is queued.
+@param[in] batchCancel Token of the batch, or null.
+*/
+
+void Converter::setBatchCancel(CancelToken* batchCancel)
+{
+    cancel_.setParent(batchCancel);
+}
+//-----------------------------------------------------------------------------
+/** @brief Take a job off the batch if no worker has claimed it
+
+The job is counted as done, so that the progress of the batch is not left
+short. The caller counts the job off, as it will not signal.
+@returns true if the job was dropped, false if it has already been run.
+*/
+
+bool Converter::drop()
+{
+    if (! state_.testAndSetOrdered(JOB_QUEUED,JOB_DROPPED)) return false;
+    progress_.complete();
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Return the error code from the conversions
+*/
+
+QString Converter::getReturnCode() const
+{
+    return returnCode_;
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Add an output to be converted from the input file
+
+@param[in] settings compiled LAME settings for this output.
+@param[in] outputFile mp3 file to be created.
+*/
+
+void Converter::addOutput(LameSettingsPointer settings, QString outputFile)
+{
+    ConversionOutput output;
+    output.settings = settings;
+    output.outputFile = outputFile;
+    outputs_.append(output);
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of outputs to be converted from the input file
+*/
+
+int Converter::numberOutputs() const
+{
+    return outputs_.size();
+}
+//-----------------------------------------------------------------------------
+/** @brief Output file of one of the outputs
+
+@param[in] n index of the output.
+*/
+
+QString Converter::outputFile(int n) const
+{
+    return outputs_.value(n).outputFile;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the number of sample frames encoded at a time
+
+Each block costs a call to LAME and a write for every output, as well as a
+check for cancellation, so large blocks keep this overhead small. The buffers
+grow with the block size, which should stay small enough for them to sit in
+the processor caches.
+@param[in] blockSize Sample frames per block, limited to a sensible range.
+*/
+
+void Converter::setBlockSize(uint blockSize)
+{
+    blockSize_ = validBlockSize(blockSize);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the thread that writes the output files
+
+Without a writer the job writes its own output files, which is simpler when it
+is run on its own.
+@param[in] writer Output writer thread shared by all jobs.
+*/
+
+void Converter::setWriter(Mp3Writer* writer)
+{
+    writer_ = writer;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the cache of encoded files
+
+@param[in] cache Cache shared by all jobs, or null to encode every output.
+*/
+
+void Converter::setCache(EncodeCache* cache)
+{
+    cache_ = cache;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the timeline the job records its work in
+
+@param[in] trace Trace of the batch, or null if the batch is not traced.
+*/
+
+void Converter::setTrace(ConversionTrace* trace)
+{
+    trace_ = trace;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the work the job has to do from the format of its input
+
+This is called before the job is queued, so that its progress can be followed.
+@param[in] numberFrames Sample frames in the input file.
+@param[in] numberChannels Number of channels in the input file.
+@param[in] bitsPerSample Bits in each sample.
+*/
+
+void Converter::planWork(ulong numberFrames, uint numberChannels,
+                         uint bitsPerSample)
+{
+    ulong readStart,readEnd;
+    readRange(numberFrames,readStart,readEnd);
+    quint64 frames = (quint64)(readEnd - readStart)*outputs_.size();
+    progress_.setTotal(frames,frames*(numberChannels*bitsPerSample/8));
+}
+//-----------------------------------------------------------------------------
+/** @brief Progress counters of the job
+*/
+
+const ProgressCounters& Converter::progress() const
+{
+    return progress_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Work out the part of the file to be read, including any overlap
+
+@param[in] inputFrames Sample frames in the input file.
+@param[out] readStart First frame to be read.
+@param[out] readEnd Frame following the last to be read.
+*/
+
+void Converter::readRange(ulong inputFrames, ulong& readStart,
+                          ulong& readEnd) const
+{
+    if (segments_.isNull()) segmentReadRange(inputFrames,0,inputFrames,
+                                             true,true,readStart,readEnd);
+    else segmentReadRange(inputFrames,firstFrame_,endFrame_,segment_ == 0,
+                          isLastSegment_,readStart,readEnd);
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that the worker is done with the job
+
+A job that was dropped is not known to be clear of the pool until the pool has
+finished, so it does not count.
+*/
+
+bool Converter::isFinished() const
+{
+    return state_.loadAcquire() == JOB_FINISHED;
+}
+//-----------------------------------------------------------------------------
+/** @brief Cache keys of the outputs that the job encoded
+
+The caller stores the outputs in the cache once they have been written.
+@returns the keys by output file.
+*/
+
+QHash<QString,QByteArray> Converter::cacheKeys() const
+{
+    return cacheKeys_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the input WAV file name
+*/
+
+void Converter::setInputFileName(QString inputFile)
+{
+    inputFile_ = inputFile;
+}
+//-----------------------------------------------------------------------------
+/** @brief Restrict the job to one segment of the input file
+
+The outputs of the job must be the same as those given to the shared segment
+object. Segment boundaries must fall on a multiple of MP3_FRAME_SAMPLES frames,
+which is a whole number of mp3 frames for all MPEG versions.
+@param[in] segments Object shared by all the segments of the file.
+@param[in] segment Index of this segment, counting from zero.
+@param[in] firstFrame First sample frame of the segment.
+@param[in] endFrame Sample frame following the end of the segment.
+@param[in] isLastSegment The segment runs on to the end of the file.
+*/
+
+void Converter::setSegment(QSharedPointer<SegmentedConversion> segments,
+                           int segment, ulong firstFrame, ulong endFrame,
+                           bool isLastSegment)
+{
+    segments_ = segments;
+    segment_ = segment;
+    firstFrame_ = firstFrame;
+    endFrame_ = endFrame;
+    isLastSegment_ = isLastSegment;
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the header of a WAV file without converting it
+
+This is used to plan the conversions before any job is started.
+@param[in] inputFile WAV file to examine.
+@param[out] numberChannels Number of channels (1,2).
+@param[out] bitsPerSample bits per sample (8,16,24).
+@param[out] sampleRate samples per second in each channel.
+@param[out] numberFrames number of sample frames in the file.
+@returns true if the file could be opened and has a valid header.
+*/
+
+bool Converter::probeWavFile(const QString& inputFile, uint& numberChannels,
+                    uint& bitsPerSample, uint& sampleRate, ulong& numberFrames)
+{
+    WavReader reader;
+    if (reader.probe(inputFile) != "OK") return false;
+    numberChannels = reader.numberChannels();
+    bitsPerSample = reader.bitsPerSample();
+    sampleRate = reader.sampleRate();
+    numberFrames = reader.numberFrames();
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Segmented Conversion Class Definitions
+
+@param[in] numberSegments Number of segments the file is split into.
+@param[in] outputs The outputs to be converted for every segment.
+*/
+
+SegmentedConversion::SegmentedConversion(int numberSegments,
+                                  const QList<ConversionOutput>& outputs)
+            : outputs_(outputs),parts_(numberSegments),
+              isPartOk_(numberSegments),segmentsRemaining_(numberSegments),
+              isFetched_(false)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Store the encoded frames of a segment
+
+@param[in] segment Index of the segment.
+@param[in] parts Encoded frames for each output.
+@param[in] isPartOk Flags for each output showing that it encoded correctly.
+@returns true if this was the last segment to be stored.
+*/
+
+bool SegmentedConversion::storeSegment(int segment,
+                                const QList<QByteArray>& parts,
+                                const QList<bool>& isPartOk)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        parts_[segment] = parts;
+        isPartOk_[segment] = isPartOk;
+    }
+    return ! segmentsRemaining_.deref();
+}
+//-----------------------------------------------------------------------------
+/** @brief Join the segments and write them to the output files
+
+An output is only written if every one of its segments was encoded correctly.
+When a writer thread is given the files are passed to it, and any error in
+writing them is reported by the writer.
+@param[in] writer Output writer thread, or null to write the files here.
+@returns error message, or "OK".
+*/
+
+QString SegmentedConversion::writeOutputs(Mp3Writer* writer)
+{
+    QMutexLocker locker(&mutex_);
+    QString returnCode = "OK";
+    for (int n = 0; n < outputs_.size(); n++)
+    {
+        bool isOk = true;
+        for (int segment = 0; segment < parts_.size(); segment++)
+            if (! isPartOk_[segment].value(n,false)) isOk = false;
+        if (! isOk) continue;
+        QIODevice* outFile;
+        if (writer != NULL)
+            outFile = new Mp3OutputStream(writer,outputs_[n].outputFile);
+        else outFile = new QSaveFile(outputs_[n].outputFile);
+        if (! outFile->open(QIODevice::WriteOnly))
+        {
+            returnCode = "Could not open an output file.";
+            delete outFile;
+            continue;
+        }
+        for (int segment = 0; segment < parts_.size(); segment++)
+        {
+            outFile->write(parts_[segment][n]);
+            parts_[segment][n].clear();     // Release memory as we go
+        }
+        if (! commitOutput(outFile))
+            returnCode = "Could not write an output file.";
+        delete outFile;
+    }
+    return returnCode;
+}
+//-----------------------------------------------------------------------------
+/** @brief Place the outputs that are held in the cache
+
+This is done once for the file, by the first segment job to run. The outputs
+placed are dropped, so that every segment job encodes only those left.
+@param[in] cache Cache of encoded files.
+@param[in] inputFile WAV file being converted.
+@param[out] keys Cache keys of the outputs left to be encoded.
+@param[out] cached Outputs placed by this call.
+@returns the outputs left to be encoded.
+*/
+
+QList<ConversionOutput> SegmentedConversion::fetchCachedOutputs(
+                                    EncodeCache* cache,
+                                    const QString& inputFile,
+                                    QHash<QString,QByteArray>& keys,
+                                    QStringList& cached)
+{
+    QMutexLocker locker(&mutex_);
+    if (! isFetched_)
+    {
+        fetchFromCache(cache,inputFile,outputs_,cacheKeys_,cached);
+        isFetched_ = true;
+    }
+    keys = cacheKeys_;
+    return outputs_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Place the outputs of a file that are held in the cache
+
+The input file is hashed once for all of its outputs.
+@param[in] cache Cache of encoded files.
+@param[in] inputFile WAV file to be converted.
+@param[in,out] outputs Outputs of the file, left with those not placed.
+@param[out] keys Cache keys of the outputs left.
+@param[out] cached Outputs placed from the cache.
+*/
+
+static void fetchFromCache(EncodeCache* cache, const QString& inputFile,
+                           QList<ConversionOutput>& outputs,
+                           QHash<QString,QByteArray>& keys,
+                           QStringList& cached)
+{
+    QByteArray contentHash = EncodeCache::contentHash(inputFile);
+    if (contentHash.isEmpty()) return;
+    QList<ConversionOutput> remaining;
+    for (int n = 0; n < outputs.size(); n++)
+    {
+        QByteArray key = EncodeCache::key(contentHash,*outputs[n].settings);
+        if (cache->fetch(key,outputs[n].outputFile))
+            cached.append(outputs[n].outputFile);
+        else
+        {
+            keys.insert(outputs[n].outputFile,key);
+            remaining.append(outputs[n]);
+        }
+    }
+    outputs = remaining;
+}
+//-----------------------------------------------------------------------------
+/** @brief Close an output device, keeping what has been written
+
+An output file is written under a temporary name and takes its own name only
+now. A file passed to the writer thread is committed when the writer gets to
+it, and any error is reported by the writer.
+@param[in] outDevice Output stream, file or memory buffer.
+@returns false if the output could not be committed.
+*/
+
+static bool commitOutput(QIODevice* outDevice)
+{
+    Mp3OutputStream* stream = qobject_cast<Mp3OutputStream*>(outDevice);
+    if (stream != NULL) return stream->commit();
+    QSaveFile* file = qobject_cast<QSaveFile*>(outDevice);
+    if (file != NULL) return file->commit();
+    outDevice->close();
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Drop mp3 frames from the front of a stream and cut it to length
+
+@param[in,out] stream Encoded mp3 frames.
+@param[in] dropFrames Number of frames to drop from the start.
+@param[in] keepFrames Number of frames to keep, or -1 to keep the rest.
+@returns false if the stream could not be split into frames.
+*/
+
+static bool trimFrames(QByteArray& stream, int dropFrames, int keepFrames)
+{
+    const uchar* data = (const uchar*) stream.constData();
+    int size = stream.size();
+    int start = 0;
+    int end = 0;
+    int frame = 0;
+    while (end < size)
+    {
+        if (frame == dropFrames) start = end;
+        if ((keepFrames >= 0) && (frame == dropFrames+keepFrames)) break;
+        if (size - end < 4) return false;
+        int length = mp3FrameLength(data+end);
+        if (length <= 0) return false;
+        end += length;
+        frame++;
+    }
+    if (frame < dropFrames) return false;   // Stream is too short
+    if (frame == dropFrames) start = end;   // Nothing left to keep
+    if (end > size) end = size;
+    stream = stream.mid(start,end-start);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Default number of conversion workers
+
+One worker is provided for each processor core, as the conversions are CPU bound
+and any more than this simply compete with each other for the caches.
+*/
+
+int defaultWorkerCount()
+{
+    int workers = QThread::idealThreadCount();
+    if (workers < 1) workers = 1;           // Count could not be determined
+    return workers;
+}
+//-----------------------------------------------------------------------------
+/** @brief Limit a block size to the range that is allowed
+
+@param[in] blockSize Sample frames per block, or zero or less for the default.
+@returns block size to be used.
+*/
+
+uint validBlockSize(int blockSize)
+{
+    if (blockSize < 1) return DEFAULT_BLOCK_SIZE;
+    if ((uint)blockSize < MIN_BLOCK_SIZE) return MIN_BLOCK_SIZE;
+    if ((uint)blockSize > MAX_BLOCK_SIZE) return MAX_BLOCK_SIZE;
+    return blockSize;
+}
+//-----------------------------------------------------------------------------
+/** @brief Size of the mp3 buffer needed to encode a block
+
+This is the worst case bound given in lame.h of 1.25 times the number of
+samples plus 7200 bytes, which also covers the flush. lame_get_size_mp3buffer()
+is not used as it only reports what LAME is holding at the moment.
+@param[in] blockSize Sample frames per block.
+@returns buffer size in bytes.
+*/
+
+uint mp3BufferSize(uint blockSize)
+{
+    return 5*blockSize/4+7200;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of segments to split a long file into
+
+Long files are split so that each segment is at least the given length, and
+there are no more segments than there are workers to encode them.
+@param[in] numberFrames number of sample frames in the file.
+@param[in] sampleRate samples per second.
+@param[in] segmentLength minimum length of a segment in seconds, or zero to
+never split files.
+@param[in] workers number of conversion workers.
+@returns number of segments, or 1 if the file is not to be split.
+*/
+
+int segmentCount(ulong numberFrames, uint sampleRate, uint segmentLength,
+                 int workers)
+{
+    if ((segmentLength == 0) || (sampleRate == 0)) return 1;
+    ulong segmentFrames = (ulong)segmentLength*sampleRate;
+    ulong segments = numberFrames/segmentFrames;
+    if (segments > (ulong)workers) segments = workers;
+    if (segments < 2) return 1;
+    return segments;
+}
+//-----------------------------------------------------------------------------
+/** @brief Work out the part of a file read for a segment, including overlaps
+
+Each segment but the first starts early and each but the last ends late, so
+that the encoder has settled by the time it reaches the segment itself.
+@param[in] inputFrames Sample frames in the input file.
+@param[in] firstFrame First sample frame of the segment.
+@param[in] endFrame Frame following the segment.
+@param[in] isFirstSegment Segment starts at the start of the file.
+@param[in] isLastSegment Segment runs to the end of the file.
+@param[out] readStart First frame to be read.
+@param[out] readEnd Frame following the last to be read.
+*/
+
+void segmentReadRange(ulong inputFrames, ulong firstFrame, ulong endFrame,
+                      bool isFirstSegment, bool isLastSegment,
+                      ulong& readStart, ulong& readEnd)
+{
+    readStart = isFirstSegment ? 0 : firstFrame - SEGMENT_OVERLAP;
+    readEnd = isLastSegment ? inputFrames : endFrame + SEGMENT_OVERLAP;
+    if (readEnd > inputFrames) readEnd = inputFrames;
+}
+//-----------------------------------------------------------------------------
+/** @defgroup mp3 Functions on the encoded mp3 stream.
+*/
+/*@{*/
+//-----------------------------------------------------------------------------
+/** @brief Length of an mp3 frame
+
+The frame header is decoded to find the length of the frame in bytes. Only
+Layer III frames with a stated bitrate (not free format) are recognised.
+@param[in] header Pointer to the four byte frame header.
+@returns Length of the frame including the header, or 0 if not valid.
+*/
+
+int mp3FrameLength(const uchar* header)
+{
+    static const int bitrates[2][16] =          // kbps for MPEG1 and MPEG2/2.5
+        {{0,32,40,48,56,64,80,96,112,128,160,192,224,256,320,0},
+         {0,8,16,24,32,40,48,56,64,80,96,112,128,144,160,0}};
+    static const int sampleRates[4][3] =        // by MPEG version code
+        {{11025,12000,8000},{0,0,0},{22050,24000,16000},{44100,48000,32000}};
+    if ((header[0] != 0xFF) || ((header[1] & 0xE0) != 0xE0)) return 0;
+    uint version = (header[1] >> 3) & 3;
+    uint layer = (header[1] >> 1) & 3;
+    uint bitrateIndex = header[2] >> 4;
+    uint sampleRateIndex = (header[2] >> 2) & 3;
+    uint padding = (header[2] >> 1) & 1;
+    if ((version == 1) || (layer != 1) || (sampleRateIndex == 3)) return 0;
+    int bitrate = bitrates[(version == 3) ? 0 : 1][bitrateIndex]*1000;
+    int sampleRate = sampleRates[version][sampleRateIndex];
+    if (bitrate == 0) return 0;
+    if (version == 3) return 144*bitrate/sampleRate + padding;
+    return 72*bitrate/sampleRate + padding;
+}
+//-----------------------------------------------------------------------------
+/*@{*/
@@ -0,0 +1,203 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef CONVERTER_H
+#define CONVERTER_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QString>
+#include <QList>
+#include <QVector>
+#include <QByteArray>
+#include <QHash>
+#include <QStringList>
+#include <QSharedPointer>
+#include "mp3writer.h"
+#include "lamesettings.h"
+#include "encodecache.h"
+#include "trace.h"
+#include "progress.h"
+#include "cancel.h"
+
+// Samples in an MPEG-1 frame, a whole number of frames for all MPEG versions
+const uint MP3_FRAME_SAMPLES = 1152;
+// Sample frames read and encoded at a time unless set otherwise
+// The overhead of a block was lost in the encoding time from 256 frames up, so
+// this is 8 MP3 frames, which keeps a 16 bit stereo block (36 KB) and its mp3
+// buffer within the L2 cache
+const uint DEFAULT_BLOCK_SIZE = 8*MP3_FRAME_SAMPLES;
+// Limits on the block size
+const uint MIN_BLOCK_SIZE = 64;
+const uint MAX_BLOCK_SIZE = 1 << 20;
+// Samples encoded either side of a segment to settle the encoder at its joins
+const uint SEGMENT_OVERLAP = 4*MP3_FRAME_SAMPLES;
+// Shortest segment (seconds) a long file is split into by default
+const uint DEFAULT_SEGMENT_LENGTH = 120;
+
+//! State of a conversion job, claimed by the worker or by the engine
+enum JobState
+{
+    JOB_QUEUED = 0,                   //!< Waiting for a worker.
+    JOB_RUNNING = 1,                  //!< Taken by a worker.
+    JOB_DROPPED = 2,                  //!< Taken off the batch before it ran.
+    JOB_FINISHED = 3                  //!< Run, and no longer used by the worker.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief One mp3 output of a conversion job
+
+Each output is encoded with its own set of LAME global flags, created by the job
+from the compiled settings of its column while it runs.
+*/
+
+struct ConversionOutput
+{
+    LameSettingsPointer settings;     //!< LAME settings for this output.
+    QString outputFile;               //!< Output file for conversion result.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Shared state of a file split into segments
+
+A long file can be split into segments which are encoded by separate jobs. The
+encoded mp3 frames of each segment are collected here, and the job that
+finishes last joins them in order into the output files.
+*/
+
+class SegmentedConversion
+{
+public:
+    SegmentedConversion(int numberSegments, const QList<ConversionOutput>& outputs);
+    bool storeSegment(int segment, const QList<QByteArray>& parts,
+                      const QList<bool>& isPartOk);
+    QString writeOutputs(Mp3Writer* writer);
+    QList<ConversionOutput> fetchCachedOutputs(EncodeCache* cache,
+                                    const QString& inputFile,
+                                    QHash<QString,QByteArray>& keys,
+                                    QStringList& cached);
+private:
+    QList<ConversionOutput> outputs_;       //!< Outputs shared by all segments.
+    QVector<QList<QByteArray> > parts_;     //!< Encoded frames [segment][output].
+    QVector<QList<bool> > isPartOk_;        //!< Segment encoded without error.
+    QAtomicInt segmentsRemaining_;          //!< Segments still to be stored.
+    bool isFetched_;                        //!< Cache has been looked up.
+    QHash<QString,QByteArray> cacheKeys_;   //!< Cache keys of the outputs.
+    QMutex mutex_;                          //!< Guards the stored segments.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Converter job class
+
+The Converter class holds the code for LAME conversion of a single WAV file to
+each of the mp3 outputs selected for it, one for each column of its row. The
+file is read only once and every block of samples is fed to all of the outputs.
+
+A job may also cover just one segment of a long file, so that the segments can
+be encoded in parallel on separate workers.
+
+It is a job to be run by a QThreadPool rather than a thread in its own right, so
+that a large matrix of conversions can be queued and worked through by a fixed
+number of worker threads. The pool does not take ownership of the job, which
+remains available to the caller for its return code once it has signalled that
+it is finished.
+ */
+
+class Converter : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    Converter();
+    virtual void run();                     // Reimplemented to do the work
+    QString getReturnCode() const;          // Access to error messages
+    void setInputFileName(QString inputFile);		// WAV file input
+    void addOutput(LameSettingsPointer settings, QString outputFile);
+    int numberOutputs() const;
+    QString outputFile(int n) const;
+    void setBlockSize(uint blockSize);
+    void setWriter(Mp3Writer* writer);
+    void setCache(EncodeCache* cache);
+    void setTrace(ConversionTrace* trace);
+    void planWork(ulong numberFrames, uint numberChannels,
+                  uint bitsPerSample);
+    const ProgressCounters& progress() const;
+    void setBatchCancel(CancelToken* batchCancel);
+    bool drop();
+    bool isFinished() const;
+    QHash<QString,QByteArray> cacheKeys() const;
+    void setSegment(QSharedPointer<SegmentedConversion> segments, int segment,
+                    ulong firstFrame, ulong endFrame, bool isLastSegment);
+    static bool probeWavFile(const QString& inputFile, uint& numberChannels,
+                      uint& bitsPerSample, uint& sampleRate, ulong& numberFrames);
+public slots:
+    void setCancelled();                            // Prepare to abort job
+signals:
+    void finished();                                // Job has been run
+    void outputCached(const QString& fileName);     // Output placed from cache
+private:
+    void convertFile();
+    void fetchCachedOutputs();
+    void readRange(ulong inputFrames, ulong& readStart, ulong& readEnd) const;
+    QString inputFile_;               //!< WAV input file.
+    QList<ConversionOutput> outputs_; //!< mp3 outputs, one for each column.
+    QString returnCode_;              //!< Error code to send back to caller.
+    CancelToken cancel_;              //!< Cancels the job or its batch.
+    QAtomicInt state_;                //!< Queued, running, dropped or finished.
+    uint blockSize_;                  //!< Sample frames encoded per call.
+    Mp3Writer* writer_;               //!< Output thread, or null to write here.
+    EncodeCache* cache_;              //!< Cache of encoded files, or null.
+    ConversionTrace* trace_;          //!< Timeline of the batch, or null.
+//! Cache keys of the outputs that are encoded, to store them once written.
+    QHash<QString,QByteArray> cacheKeys_;
+//! Segment of a long file, or null if the whole file is converted.
+    QSharedPointer<SegmentedConversion> segments_;
+    int segment_;                     //!< Index of this segment.
+    ulong firstFrame_;                //!< First sample frame of the segment.
+    ulong endFrame_;                  //!< Frame following the segment.
+    bool isLastSegment_;              //!< Segment runs to the end of file.
+    ProgressCounters progress_;       //!< Work done, read by other threads.
+};
+
+//-----------------------------------------------------------------------------
+// Conversion worker pool
+//-----------------------------------------------------------------------------
+int defaultWorkerCount();
+uint validBlockSize(int blockSize);
+uint mp3BufferSize(uint blockSize);
+int segmentCount(ulong numberFrames, uint sampleRate, uint segmentLength,
+                 int workers);
+void segmentReadRange(ulong inputFrames, ulong firstFrame, ulong endFrame,
+                      bool isFirstSegment, bool isLastSegment,
+                      ulong& readStart, ulong& readEnd);
+//-----------------------------------------------------------------------------
+// mp3 stream functions
+//-----------------------------------------------------------------------------
+int mp3FrameLength(const uchar* header);
+//-----------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,449 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "encodecache.h"
+#include <QDir>
+#include <QDirIterator>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QMultiMap>
+#include <QMutexLocker>
+#include <QCryptographicHash>
+#ifdef Q_OS_UNIX
+#include <stdio.h>
+#include <unistd.h>
+#endif
+#ifdef Q_OS_LINUX
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+// First line of the cache index
+const QByteArray CACHE_HEADER = "kLAME cache 1";
+
+static bool cloneFile(const QString& source, const QString& target);
+static bool linkFile(const QString& source, const QString& target);
+static bool replaceFile(const QString& source, const QString& target);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The cache is empty until it has been loaded.
+@param[in] directory Directory holding the cache.
+@param[in] sizeMegabytes Limit on the size of the cache in MB.
+*/
+
+EncodeCache::EncodeCache(const QString& directory, int sizeMegabytes)
+            : directory_(directory),totalSize_(0),isChanged_(false)
+{
+    setSizeLimit(sizeMegabytes);
+    resetStatistics();
+}
+//-----------------------------------------------------------------------------
+/** @brief Directory holding the cache
+*/
+
+QString EncodeCache::directory() const
+{
+    return directory_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the limit on the size of the cache
+
+The limit is applied when entries are next evicted.
+@param[in] sizeMegabytes Limit in MB.
+*/
+
+void EncodeCache::setSizeLimit(int sizeMegabytes)
+{
+    QMutexLocker locker(&mutex_);
+    if (sizeMegabytes < 0) sizeMegabytes = 0;
+    sizeLimit_ = (qint64)sizeMegabytes << 20;
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the index of the cache
+
+The directory is created if it does not exist. The files in the directory are
+taken as the truth: an index entry with no file is dropped, and a file with no
+index entry, as left by a batch that did not get as far as saving the index, is
+taken in with its modification time as its time of last use.
+@returns "OK" or an error message.
+*/
+
+QString EncodeCache::load()
+{
+    QMutexLocker locker(&mutex_);
+    entries_.clear();
+    totalSize_ = 0;
+    isChanged_ = false;
+    QDir directory(directory_);
+    if (! directory.mkpath("."))
+        return "Could not create the cache directory " + directory_;
+    QHash<QByteArray,Entry> files;
+    QDirIterator fileList(directory_,QStringList() << "*.mp3",QDir::Files,
+                          QDirIterator::Subdirectories);
+    while (fileList.hasNext())
+    {
+        fileList.next();
+        QFileInfo fileInfo = fileList.fileInfo();
+        QByteArray key = QByteArray::fromHex(
+                    fileInfo.completeBaseName().toLatin1());
+        if (key.isEmpty()) continue;
+        Entry entry;
+        entry.size = fileInfo.size();
+        entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+        entry.lastUsed = entry.modified;
+        files.insert(key,entry);
+    }
+    QFile index(directory.filePath(CACHE_INDEX_NAME));
+    if (index.open(QIODevice::ReadOnly) &&
+        (index.readLine().trimmed() == CACHE_HEADER))
+    {
+        while (! index.atEnd())
+        {
+            QList<QByteArray> fields = index.readLine().trimmed().split('\t');
+            if (fields.size() != 4) continue;
+            QByteArray key = QByteArray::fromHex(fields[0]);
+            if (! files.contains(key))
+            {
+                isChanged_ = true;
+                continue;
+            }
+            Entry entry;
+            entry.size = fields[1].toLongLong();
+            entry.modified = fields[2].toLongLong();
+            entry.lastUsed = fields[3].toLongLong();
+            entries_.insert(key,entry);
+            totalSize_ += entry.size;
+            files.remove(key);
+        }
+    }
+    QHash<QByteArray,Entry>::const_iterator file;
+    for (file = files.constBegin(); file != files.constEnd(); ++file)
+    {
+        entries_.insert(file.key(),file.value());
+        totalSize_ += file.value().size;
+        isChanged_ = true;
+    }
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Write the index of the cache if it has changed
+
+@returns "OK" or an error message.
+*/
+
+QString EncodeCache::save()
+{
+    QMutexLocker locker(&mutex_);
+    if (! isChanged_) return "OK";
+    QSaveFile index(QDir(directory_).filePath(CACHE_INDEX_NAME));
+    if (! index.open(QIODevice::WriteOnly))
+        return "Could not write the cache index in " + directory_;
+    index.write(CACHE_HEADER + "\n");
+    QHash<QByteArray,Entry>::const_iterator entry;
+    for (entry = entries_.constBegin(); entry != entries_.constEnd(); ++entry)
+        index.write(entry.key().toHex() + "\t" +
+                    QByteArray::number(entry.value().size) + "\t" +
+                    QByteArray::number(entry.value().modified) + "\t" +
+                    QByteArray::number(entry.value().lastUsed) + "\n");
+    if (! index.commit())
+        return "Could not write the cache index in " + directory_;
+    isChanged_ = false;
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Place a cached file as an output
+
+This may be called from any thread. An entry whose file has been changed since
+it was stored is dropped and counts as a miss.
+@param[in] key key of the encoded file.
+@param[in] outputFile file to be created.
+@returns true if the output was placed from the cache.
+*/
+
+bool EncodeCache::fetch(const QByteArray& key, const QString& outputFile)
+{
+    QString path = entryPath(key);
+    {
+        QMutexLocker locker(&mutex_);
+        QHash<QByteArray,Entry>::iterator entry = entries_.find(key);
+        if (entry == entries_.end())
+        {
+            statistics_.misses++;
+            return false;
+        }
+        QFileInfo fileInfo(path);
+        if ((! fileInfo.isFile()) || (fileInfo.size() != entry->size) ||
+            (fileInfo.lastModified().toMSecsSinceEpoch() != entry->modified))
+        {
+            removeEntry(key);
+            statistics_.misses++;
+            return false;
+        }
+        entry->lastUsed = QDateTime::currentMSecsSinceEpoch();
+        isChanged_ = true;
+    }
+    bool isPlaced = placeFile(path,outputFile);
+    QMutexLocker locker(&mutex_);
+    if (isPlaced) statistics_.hits++;
+    else statistics_.misses++;
+    return isPlaced;
+}
+//-----------------------------------------------------------------------------
+/** @brief Add an encoded output to the cache
+
+Nothing is done if the key is already held, or is being stored by another
+thread. As in fetch(), the file is placed without holding the lock, as it may
+be copied in full when the cache is on another file system, and the entry is
+then added under the lock. A failure to store a file is not an error of the
+batch, so it is only reported in the return value.
+@param[in] key key of the encoded file.
+@param[in] outputFile output file that was encoded.
+@returns true if the file is held in the cache.
+*/
+
+bool EncodeCache::store(const QByteArray& key, const QString& outputFile)
+{
+    {
+        QMutexLocker locker(&mutex_);
+        if (entries_.contains(key) || storing_.contains(key)) return true;
+        storing_.insert(key);
+    }
+    QString path = entryPath(key);
+    bool isPlaced = QDir().mkpath(QFileInfo(path).absolutePath()) &&
+                    placeFile(outputFile,path);
+    Entry entry;
+    if (isPlaced)
+    {
+        QFileInfo fileInfo(path);
+        entry.size = fileInfo.size();
+        entry.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+        entry.lastUsed = QDateTime::currentMSecsSinceEpoch();
+    }
+    QMutexLocker locker(&mutex_);
+    storing_.remove(key);
+    if (! isPlaced) return false;
+    if (entries_.contains(key)) return true;
+    entries_.insert(key,entry);
+    totalSize_ += entry.size;
+    statistics_.stored++;
+    isChanged_ = true;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Drop the least recently used entries to keep within the size limit
+*/
+
+void EncodeCache::evict()
+{
+    QMutexLocker locker(&mutex_);
+    if (totalSize_ <= sizeLimit_) return;
+    QMultiMap<qint64,QByteArray> byAge;
+    QHash<QByteArray,Entry>::const_iterator entry;
+    for (entry = entries_.constBegin(); entry != entries_.constEnd(); ++entry)
+        byAge.insert(entry.value().lastUsed,entry.key());
+    QMultiMap<qint64,QByteArray>::const_iterator oldest;
+    for (oldest = byAge.constBegin();
+         (oldest != byAge.constEnd()) && (totalSize_ > sizeLimit_); ++oldest)
+    {
+        removeEntry(oldest.value());
+        statistics_.evicted++;
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Counts of what the cache has done since they were last reset
+*/
+
+EncodeCacheStatistics EncodeCache::statistics() const
+{
+    QMutexLocker locker(&mutex_);
+    EncodeCacheStatistics statistics = statistics_;
+    statistics.size = totalSize_;
+    return statistics;
+}
+//-----------------------------------------------------------------------------
+/** @brief Clear the counts, at the start of a batch
+*/
+
+void EncodeCache::resetStatistics()
+{
+    QMutexLocker locker(&mutex_);
+    statistics_.hits = 0;
+    statistics_.misses = 0;
+    statistics_.stored = 0;
+    statistics_.evicted = 0;
+    statistics_.size = 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Hash of the whole content of an input file
+
+Unlike the fingerprint used for incremental builds, the whole file is hashed,
+as a key shared across projects must not depend on where the file is or when
+it was written. Reading the file costs little next to encoding it.
+@param[in] inputFile WAV file.
+@returns the hash, or an empty array if the file cannot be read.
+*/
+
+QByteArray EncodeCache::contentHash(const QString& inputFile)
+{
+    QFile file(inputFile);
+    if (! file.open(QIODevice::ReadOnly)) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    if (! hash.addData(&file)) return QByteArray();
+    hash.addData(QByteArray::number(file.size()));
+    return hash.result();
+}
+//-----------------------------------------------------------------------------
+/** @brief Key of an encoded file
+
+@param[in] contentHash hash of the content of the input file.
+@param[in] settings compiled LAME settings of the output.
+@returns the key.
+*/
+
+QByteArray EncodeCache::key(const QByteArray& contentHash,
+                            const LameSettings& settings)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(contentHash);
+    hash.addData(settings.fingerprint().toUtf8());
+    hash.addData(QByteArray(get_lame_version()));
+    return hash.result();
+}
+//-----------------------------------------------------------------------------
+/** @brief Path of the file of an entry
+
+The files are spread over subdirectories named by the first byte of the key,
+to keep the directories small.
+*/
+
+QString EncodeCache::entryPath(const QByteArray& key) const
+{
+    QString name = QString::fromLatin1(key.toHex());
+    return QDir(directory_).filePath(name.left(2) + "/" + name + ".mp3");
+}
+//-----------------------------------------------------------------------------
+/** @brief Remove an entry and its file
+
+The mutex must be held.
+*/
+
+void EncodeCache::removeEntry(const QByteArray& key)
+{
+    QHash<QByteArray,Entry>::iterator entry = entries_.find(key);
+    if (entry == entries_.end()) return;
+    QFile::remove(entryPath(key));
+    totalSize_ -= entry->size;
+    entries_.erase(entry);
+    isChanged_ = true;
+}
+//-----------------------------------------------------------------------------
+/** @defgroup placement File placement
+*/
+/*@{*/
+//-----------------------------------------------------------------------------
+/** @brief Place a copy of a file, sharing its data where possible
+
+The file is placed under a temporary name next to the target, which is then
+replaced in one step, so that the target is never seen partly written.
+@param[in] source file to be copied.
+@param[in] target file to be created or replaced.
+@returns true if the file was placed.
+*/
+
+bool placeFile(const QString& source, const QString& target)
+{
+    QString temporary = target + ".klame-part";
+    QFile::remove(temporary);
+    if ((! cloneFile(source,temporary)) && (! linkFile(source,temporary)) &&
+        (! QFile::copy(source,temporary)))
+    {
+        QFile::remove(temporary);
+        return false;
+    }
+    if (replaceFile(temporary,target)) return true;
+    QFile::remove(temporary);
+    return false;
+}
+//-----------------------------------------------------------------------------
+/** @brief Copy a file by a reflink, where the file system has them
+
+The copy shares the data of the source until either is changed.
+*/
+
+static bool cloneFile(const QString& source, const QString& target)
+{
+#if defined(Q_OS_LINUX) && defined(FICLONE)
+    QFile sourceFile(source);
+    QFile targetFile(target);
+    if (! sourceFile.open(QIODevice::ReadOnly)) return false;
+    if (! targetFile.open(QIODevice::WriteOnly)) return false;
+    if (ioctl(targetFile.handle(),FICLONE,sourceFile.handle()) == 0)
+        return true;
+    targetFile.close();
+    QFile::remove(target);
+#else
+    Q_UNUSED(source);
+    Q_UNUSED(target);
+#endif
+    return false;
+}
+//-----------------------------------------------------------------------------
+/** @brief Make a hard link to a file, where the platform has them
+*/
+
+static bool linkFile(const QString& source, const QString& target)
+{
+#ifdef Q_OS_UNIX
+    return ::link(QFile::encodeName(source).constData(),
+                  QFile::encodeName(target).constData()) == 0;
+#else
+    Q_UNUSED(source);
+    Q_UNUSED(target);
+    return false;
+#endif
+}
+//-----------------------------------------------------------------------------
+/** @brief Rename a file over another
+
+On POSIX systems the target is replaced in one step. Elsewhere it has to be
+removed first.
+*/
+
+static bool replaceFile(const QString& source, const QString& target)
+{
+#ifdef Q_OS_UNIX
+    return ::rename(QFile::encodeName(source).constData(),
+                    QFile::encodeName(target).constData()) == 0;
+#else
+    QFile::remove(target);
+    return QFile::rename(source,target);
+#endif
+}
+/*@}*/
@@ -0,0 +1,116 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef ENCODECACHE_H
+#define ENCODECACHE_H
+
+#include <QString>
+#include <QHash>
+#include <QSet>
+#include <QByteArray>
+#include <QMutex>
+#include "lamesettings.h"
+
+// Name of the index file kept in the cache directory
+const QString CACHE_INDEX_NAME = "index";
+// Default limit on the size of the cache (MB)
+const int DEFAULT_CACHE_SIZE = 4096;
+
+//! Counts of what the cache did during a batch
+struct EncodeCacheStatistics
+{
+    uint hits;                        //!< Outputs taken from the cache.
+    uint misses;                      //!< Outputs that had to be encoded.
+    uint stored;                      //!< Outputs added to the cache.
+    uint evicted;                     //!< Entries dropped to keep to the limit.
+    qint64 size;                      //!< Bytes held in the cache.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Cache of encoded mp3 files shared across projects
+
+Encoding the same recording with the same settings always gives the same mp3
+file, so an encoded file is kept in the cache under a key made from a hash of
+the content of the input file, the compiled LAME settings and the version of
+the LAME library. When the same key comes up again, in any project and for any
+output directory, the file is placed from the cache rather than encoded again.
+
+A file is placed by a reflink where the file system supports it, otherwise by a
+hard link, and otherwise by a copy. As a hard linked entry shares its data with
+an output file, the size and modification time of each entry are recorded, and
+an entry that has been changed through one of its links is dropped instead of
+being used.
+
+The cache is a directory of mp3 files named by their keys, with an index that
+records the size and time of last use of each. Once a batch is done the least
+recently used entries are dropped until the cache is within its size limit.
+Entries may be fetched from any thread; the index is read and written by the
+thread that owns the cache.
+*/
+
+class EncodeCache
+{
+public:
+    EncodeCache(const QString& directory, int sizeMegabytes = DEFAULT_CACHE_SIZE);
+    QString directory() const;
+    void setSizeLimit(int sizeMegabytes);
+    QString load();
+    QString save();
+    bool fetch(const QByteArray& key, const QString& outputFile);
+    bool store(const QByteArray& key, const QString& outputFile);
+    void evict();
+    EncodeCacheStatistics statistics() const;
+    void resetStatistics();
+    static QByteArray contentHash(const QString& inputFile);
+    static QByteArray key(const QByteArray& contentHash,
+                          const LameSettings& settings);
+private:
+//! An encoded file held in the cache
+    struct Entry
+    {
+        qint64 size;                    //!< Size of the file.
+        qint64 modified;                //!< Modification time when stored (ms).
+        qint64 lastUsed;                //!< Time last stored or fetched (ms).
+    };
+    QString entryPath(const QByteArray& key) const;
+    void removeEntry(const QByteArray& key);
+    QString directory_;                 //!< Directory holding the cache.
+    qint64 sizeLimit_;                  //!< Bytes kept after eviction.
+    QHash<QByteArray,Entry> entries_;   //!< Entries by key.
+    QSet<QByteArray> storing_;          //!< Keys being placed by store().
+    qint64 totalSize_;                  //!< Bytes held in all entries.
+    bool isChanged_;                    //!< Index needs to be saved.
+    EncodeCacheStatistics statistics_;  //!< Counts since last reset.
+    mutable QMutex mutex_;              //!< Guards the index and counts.
+};
+
+//-----------------------------------------------------------------------------
+// File placement
+//-----------------------------------------------------------------------------
+bool placeFile(const QString& source, const QString& target);
+//-----------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,198 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "fileimport.h"
+#include "wavreader.h"
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QMetaType>
+#include <QThread>
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The results are passed between threads, so their type is registered.
+*/
+
+FileImporter::FileImporter(QObject* parent) : QObject(parent)
+{
+    qRegisterMetaType<QVector<HeaderProbe> >("QVector<HeaderProbe>");
+    pool_.setMaxThreadCount(QThread::idealThreadCount()*
+                            IMPORT_THREADS_PER_CORE);
+}
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+The tasks still queued are dropped and those running stop at their next file.
+*/
+
+FileImporter::~FileImporter()
+{
+    cancel_.cancel();
+    pool_.clear();
+    pool_.waitForDone();
+}
+//-----------------------------------------------------------------------------
+/** @brief Walk a folder and its subfolders for WAV files
+
+The files are signalled in chunks as they are found, then the end of the walk.
+@param[in] directory Folder to be walked.
+*/
+
+void FileImporter::addFolder(const QString& directory)
+{
+    pool_.start(new FolderWalk(this,directory));
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the headers of files
+
+The files are split among tasks that each read a chunk of headers, and the
+results of each task are signalled as it finishes.
+@param[in] firstFile Id of the first file.
+@param[in] fileNames Files, with consecutive ids.
+*/
+
+void FileImporter::probe(quint32 firstFile, const QStringList& fileNames)
+{
+    for (int first = 0; first < fileNames.size(); first += PROBES_PER_TASK)
+        pool_.start(new HeaderProbeTask(this,firstFile + first,
+                                        fileNames.mid(first,PROBES_PER_TASK)));
+}
+//-----------------------------------------------------------------------------
+/** @brief Pass on files found by a walk, from its thread
+*/
+
+void FileImporter::reportFound(const QStringList& fileNames)
+{
+    emit filesFound(fileNames);
+}
+//-----------------------------------------------------------------------------
+/** @brief Pass on the end of a walk, from its thread
+*/
+
+void FileImporter::reportWalked(const QString& directory)
+{
+    emit folderWalked(directory);
+}
+//-----------------------------------------------------------------------------
+/** @brief Pass on the headers read by a task, from its thread
+*/
+
+void FileImporter::reportProbed(const QVector<HeaderProbe>& probes)
+{
+    emit headersProbed(probes);
+}
+//-----------------------------------------------------------------------------
+/** @brief Token tested by the tasks between files
+*/
+
+const CancelToken* FileImporter::cancelToken() const
+{
+    return &cancel_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Folder Walk Class Definitions
+
+@param[in] importer Importer passing the files on.
+@param[in] directory Folder to be walked.
+*/
+
+FolderWalk::FolderWalk(FileImporter* importer, const QString& directory)
+            : importer_(importer),directory_(directory)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Walk the folder
+
+The files found are passed on once there is a chunk of them, or once they have
+been held for FOLDER_WALK_INTERVAL, so that a slow walk still fills the table
+as it goes.
+*/
+
+void FolderWalk::run()
+{
+    QDirIterator entries(directory_,QStringList() << "*.wav",QDir::Files,
+                         QDirIterator::Subdirectories);
+    QStringList found;
+    QElapsedTimer held;
+    held.start();
+    while (entries.hasNext() && (! importer_->cancelToken()->isCancelled()))
+    {
+        found.append(entries.next());
+        if ((found.size() >= FOLDER_WALK_CHUNK) ||
+            (held.elapsed() >= FOLDER_WALK_INTERVAL))
+        {
+            importer_->reportFound(found);
+            found.clear();
+            held.restart();
+        }
+    }
+    if (! found.isEmpty()) importer_->reportFound(found);
+    importer_->reportWalked(directory_);
+}
+//-----------------------------------------------------------------------------
+/** @brief Header Probe Task Class Definitions
+
+@param[in] importer Importer passing the results on.
+@param[in] firstFile Id of the first file.
+@param[in] fileNames Files, with consecutive ids.
+*/
+
+HeaderProbeTask::HeaderProbeTask(FileImporter* importer, quint32 firstFile,
+                                 const QStringList& fileNames)
+            : importer_(importer),firstFile_(firstFile),fileNames_(fileNames)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the headers
+*/
+
+void HeaderProbeTask::run()
+{
+    QVector<HeaderProbe> probes;
+    probes.reserve(fileNames_.size());
+    WavReader reader;
+    for (int n = 0; n < fileNames_.size(); n++)
+    {
+        if (importer_->cancelToken()->isCancelled()) return;
+        HeaderProbe probe;
+        probe.file = firstFile_ + n;
+        probe.returnCode = reader.probe(fileNames_[n]);
+        probe.numberChannels = 0;
+        probe.bitsPerSample = 0;
+        probe.sampleRate = 0;
+        probe.numberFrames = 0;
+        if (probe.returnCode == "OK")
+        {
+            probe.numberChannels = reader.numberChannels();
+            probe.bitsPerSample = reader.bitsPerSample();
+            probe.sampleRate = reader.sampleRate();
+            probe.numberFrames = reader.numberFrames();
+        }
+        probes.append(probe);
+    }
+    importer_->reportProbed(probes);
+}
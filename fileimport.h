@@ -0,0 +1,127 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+
+#ifndef FILEIMPORT_H
+#define FILEIMPORT_H
+
+#include <QObject>
+#include <QRunnable>
+#include <QThreadPool>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include "cancel.h"
+
+// Files found by a folder walk before they are passed on
+const int FOLDER_WALK_CHUNK = 256;
+// Longest time a folder walk holds on to the files it has found (ms)
+const int FOLDER_WALK_INTERVAL = 100;
+// Headers read by each probe task
+const int PROBES_PER_TASK = 64;
+// Import threads for each core, as the threads mostly wait on the disk
+const int IMPORT_THREADS_PER_CORE = 2;
+
+//! The format of a WAV file, as read from its header
+struct HeaderProbe
+{
+    quint32 file;                     //!< Id of the file in the file matrix.
+    QString returnCode;               //!< "OK" or why it cannot be converted.
+    quint8 numberChannels;            //!< Number of channels (1,2).
+    quint8 bitsPerSample;             //!< Bits per sample (8,16,24).
+    quint32 sampleRate;               //!< Samples per second in each channel.
+    quint64 numberFrames;             //!< Sample frames in the file.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Background import of WAV files
+
+Folders are walked for WAV files, including all of their subfolders, and the
+headers of the files are read, all on a pool of threads of its own so that the
+GUI carries on while a large archive is imported. The files found are passed on
+in chunks as the walk goes, and the headers are read by many tasks at once, as
+reading a header is mostly waiting for the disk. The results are passed on to
+the GUI thread by queued signals as each task finishes.
+
+The import is cancelled when the importer is deleted.
+*/
+
+class FileImporter : public QObject
+{
+    Q_OBJECT
+public:
+    FileImporter(QObject* parent = 0);
+    ~FileImporter();
+    void addFolder(const QString& directory);
+    void probe(quint32 firstFile, const QStringList& fileNames);
+    void reportFound(const QStringList& fileNames);
+    void reportWalked(const QString& directory);
+    void reportProbed(const QVector<HeaderProbe>& probes);
+    const CancelToken* cancelToken() const;
+signals:
+    void filesFound(const QStringList& fileNames);
+    void folderWalked(const QString& directory);
+    void headersProbed(const QVector<HeaderProbe>& probes);
+private:
+    QThreadPool pool_;                  //!< Threads walking and probing.
+    CancelToken cancel_;                //!< Stops the import.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Task walking a folder and its subfolders for WAV files
+
+Hidden files and folders are passed over, and symbolic links to folders are
+not followed, so that a loop of links cannot hold up the walk.
+*/
+
+class FolderWalk : public QRunnable
+{
+public:
+    FolderWalk(FileImporter* importer, const QString& directory);
+    void run();
+private:
+    FileImporter* importer_;            //!< Importer passing the files on.
+    QString directory_;                 //!< Folder to be walked.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Task reading the headers of a chunk of WAV files
+*/
+
+class HeaderProbeTask : public QRunnable
+{
+public:
+    HeaderProbeTask(FileImporter* importer, quint32 firstFile,
+                    const QStringList& fileNames);
+    void run();
+private:
+    FileImporter* importer_;            //!< Importer passing the results on.
+    quint32 firstFile_;                 //!< Id of the first file.
+    QStringList fileNames_;             //!< Files, with consecutive ids.
+};
+
+#endif
@@ -0,0 +1,382 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "filematrix.h"
+#include <QColor>
+
+static void removeBit(QBitArray& bits, int n);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The matrix starts with no files and a single conversion column.
+*/
+
+FileMatrixModel::FileMatrixModel(QObject* parent) : QAbstractTableModel(parent)
+{
+    headings_ << "Filename" << "Convert 1";
+    checks_.resize(1);
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of files in the matrix
+*/
+
+int FileMatrixModel::rowCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return rows_.size();
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of columns, the filename and format columns and the
+conversion columns
+*/
+
+int FileMatrixModel::columnCount(const QModelIndex& parent) const
+{
+    if (parent.isValid()) return 0;
+    return checks_.size() + FIRST_CONVERSION_COLUMN;
+}
+//-----------------------------------------------------------------------------
+/** @brief Data shown for a cell
+
+The filename column shows the name of the file, with its full path as a tool
+tip, the format column shows the format once the header has been read, and the
+conversion columns show their check states. An invalid file is shown in red,
+with the reason as a tool tip on its format.
+*/
+
+QVariant FileMatrixModel::data(const QModelIndex& index, int role) const
+{
+    if (! index.isValid()) return QVariant();
+    int row = index.row();
+    quint32 path = rows_[row];
+    if ((role == Qt::ForegroundRole) && formats_[path].isInvalid)
+        return QColor(Qt::red);
+    if (index.column() == 0)
+    {
+        if (role == Qt::DisplayRole) return paths_.fileName(path);
+        if (role == Qt::ToolTipRole) return paths_.path(path);
+        return QVariant();
+    }
+    if (index.column() == FORMAT_COLUMN)
+    {
+        if (role == Qt::DisplayRole) return formatText(formats_[path]);
+        if ((role == Qt::ToolTipRole) && formats_[path].isInvalid)
+            return invalid_.value(path);
+        return QVariant();
+    }
+    if (role == Qt::CheckStateRole)
+        return isChecked(row,conversionOf(index.column())) ? Qt::Checked
+                                                           : Qt::Unchecked;
+    return QVariant();
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the check state of a conversion cell
+*/
+
+bool FileMatrixModel::setData(const QModelIndex& index, const QVariant& value,
+                              int role)
+{
+    if ((! index.isValid()) || (index.column() < FIRST_CONVERSION_COLUMN) ||
+        (role != Qt::CheckStateRole)) return false;
+    checks_[conversionOf(index.column())].setBit(index.row(),
+                                                 value.toInt() == Qt::Checked);
+    emit dataChanged(index,index);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief The conversion cells are checkboxes, the filenames and formats only
+text
+*/
+
+Qt::ItemFlags FileMatrixModel::flags(const QModelIndex& index) const
+{
+    if (! index.isValid()) return Qt::NoItemFlags;
+    if (index.column() < FIRST_CONVERSION_COLUMN)
+        return Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+    return Qt::ItemIsUserCheckable | Qt::ItemIsEnabled | Qt::ItemIsSelectable;
+}
+//-----------------------------------------------------------------------------
+/** @brief Column headings, with the rows numbered as usual
+*/
+
+QVariant FileMatrixModel::headerData(int section, Qt::Orientation orientation,
+                                     int role) const
+{
+    if ((orientation == Qt::Horizontal) && (role == Qt::DisplayRole))
+    {
+        if (section == FORMAT_COLUMN) return QString("Format");
+        int column = (section == 0) ? 0 : conversionOf(section) + 1;
+        if (column < headings_.size()) return headings_[column];
+    }
+    return QAbstractTableModel::headerData(section,orientation,role);
+}
+//-----------------------------------------------------------------------------
+/** @brief Add files at the end of the matrix
+
+The files are added in one step, with every conversion checked and their
+formats yet to be read. The paths of the files are given consecutive ids, by
+which the formats are later set.
+@param[in] fileNames Full paths of the WAV files.
+@returns the path id of the first file.
+*/
+
+quint32 FileMatrixModel::addFiles(const QStringList& fileNames)
+{
+    quint32 firstPath = paths_.size();
+    if (fileNames.isEmpty()) return firstPath;
+    int first = rows_.size();
+    int end = first + fileNames.size();
+    beginInsertRows(QModelIndex(),first,end-1);
+    rows_.reserve(end);
+    for (int n = 0; n < fileNames.size(); n++)
+        rows_.append(paths_.add(fileNames[n]));
+    FileFormat unread = {0,0,0,0,false};
+    formats_.reserve(paths_.size());
+    while (formats_.size() < paths_.size()) formats_.append(unread);
+    for (int conversion = 0; conversion < checks_.size(); conversion++)
+    {
+        checks_[conversion].resize(end);
+        checks_[conversion].fill(true,first,end);
+    }
+    endInsertRows();
+    return firstPath;
+}
+//-----------------------------------------------------------------------------
+/** @brief Remove a file from the matrix
+
+The path of the file is kept, so that a header still being read in the
+background cannot be taken for that of a file added later under the same id.
+@param[in] row Row of the file.
+*/
+
+void FileMatrixModel::removeFile(int row)
+{
+    if ((row < 0) || (row >= rows_.size())) return;
+    beginRemoveRows(QModelIndex(),row,row);
+    rows_.remove(row);
+    for (int conversion = 0; conversion < checks_.size(); conversion++)
+        removeBit(checks_[conversion],row);
+    endRemoveRows();
+}
+//-----------------------------------------------------------------------------
+/** @brief Full path of the file of a row
+*/
+
+QString FileMatrixModel::filePath(int row) const
+{
+    return paths_.path(rows_[row]);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the formats read from the headers of files
+
+The rows of the files are not looked up, as the view redraws only the rows it
+shows whatever range is given as changed.
+@param[in] probes Formats, by path id.
+*/
+
+void FileMatrixModel::setProbes(const QVector<HeaderProbe>& probes)
+{
+    if (probes.isEmpty()) return;
+    for (int n = 0; n < probes.size(); n++)
+    {
+        const HeaderProbe& probe = probes[n];
+        if (probe.file >= (quint32)formats_.size()) continue;
+        FileFormat& format = formats_[probe.file];
+        format.numberFrames = probe.numberFrames;
+        format.sampleRate = probe.sampleRate;
+        format.numberChannels = probe.numberChannels;
+        format.bitsPerSample = probe.bitsPerSample;
+        format.isInvalid = (probe.returnCode != "OK");
+        if (format.isInvalid) invalid_.insert(probe.file,probe.returnCode);
+        else invalid_.remove(probe.file);
+    }
+    if (! rows_.isEmpty())
+        emit dataChanged(index(0,0),index(rows_.size()-1,FORMAT_COLUMN));
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that the header of a file was read and found unusable
+
+A file whose header is yet to be read is not invalid, and is checked by the
+conversion itself.
+*/
+
+bool FileMatrixModel::isInvalid(int row) const
+{
+    return formats_[rows_[row]].isInvalid;
+}
+//-----------------------------------------------------------------------------
+/** @brief Conversion of a table column
+
+@param[in] column Column in the table.
+@returns the conversion counting from zero, or -1 if not a conversion column.
+*/
+
+int FileMatrixModel::conversionOf(int column) const
+{
+    if (column < FIRST_CONVERSION_COLUMN) return -1;
+    return column - FIRST_CONVERSION_COLUMN;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of conversion columns
+*/
+
+int FileMatrixModel::numberConversions() const
+{
+    return checks_.size();
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that a file is to be converted in a conversion column
+
+@param[in] row Row of the file.
+@param[in] conversion Conversion column, counting from zero.
+*/
+
+bool FileMatrixModel::isChecked(int row, int conversion) const
+{
+    return checks_[conversion].testBit(row);
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a conversion column at the end, with every file checked
+
+@param[in] heading Heading of the column.
+*/
+
+void FileMatrixModel::addConversion(const QString& heading)
+{
+    int column = columnCount();
+    beginInsertColumns(QModelIndex(),column,column);
+    checks_.append(QBitArray(rows_.size(),true));
+    headings_.append(heading);
+    endInsertColumns();
+}
+//-----------------------------------------------------------------------------
+/** @brief Remove a conversion column
+
+@param[in] conversion Conversion column, counting from zero.
+*/
+
+void FileMatrixModel::removeConversion(int conversion)
+{
+    if ((conversion < 0) || (conversion >= checks_.size())) return;
+    int column = conversion + FIRST_CONVERSION_COLUMN;
+    beginRemoveColumns(QModelIndex(),column,column);
+    checks_.remove(conversion);
+    headings_.removeAt(conversion+1);
+    endRemoveColumns();
+}
+//-----------------------------------------------------------------------------
+/** @brief Headings of all columns, the filename column first
+*/
+
+QStringList FileMatrixModel::headings() const
+{
+    return headings_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the headings, and with them the number of conversion columns
+
+Conversion columns are added or removed at the end to match, and the check
+states of those that remain are kept.
+@param[in] headings Headings of all columns, the filename column first.
+*/
+
+void FileMatrixModel::setHeadings(const QStringList& headings)
+{
+    int conversions = qMax(headings.size()-1,0);
+    int existing = checks_.size();
+    if (conversions > existing)
+    {
+        beginInsertColumns(QModelIndex(),existing+FIRST_CONVERSION_COLUMN,
+                           conversions+FIRST_CONVERSION_COLUMN-1);
+        checks_.resize(conversions);
+        for (int n = existing; n < conversions; n++)
+            checks_[n] = QBitArray(rows_.size(),true);
+        endInsertColumns();
+    }
+    else if (conversions < existing)
+    {
+        beginRemoveColumns(QModelIndex(),conversions+FIRST_CONVERSION_COLUMN,
+                           existing+FIRST_CONVERSION_COLUMN-1);
+        checks_.resize(conversions);
+        endRemoveColumns();
+    }
+    headings_ = headings;
+    emit headerDataChanged(Qt::Horizontal,0,columnCount()-1);
+}
+//-----------------------------------------------------------------------------
+/** @brief Heading of a column
+
+@param[in] column Filename column 0, or conversion counting from one.
+*/
+
+QString FileMatrixModel::heading(int column) const
+{
+    return headings_.value(column);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the heading of a column
+
+@param[in] column Filename column 0, or conversion counting from one.
+*/
+
+void FileMatrixModel::setHeading(int column, const QString& heading)
+{
+    if ((column < 0) || (column >= headings_.size())) return;
+    headings_[column] = heading;
+    int section = (column == 0) ? 0 : column + FIRST_CONVERSION_COLUMN - 1;
+    emit headerDataChanged(Qt::Horizontal,section,section);
+}
+//-----------------------------------------------------------------------------
+/** @brief Text shown for the format of a file
+
+This is the sample rate, sample size, channels and duration, such as
+"44.1 kHz 16 bit stereo 3:25", or blank while the header is yet to be read.
+*/
+
+QString FileMatrixModel::formatText(const FileFormat& format) const
+{
+    if (format.isInvalid) return QString("Invalid");
+    if ((format.numberChannels == 0) || (format.sampleRate == 0))
+        return QString();
+    quint64 seconds = format.numberFrames/format.sampleRate;
+    return QString("%1 kHz %2 bit %3 %4:%5")
+            .arg(format.sampleRate/1000.0)
+            .arg(format.bitsPerSample)
+            .arg((format.numberChannels == 1) ? "mono" : "stereo")
+            .arg(seconds/60)
+            .arg(seconds%60,2,10,QChar('0'));
+}
+//-----------------------------------------------------------------------------
+/** @brief Remove a bit from a bit array, moving down the bits above it
+*/
+
+static void removeBit(QBitArray& bits, int n)
+{
+    int size = bits.size();
+    for (int bit = n; bit < size-1; bit++) bits.setBit(bit,bits.testBit(bit+1));
+    bits.resize(size-1);
+}
@@ -0,0 +1,116 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+
+#ifndef FILEMATRIX_H
+#define FILEMATRIX_H
+
+#include <QAbstractTableModel>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QBitArray>
+#include <QHash>
+#include "jobtable.h"
+#include "fileimport.h"
+
+// Column showing the format of each file, between the filename and conversions
+const int FORMAT_COLUMN = 1;
+// First of the conversion columns
+const int FIRST_CONVERSION_COLUMN = 2;
+
+//-----------------------------------------------------------------------------
+/** @brief Model of the matrix of files and conversions
+
+The matrix has a row for each WAV file to be converted, with the name of the
+file in the first column, its format in the second and a checkbox in each of
+the following conversion columns, one for each set of LAME settings. The paths
+of the files are held in a path table and each row holds only the id of its
+path. The check states are held as a bitset for each conversion column, so the
+whole matrix costs a bit per checkbox rather than an item object.
+
+Files are added in bulk with a single notice to the view, and the view asks
+only for the rows it shows, so adding and showing many thousands of files
+takes little more time than reading their names. A checkbox is toggled by
+setting its bit.
+
+The format of a file is filled in when its header has been read, which is done
+in the background after the file is added. A file whose header cannot be read
+is shown in red with the reason as a tool tip, and is not converted.
+
+The column headings are held here as well, the first being that of the
+filename column. The format column has a fixed heading and is not counted in
+the headings, so that a heading column is the conversion counting from one.
+*/
+
+class FileMatrixModel : public QAbstractTableModel
+{
+    Q_OBJECT
+public:
+    FileMatrixModel(QObject* parent = 0);
+    int rowCount(const QModelIndex& parent = QModelIndex()) const;
+    int columnCount(const QModelIndex& parent = QModelIndex()) const;
+    QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+    bool setData(const QModelIndex& index, const QVariant& value,
+                 int role = Qt::EditRole);
+    Qt::ItemFlags flags(const QModelIndex& index) const;
+    QVariant headerData(int section, Qt::Orientation orientation,
+                        int role = Qt::DisplayRole) const;
+    quint32 addFiles(const QStringList& fileNames);
+    void removeFile(int row);
+    QString filePath(int row) const;
+    void setProbes(const QVector<HeaderProbe>& probes);
+    bool isInvalid(int row) const;
+    int conversionOf(int column) const;
+    int numberConversions() const;
+    bool isChecked(int row, int conversion) const;
+    void addConversion(const QString& heading);
+    void removeConversion(int conversion);
+    QStringList headings() const;
+    void setHeadings(const QStringList& headings);
+    QString heading(int column) const;
+    void setHeading(int column, const QString& heading);
+private:
+//! Format of a file, by path id.
+    struct FileFormat
+    {
+        quint64 numberFrames;           //!< Sample frames in the file.
+        quint32 sampleRate;             //!< Samples per second.
+        quint8 numberChannels;          //!< Number of channels, 0 if unread.
+        quint8 bitsPerSample;           //!< Bits per sample.
+        bool isInvalid;                 //!< The header could not be read.
+    };
+    QString formatText(const FileFormat& format) const;
+    PathTable paths_;                   //!< Paths of the files added.
+    QVector<quint32> rows_;             //!< Path of each row.
+    QVector<FileFormat> formats_;       //!< Format of each path.
+    QHash<quint32,QString> invalid_;    //!< Why each invalid file is invalid.
+    QVector<QBitArray> checks_;         //!< Check states, by conversion.
+    QStringList headings_;              //!< Headings, filename column first.
+};
+
+#endif
@@ -0,0 +1,382 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "hotfolder.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QFileSystemWatcher>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QSet>
+#ifdef Q_OS_LINUX
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+static bool isWavFile(const QString& name);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+inotify is set up where it is available. Nothing is watched until directories
+are added.
+*/
+
+HotFolder::HotFolder(QObject* parent) : QObject(parent),
+            closeEvents_(-1),closeNotifier_(NULL)
+{
+    clock_.start();
+    watcher_ = new QFileSystemWatcher(this);
+    connect(watcher_,SIGNAL(directoryChanged(const QString&)),
+            this,SLOT(directoryChanged(const QString&)));
+    pollTimer_ = new QTimer(this);
+    pollTimer_->setInterval(HOT_FOLDER_POLL_INTERVAL);
+    connect(pollTimer_,SIGNAL(timeout()),this,SLOT(checkPending()));
+    missingTimer_ = new QTimer(this);
+    missingTimer_->setInterval(HOT_FOLDER_MISSING_INTERVAL);
+    connect(missingTimer_,SIGNAL(timeout()),this,SLOT(checkMissing()));
+#ifdef Q_OS_LINUX
+    closeEvents_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (closeEvents_ >= 0)
+    {
+        closeNotifier_ = new QSocketNotifier(closeEvents_,
+                                             QSocketNotifier::Read,this);
+        connect(closeNotifier_,SIGNAL(activated(int)),
+                this,SLOT(readCloseEvents()));
+    }
+#endif
+}
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+*/
+
+HotFolder::~HotFolder()
+{
+#ifdef Q_OS_LINUX
+    delete closeNotifier_;
+    if (closeEvents_ >= 0) ::close(closeEvents_);
+#endif
+}
+//-----------------------------------------------------------------------------
+/** @brief Watch a directory
+
+@param[in] directory Directory to be watched.
+@returns false if the directory does not exist.
+*/
+
+bool HotFolder::addDirectory(const QString& directory)
+{
+    QFileInfo directoryInfo(directory);
+    if (! directoryInfo.isDir()) return false;
+    QString path = directoryInfo.absoluteFilePath();
+    if (directories_.contains(path)) return true;
+    directories_.append(path);
+    watchDirectory(path);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set up the watches of a directory
+
+The inotify watch also reports the directory itself being removed or moved.
+@param[in] directory Absolute path of the directory.
+*/
+
+void HotFolder::watchDirectory(const QString& directory)
+{
+    watcher_->addPath(directory);
+#ifdef Q_OS_LINUX
+    if (closeEvents_ >= 0)
+    {
+        int watch = inotify_add_watch(closeEvents_,
+                                      QFile::encodeName(directory),
+                                      IN_CLOSE_WRITE | IN_MOVED_TO |
+                                      IN_DELETE_SELF | IN_MOVE_SELF);
+        if (watch >= 0) closeWatches_.insert(watch,directory);
+    }
+#endif
+}
+//-----------------------------------------------------------------------------
+/** @brief Directories watched, as absolute paths
+*/
+
+QStringList HotFolder::directories() const
+{
+    return directories_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Take in the files already in the directories
+
+These are signalled once they have settled, as they may still be being written.
+*/
+
+void HotFolder::start()
+{
+    for (int n = 0; n < directories_.size(); n++) scan(directories_[n],true);
+}
+//-----------------------------------------------------------------------------
+/** @brief Look for new and changed files in a directory that has changed
+
+This is also signalled when the directory itself is removed.
+*/
+
+void HotFolder::directoryChanged(const QString& directory)
+{
+    if (! QFileInfo(directory).isDir()) directoryRemoved(directory);
+    else scan(directory,false);
+}
+//-----------------------------------------------------------------------------
+/** @brief Stop watching a directory that has been removed or moved away
+
+Its watches are dropped and its files forgotten, and it is looked for until it
+is there again.
+@param[in] directory Absolute path of the directory.
+*/
+
+void HotFolder::directoryRemoved(const QString& directory)
+{
+    if ((! directories_.contains(directory)) || missing_.contains(directory))
+        return;
+    missing_.append(directory);
+    watcher_->removePath(directory);
+#ifdef Q_OS_LINUX
+    QList<int> watches = closeWatches_.keys(directory);
+    for (int n = 0; n < watches.size(); n++)
+    {
+        inotify_rm_watch(closeEvents_,watches[n]);
+        closeWatches_.remove(watches[n]);
+    }
+#endif
+    QHash<QString,FileState>* files[2] = {&pending_,&ready_};
+    for (int n = 0; n < 2; n++)
+    {
+        QHash<QString,FileState>::iterator file = files[n]->begin();
+        while (file != files[n]->end())
+        {
+            if (QFileInfo(file.key()).absolutePath() == directory)
+                file = files[n]->erase(file);
+            else ++file;
+        }
+    }
+    if (pending_.isEmpty()) pollTimer_->stop();
+    if (! missingTimer_->isActive()) missingTimer_->start();
+    emit directoryLost(directory);
+}
+//-----------------------------------------------------------------------------
+/** @brief Watch again the removed directories that are there again
+
+The files in a directory that is back are taken in as at the start, as they
+may still be being written.
+*/
+
+void HotFolder::checkMissing()
+{
+    QStringList restored;
+    for (int n = 0; n < missing_.size(); n++)
+        if (QFileInfo(missing_[n]).isDir()) restored.append(missing_[n]);
+    for (int n = 0; n < restored.size(); n++)
+    {
+        missing_.removeAll(restored[n]);
+        watchDirectory(restored[n]);
+        emit directoryRestored(restored[n]);
+        scan(restored[n],true);
+    }
+    if (missing_.isEmpty()) missingTimer_->stop();
+}
+//-----------------------------------------------------------------------------
+/** @brief Look for new and changed files in a directory
+
+Files that are new, or that have changed since they were signalled, are added
+to the files to be checked. Files that have gone are forgotten.
+@param[in] directory Directory watched.
+@param[in] isStarting the files were there before watching started.
+*/
+
+void HotFolder::scan(const QString& directory, bool isStarting)
+{
+    QDir watched(directory);
+    watched.setNameFilters(QStringList() << "*.wav");
+    watched.setFilter(QDir::Files);
+    QFileInfoList files = watched.entryInfoList();
+    QSet<QString> present;
+    bool hasCloseEvents = closeWatches_.values().contains(directory);
+    for (int n = 0; n < files.size(); n++)
+    {
+        QString fileName = files[n].absoluteFilePath();
+        if (! isWavFile(files[n].fileName())) continue;
+        present.insert(fileName);
+        FileState state;
+        state.size = files[n].size();
+        state.modified = files[n].lastModified().toMSecsSinceEpoch();
+        state.stableSince = clock_.elapsed();
+        state.awaitsClose = hasCloseEvents && (! isStarting);
+        QHash<QString,FileState>::const_iterator ready = ready_.find(fileName);
+        if ((ready != ready_.end()) && (ready.value().size == state.size) &&
+            (ready.value().modified == state.modified)) continue;
+        QHash<QString,FileState>::iterator pending = pending_.find(fileName);
+        if (pending == pending_.end()) pending_.insert(fileName,state);
+        else if ((pending.value().size != state.size) ||
+                 (pending.value().modified != state.modified))
+        {
+            state.awaitsClose = pending.value().awaitsClose;
+            pending.value() = state;
+        }
+    }
+    QHash<QString,FileState>::iterator ready = ready_.begin();
+    while (ready != ready_.end())
+    {
+        if ((QFileInfo(ready.key()).absolutePath() == directory) &&
+            (! present.contains(ready.key()))) ready = ready_.erase(ready);
+        else ++ready;
+    }
+    if ((! pending_.isEmpty()) && (! pollTimer_->isActive()))
+        pollTimer_->start();
+}
+//-----------------------------------------------------------------------------
+/** @brief Check the files not yet complete
+
+A file that has kept its size and time for long enough is signalled. One left
+for a close event waits longer, in case the event never comes, as for a file
+written over a network. A file that has gone is forgotten.
+*/
+
+void HotFolder::checkPending()
+{
+    qint64 now = clock_.elapsed();
+    QStringList settled;
+    QHash<QString,FileState>::iterator pending = pending_.begin();
+    while (pending != pending_.end())
+    {
+        FileState state;
+        if (! readState(pending.key(),state))
+        {
+            pending = pending_.erase(pending);
+            continue;
+        }
+        if ((state.size != pending.value().size) ||
+            (state.modified != pending.value().modified))
+        {
+            pending.value().size = state.size;
+            pending.value().modified = state.modified;
+            pending.value().stableSince = now;
+        }
+        else if (now - pending.value().stableSince >=
+                 (pending.value().awaitsClose ? HOT_FOLDER_CLOSE_WAIT :
+                                                HOT_FOLDER_SETTLE_TIME))
+            settled.append(pending.key());
+        ++pending;
+    }
+    for (int n = 0; n < settled.size(); n++)
+        report(settled[n],pending_.value(settled[n]));
+    if (pending_.isEmpty()) pollTimer_->stop();
+}
+//-----------------------------------------------------------------------------
+/** @brief Take the inotify events of files closed after writing or moved in
+
+An event of the directory itself being removed or moved away, or of its watch
+being dropped by the kernel, as when the file system is unmounted, stops the
+directory being watched.
+*/
+
+void HotFolder::readCloseEvents()
+{
+#ifdef Q_OS_LINUX
+    alignas(struct inotify_event) char buffer[4096];
+    ssize_t length;
+    while ((length = ::read(closeEvents_,buffer,sizeof(buffer))) > 0)
+    {
+        char* next = buffer;
+        while (next < buffer + length)
+        {
+            const struct inotify_event* event =
+                    reinterpret_cast<const struct inotify_event*>(next);
+            next += sizeof(struct inotify_event) + event->len;
+            QString directory = closeWatches_.value(event->wd);
+            if (directory.isEmpty()) continue;
+            if (event->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED))
+            {
+                directoryRemoved(directory);
+                continue;
+            }
+            if (event->len == 0) continue;
+            QString name = QFile::decodeName(event->name);
+            if (! isWavFile(name)) continue;
+            fileClosed(directory + "/" + name);
+        }
+    }
+#endif
+}
+//-----------------------------------------------------------------------------
+/** @brief Signal a file that has been closed after writing or moved in
+
+@param[in] fileName Full path of the file.
+*/
+
+void HotFolder::fileClosed(const QString& fileName)
+{
+    FileState state;
+    if (! readState(fileName,state)) return;
+    report(fileName,state);
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the size and time of a file
+
+@param[in] fileName Full path of the file.
+@param[out] state Size and modification time of the file.
+@returns false if the file has gone.
+*/
+
+bool HotFolder::readState(const QString& fileName, FileState& state) const
+{
+    QFileInfo fileInfo(fileName);
+    if (! fileInfo.isFile()) return false;
+    state.size = fileInfo.size();
+    state.modified = fileInfo.lastModified().toMSecsSinceEpoch();
+    state.stableSince = clock_.elapsed();
+    state.awaitsClose = false;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Signal a file as ready
+
+The file is noted so that it is not signalled again unless it changes.
+*/
+
+void HotFolder::report(const QString& fileName, const FileState& state)
+{
+    pending_.remove(fileName);
+    ready_.insert(fileName,state);
+    emit fileReady(fileName);
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that a file name is of a WAV file that is not hidden
+*/
+
+static bool isWavFile(const QString& name)
+{
+    return name.endsWith(".wav",Qt::CaseInsensitive) && (! name.startsWith('.'));
+}
@@ -0,0 +1,124 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+
+#ifndef HOTFOLDER_H
+#define HOTFOLDER_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QHash>
+#include <QElapsedTimer>
+
+class QFileSystemWatcher;
+class QSocketNotifier;
+class QTimer;
+
+// Time a file must keep its size and time to be taken as complete (ms)
+const int HOT_FOLDER_SETTLE_TIME = 500;
+// Time a file left for a close event must be unchanged to be taken anyway (ms)
+const int HOT_FOLDER_CLOSE_WAIT = 10000;
+// Time between checks of the files not yet complete (ms)
+const int HOT_FOLDER_POLL_INTERVAL = 250;
+// Time between checks for a watched directory that has been removed (ms)
+const int HOT_FOLDER_MISSING_INTERVAL = 2000;
+
+//-----------------------------------------------------------------------------
+/** @brief Watch directories for WAV files that are ready to convert
+
+A signal is given for each WAV file in the watched directories once it is
+complete, so that it can be converted while more files arrive. The directories
+are watched with QFileSystemWatcher, and a file that appears or changes is then
+checked now and then until its size and modification time have stayed the same
+for HOT_FOLDER_SETTLE_TIME, as there is no telling in general when another
+program has finished writing it.
+
+On Linux the directories are also watched through inotify for files closed
+after writing or moved in. Such a file is known to be complete and is signalled
+at once, and the files that change in those directories are left for it rather
+than timed, so that a writer that stalls for a while is not taken to be done,
+unless they stay unchanged for HOT_FOLDER_CLOSE_WAIT. The files found when
+watching starts are timed in any case.
+
+Hidden files are ignored, as are files without a .wav extension, so that a
+program that writes a file under a temporary name and then renames it is
+followed. A file is signalled again if it is written again.
+
+A watched directory that is removed or moved away is signalled as lost, its
+watches are dropped and its files forgotten. It is looked for every
+HOT_FOLDER_MISSING_INTERVAL, and once it is there again it is watched again,
+signalled as restored and its files taken in as at the start.
+*/
+
+class HotFolder : public QObject
+{
+    Q_OBJECT
+public:
+    HotFolder(QObject* parent = 0);
+    ~HotFolder();
+    bool addDirectory(const QString& directory);
+    QStringList directories() const;
+    void start();
+signals:
+    void fileReady(const QString& fileName);
+    void directoryLost(const QString& directory);
+    void directoryRestored(const QString& directory);
+private slots:
+    void directoryChanged(const QString& directory);
+    void readCloseEvents();
+    void checkPending();
+    void checkMissing();
+private:
+//! What is known of a file in a watched directory
+    struct FileState
+    {
+        qint64 size;                  //!< Size when last looked at.
+        qint64 modified;              //!< Modification time (ms since epoch).
+        qint64 stableSince;           //!< When it was last seen to change.
+        bool awaitsClose;             //!< Left for a close event.
+    };
+    void watchDirectory(const QString& directory);
+    void directoryRemoved(const QString& directory);
+    void scan(const QString& directory, bool isStarting);
+    bool readState(const QString& fileName, FileState& state) const;
+    void fileClosed(const QString& fileName);
+    void report(const QString& fileName, const FileState& state);
+    QStringList directories_;           //!< Directories watched.
+    QStringList missing_;               //!< Watched directories removed.
+    QFileSystemWatcher* watcher_;       //!< Signals changed directories.
+    QTimer* pollTimer_;                 //!< Checks the files not complete.
+    QTimer* missingTimer_;              //!< Looks for removed directories.
+    QElapsedTimer clock_;               //!< Times the files to settle.
+    QHash<QString,FileState> pending_;  //!< Files not yet complete.
+    QHash<QString,FileState> ready_;    //!< Files signalled, as they were.
+    int closeEvents_;                   //!< inotify descriptor, or -1.
+    QSocketNotifier* closeNotifier_;    //!< Wakes on inotify events.
+    QHash<int,QString> closeWatches_;   //!< Directories by inotify watch.
+};
+
+#endif
@@ -0,0 +1,345 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#include "jobtable.h"
+#include "converter.h"
+#include <algorithm>
+
+static bool isCostlier(const TableJob& first, const TableJob& second);
+
+//-----------------------------------------------------------------------------
+/** @brief Add a path to the table
+
+The path is not looked for first, so the caller must do that if a path is to
+be held only once.
+@param[in] path Path of a file.
+@returns the id of the path.
+*/
+
+quint32 PathTable::add(const QString& path)
+{
+    int split = path.lastIndexOf('/');
+    QString directory = path.left(split + 1);
+    quint32 directoryId = directoryIds_.value(directory,
+                                              (quint32)directories_.size());
+    if (directoryId == (quint32)directories_.size())
+    {
+        directories_.append(directory);
+        directoryIds_.insert(directory,directoryId);
+    }
+    PathEntry entry;
+    entry.directory = directoryId;
+    entry.name = names_.size();
+    names_.append(path.mid(split + 1).toUtf8());
+    names_.append('\0');
+    quint32 id = paths_.size();
+    paths_.append(entry);
+    index_.insert(qHash(path),id);
+    return id;
+}
+//-----------------------------------------------------------------------------
+/** @brief Find a path in the table
+
+@param[in] path Path of a file.
+@returns the id of the path, or -1 if it is not held.
+*/
+
+int PathTable::find(const QString& path) const
+{
+    uint key = qHash(path);
+    QMultiHash<uint,quint32>::const_iterator entry = index_.find(key);
+    while ((entry != index_.end()) && (entry.key() == key))
+    {
+        if (this->path(entry.value()) == path) return entry.value();
+        ++entry;
+    }
+    return -1;
+}
+//-----------------------------------------------------------------------------
+/** @brief The path held under an id
+*/
+
+QString PathTable::path(quint32 id) const
+{
+    const PathEntry& entry = paths_[id];
+    return directories_[entry.directory] +
+           QString::fromUtf8(names_.constData() + entry.name);
+}
+//-----------------------------------------------------------------------------
+/** @brief The file name of the path held under an id, without its directory
+*/
+
+QString PathTable::fileName(quint32 id) const
+{
+    return QString::fromUtf8(names_.constData() + paths_[id].name);
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of paths held
+*/
+
+int PathTable::size() const
+{
+    return paths_.size();
+}
+//-----------------------------------------------------------------------------
+/** @brief Empty the table and free its memory
+*/
+
+void PathTable::clear()
+{
+    directories_.clear();
+    directoryIds_.clear();
+    names_.clear();
+    paths_.clear();
+    index_.clear();
+}
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+*/
+
+JobTable::JobTable() : framesTotal_(0),bytesTotal_(0)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Empty the table for the next batch and free its memory
+*/
+
+void JobTable::clear()
+{
+    inputPaths_.clear();
+    outputPaths_.clear();
+    settings_.clear();
+    cells_.clear();
+    fingerprints_.clear();
+    jobs_.clear();
+    segmentPlans_.clear();
+    framesTotal_ = 0;
+    bytesTotal_ = 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Add the input file of a row
+
+@param[in] inputFile WAV file.
+@returns the id of the file for its jobs.
+*/
+
+quint32 JobTable::addInput(const QString& inputFile)
+{
+    return inputPaths_.add(inputFile);
+}
+//-----------------------------------------------------------------------------
+/** @brief The input file held under an id
+*/
+
+QString JobTable::inputFile(quint32 id) const
+{
+    return inputPaths_.path(id);
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that an output is already written by a cell of the batch
+
+@param[in] outputFile mp3 file.
+*/
+
+bool JobTable::hasOutput(const QString& outputFile) const
+{
+    return outputPaths_.find(outputFile) >= 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Add the settings of a column
+
+The settings are held once however many cells use them.
+@param[in] settings Compiled settings of the column.
+@returns the index of the settings for the cells.
+*/
+
+quint16 JobTable::addSettings(LameSettingsPointer settings)
+{
+    for (int n = 0; n < settings_.size(); n++)
+        if (settings_[n] == settings) return n;
+    settings_.append(settings);
+    return settings_.size() - 1;
+}
+//-----------------------------------------------------------------------------
+/** @brief The settings of a column
+*/
+
+LameSettingsPointer JobTable::settings(quint16 column) const
+{
+    return settings_[column];
+}
+//-----------------------------------------------------------------------------
+/** @brief Add an output to the batch
+
+The cells of a job must be added one after the other, before the job.
+@param[in] outputFile mp3 file, which must not already be held.
+@param[in] column Index of the settings of the output.
+@param[in] fingerprint Fingerprint of the output, or empty if it has none.
+@returns the index of the cell.
+*/
+
+quint32 JobTable::addCell(const QString& outputFile, quint16 column,
+                          const QByteArray& fingerprint)
+{
+    TableCell cell;
+    cell.column = column;
+    cell.flags = 0;
+    if (fingerprint.size() == CELL_FINGERPRINT_SIZE)
+    {
+        cell.flags = CELL_HAS_FINGERPRINT;
+        fingerprints_.append(fingerprint);
+    }
+    else fingerprints_.append(QByteArray(CELL_FINGERPRINT_SIZE,'\0'));
+    outputPaths_.add(outputFile);
+    cells_.append(cell);
+    return cells_.size() - 1;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of outputs in the batch
+*/
+
+int JobTable::numberCells() const
+{
+    return cells_.size();
+}
+//-----------------------------------------------------------------------------
+/** @brief An output of the batch
+*/
+
+const TableCell& JobTable::cell(quint32 n) const
+{
+    return cells_[n];
+}
+//-----------------------------------------------------------------------------
+/** @brief The output file of a cell
+*/
+
+QString JobTable::outputFile(quint32 n) const
+{
+    return outputPaths_.path(n);
+}
+//-----------------------------------------------------------------------------
+/** @brief The fingerprint of a cell, or empty if it has none
+*/
+
+QByteArray JobTable::fingerprint(quint32 n) const
+{
+    if (! (cells_[n].flags & CELL_HAS_FINGERPRINT)) return QByteArray();
+    return fingerprints_.mid(n*CELL_FINGERPRINT_SIZE,CELL_FINGERPRINT_SIZE);
+}
+//-----------------------------------------------------------------------------
+/** @brief Set a state bit of a cell
+*/
+
+void JobTable::setCellFlag(quint32 n, CellFlag flag)
+{
+    cells_[n].flags |= flag;
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a file that is split into segments
+
+@param[in] plan Segments of the file.
+@returns the index of the plan for the jobs of the segments.
+*/
+
+int JobTable::addSegmentPlan(const SegmentPlan& plan)
+{
+    segmentPlans_.append(plan);
+    return segmentPlans_.size() - 1;
+}
+//-----------------------------------------------------------------------------
+/** @brief A file that is split into segments
+*/
+
+const SegmentPlan& JobTable::segmentPlan(int n) const
+{
+    return segmentPlans_[n];
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a job to the batch
+
+@param[in] job The job, with its cells already added.
+@param[in] frames Frames the job encodes, for all of its outputs.
+@param[in] bytes Bytes of WAV data the job encodes, for all of its outputs.
+*/
+
+void JobTable::addJob(const TableJob& job, quint64 frames, quint64 bytes)
+{
+    jobs_.append(job);
+    framesTotal_ += frames;
+    bytesTotal_ += bytes;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of jobs in the batch
+*/
+
+int JobTable::numberJobs() const
+{
+    return jobs_.size();
+}
+//-----------------------------------------------------------------------------
+/** @brief A job of the batch
+*/
+
+const TableJob& JobTable::job(int n) const
+{
+    return jobs_[n];
+}
+//-----------------------------------------------------------------------------
+/** @brief Put the jobs in the order they are to be run, longest first
+
+Jobs of equal cost keep the order in which they were added.
+*/
+
+void JobTable::sortByCost()
+{
+    std::stable_sort(jobs_.begin(),jobs_.end(),isCostlier);
+}
+//-----------------------------------------------------------------------------
+/** @brief Frames to be encoded by the batch, for all outputs
+*/
+
+quint64 JobTable::framesTotal() const
+{
+    return framesTotal_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Bytes of WAV data to be encoded by the batch, for all outputs
+*/
+
+quint64 JobTable::bytesTotal() const
+{
+    return bytesTotal_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Order jobs by their estimated cost, the costliest first
+*/
+
+static bool isCostlier(const TableJob& first, const TableJob& second)
+{
+    return first.cost > second.cost;
+}
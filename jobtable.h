@@ -0,0 +1,167 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef JOBTABLE_H
+#define JOBTABLE_H
+
+#include <QString>
+#include <QByteArray>
+#include <QVector>
+#include <QHash>
+#include <QMultiHash>
+#include <QSharedPointer>
+#include "lamesettings.h"
+
+class SegmentedConversion;
+
+// Cost of opening and closing an output, in weighted sample frames
+const double JOB_COST_OVERHEAD = 8192;
+// Size of the fingerprint of an output
+const int CELL_FINGERPRINT_SIZE = 20;
+
+//! State of a cell of the job table, as bits
+enum CellFlag
+{
+    CELL_HAS_FINGERPRINT = 1,         //!< Output is recorded in its manifest.
+    CELL_WRITTEN = 2,                 //!< Written or placed from the cache.
+    CELL_FAILED = 4,                  //!< Its job failed.
+    CELL_SKIPPED = 8                  //!< Up to date, and not converted.
+};
+
+//! One output of a batch, with its path held under the same index
+struct TableCell
+{
+    quint16 column;                   //!< Settings of the output.
+    quint8 flags;                     //!< CellFlag bits.
+};
+
+//! One job of a batch, covering a whole file or one segment of it
+struct TableJob
+{
+    quint64 inputFrames;              //!< Sample frames in the input file.
+    float cost;                       //!< Estimated cost, longest first.
+    quint32 inputFile;                //!< Path of the input.
+    quint32 firstCell;                //!< First cell of the job's outputs.
+    quint16 numberCells;              //!< Number of outputs.
+    quint16 segment;                  //!< Segment of the file.
+    qint32 segmentPlan;               //!< Segments of the file, or -1.
+    quint8 numberChannels;            //!< Channels in the input.
+    quint8 bitsPerSample;             //!< Bits in each sample.
+};
+
+//! A file split into segments, shared by the jobs of its segments
+struct SegmentPlan
+{
+    QSharedPointer<SegmentedConversion> shared; //!< Joins the segments.
+    quint64 segmentFrames;            //!< Sample frames in each segment.
+    int numberSegments;               //!< Number of segments.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Paths of the files of a batch
+
+Each path is split into its directory, which is held once however many files
+are in it, and its file name, which is kept as UTF-8 in one block of memory.
+A path then costs a few bytes besides its name, rather than a string object of
+its own. Paths are found again by a hash of the whole path.
+*/
+
+class PathTable
+{
+public:
+    quint32 add(const QString& path);
+    int find(const QString& path) const;
+    QString path(quint32 id) const;
+    QString fileName(quint32 id) const;
+    int size() const;
+    void clear();
+private:
+//! Where a path is held
+    struct PathEntry
+    {
+        quint32 directory;            //!< Index of the directory.
+        quint32 name;                 //!< Offset of the file name.
+    };
+    QVector<QString> directories_;      //!< Directories, each held once.
+    QHash<QString,quint32> directoryIds_; //!< Index of each directory.
+    QByteArray names_;                  //!< File names, each null terminated.
+    QVector<PathEntry> paths_;          //!< Paths by id.
+    QMultiHash<uint,quint32> index_;    //!< Ids of the paths by their hash.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Compact table of the jobs and outputs of a batch
+
+The table holds what is needed to create the job objects of a batch when they
+are run: a record of a few bytes for each output, or cell, and for each job,
+with the paths held in a path table and the settings held once for each
+column. The job objects and their LAME flags are only made while a job runs,
+so the memory of a batch grows by little more than the length of the file
+names however many cells it has.
+
+Each output path can only be added once, so that two inputs that would write
+the same file are found before either is converted.
+*/
+
+class JobTable
+{
+public:
+    JobTable();
+    void clear();
+    quint32 addInput(const QString& inputFile);
+    QString inputFile(quint32 id) const;
+    bool hasOutput(const QString& outputFile) const;
+    quint16 addSettings(LameSettingsPointer settings);
+    LameSettingsPointer settings(quint16 column) const;
+    quint32 addCell(const QString& outputFile, quint16 column,
+                    const QByteArray& fingerprint);
+    int numberCells() const;
+    const TableCell& cell(quint32 n) const;
+    QString outputFile(quint32 n) const;
+    QByteArray fingerprint(quint32 n) const;
+    void setCellFlag(quint32 n, CellFlag flag);
+    int addSegmentPlan(const SegmentPlan& plan);
+    const SegmentPlan& segmentPlan(int n) const;
+    void addJob(const TableJob& job, quint64 frames, quint64 bytes);
+    int numberJobs() const;
+    const TableJob& job(int n) const;
+    void sortByCost();
+    quint64 framesTotal() const;
+    quint64 bytesTotal() const;
+private:
+    PathTable inputPaths_;              //!< Paths of the input files.
+    PathTable outputPaths_;             //!< Paths of the outputs, by cell.
+    QVector<LameSettingsPointer> settings_; //!< Settings of each column.
+    QVector<TableCell> cells_;          //!< Outputs of the batch.
+    QByteArray fingerprints_;           //!< Fingerprints of the cells.
+    QVector<TableJob> jobs_;            //!< Jobs of the batch.
+    QVector<SegmentPlan> segmentPlans_; //!< Files split into segments.
+    quint64 framesTotal_;               //!< Frames to be encoded.
+    quint64 bytesTotal_;                //!< Bytes of WAV data to be encoded.
+};
+
+#endif
@@ -0,0 +1,225 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "journal.h"
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QUrl>
+
+// First line of a journal file
+const QByteArray JOURNAL_HEADER = "kLAME journal 1";
+
+static QByteArray encodeField(const QString& field);
+static QString decodeField(const QByteArray& field);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+@param[in] fileName Journal file.
+*/
+
+BatchJournal::BatchJournal(const QString& fileName) : fileName_(fileName),
+                                                      pending_(NULL)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+A journal that was begun and not committed is abandoned, leaving any earlier
+journal as it was.
+*/
+
+BatchJournal::~BatchJournal()
+{
+    delete pending_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Journal file
+*/
+
+QString BatchJournal::fileName() const
+{
+    return fileName_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that there is an unfinished batch to resume
+*/
+
+bool BatchJournal::exists() const
+{
+    return QFileInfo(fileName_).isFile();
+}
+//-----------------------------------------------------------------------------
+/** @brief Start the journal of a batch
+
+The outputs of the batch are then added one by one, and the journal is
+committed once they all have been. The list of outputs replaces any earlier
+journal in one step when it is committed, so the cells are not gathered in
+memory first.
+@returns "OK" or an error message.
+*/
+
+QString BatchJournal::begin()
+{
+    file_.close();
+    delete pending_;
+    pending_ = new QSaveFile(fileName_);
+    if (! pending_->open(QIODevice::WriteOnly))
+    {
+        delete pending_;
+        pending_ = NULL;
+        return "Could not write the batch journal " + fileName_;
+    }
+    pending_->write(JOURNAL_HEADER + "\n");
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Add an output of the batch
+
+While the batch is being started the outputs are gathered to be committed
+together. An output that joins the batch once it runs is added after the
+completion lines so far, and is flushed at once.
+@param[in] cell Output of the batch.
+*/
+
+void BatchJournal::addCell(const JournalCell& cell)
+{
+    QByteArray line = "cell\t" + encodeField(cell.inputFile) + "\t" +
+                      encodeField(cell.outputFile) + "\t" +
+                      encodeField(cell.lameOptions) + "\n";
+    if (pending_ != NULL) pending_->write(line);
+    else if (file_.isOpen())
+    {
+        file_.write(line);
+        file_.flush();
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Commit the outputs of the batch
+
+The file is then kept open for the completion lines.
+@returns "OK" or an error message.
+*/
+
+QString BatchJournal::commit()
+{
+    if (pending_ == NULL)
+        return "Could not write the batch journal " + fileName_;
+    bool isCommitted = pending_->commit();
+    delete pending_;
+    pending_ = NULL;
+    if (! isCommitted)
+        return "Could not write the batch journal " + fileName_;
+    file_.setFileName(fileName_);
+    if (! file_.open(QIODevice::WriteOnly | QIODevice::Append))
+        return "Could not write the batch journal " + fileName_;
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Record an output as completed
+
+@param[in] outputFile Output file that has been written.
+@param[in] fingerprint Fingerprint of the output, or empty if it has none.
+*/
+
+void BatchJournal::markDone(const QString& outputFile,
+                            const QByteArray& fingerprint)
+{
+    if (! file_.isOpen()) return;
+    file_.write("done\t" + encodeField(outputFile) + "\t" +
+                fingerprint.toHex() + "\n");
+    file_.flush();
+}
+//-----------------------------------------------------------------------------
+/** @brief End the journal of a batch
+
+@param[in] isComplete the batch finished without error, so the journal is
+removed. Otherwise it is left for the batch to be resumed.
+*/
+
+void BatchJournal::end(bool isComplete)
+{
+    file_.close();
+    if (isComplete) QFile::remove(fileName_);
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the journal of an unfinished batch
+
+@param[out] cells Outputs of the batch that were not completed.
+@param[out] completed Fingerprints of the outputs that were completed, by file.
+@returns "OK" or an error message.
+*/
+
+QString BatchJournal::read(QList<JournalCell>& cells,
+                           QHash<QString,QByteArray>& completed) const
+{
+    cells.clear();
+    completed.clear();
+    QFile journal(fileName_);
+    if (! journal.open(QIODevice::ReadOnly))
+        return "There is no batch to resume";
+    if (journal.readLine().trimmed() != JOURNAL_HEADER)
+        return "The batch journal " + fileName_ + " is not valid";
+    QList<JournalCell> allCells;
+    while (! journal.atEnd())
+    {
+        QByteArray line = journal.readLine();
+        if (! line.endsWith('\n')) break;       // Cut short by a crash
+        line.chop(1);
+        QList<QByteArray> fields = line.split('\t');
+        if ((fields[0] == "cell") && (fields.size() == 4))
+        {
+            JournalCell cell;
+            cell.inputFile = decodeField(fields[1]);
+            cell.outputFile = decodeField(fields[2]);
+            cell.lameOptions = decodeField(fields[3]);
+            allCells.append(cell);
+        }
+        else if ((fields[0] == "done") && (fields.size() >= 2))
+            completed.insert(decodeField(fields[1]),
+                             QByteArray::fromHex(fields.value(2)));
+    }
+    for (int n = 0; n < allCells.size(); n++)
+        if (! completed.contains(allCells[n].outputFile))
+            cells.append(allCells[n]);
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Encode a field so that it holds no tabs or line ends
+*/
+
+static QByteArray encodeField(const QString& field)
+{
+    return QUrl::toPercentEncoding(field," /:");
+}
+//-----------------------------------------------------------------------------
+/** @brief Decode a field
+*/
+
+static QString decodeField(const QByteArray& field)
+{
+    return QUrl::fromPercentEncoding(field);
+}
@@ -0,0 +1,83 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QString>
+#include <QList>
+#include <QHash>
+#include <QByteArray>
+#include <QFile>
+
+class QSaveFile;
+
+//! One output of a batch, with all that is needed to convert it again
+struct JournalCell
+{
+    QString inputFile;                //!< WAV file to be converted.
+    QString outputFile;               //!< mp3 file to be written.
+    QString lameOptions;              //!< LAME options of the column.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Journal of a running batch
+
+The journal lists the outputs of a batch as it is started, and has a line
+added as each output is completed, so that if the batch is cancelled or kLAME
+crashes the unfinished outputs can be found and the batch resumed. The journal
+is removed when a batch finishes without error.
+
+It is a text file with a line that identifies the format, then one line for
+each output of the batch giving its input file, output file and LAME options,
+then one line for each output completed giving the output file and its
+fingerprint for the manifest of its directory. Outputs that join the batch
+while it runs have their lines among the completion lines. Fields are separated
+by tabs and percent encoded. Lines written while the batch runs are flushed as
+soon as they are written.
+*/
+
+class BatchJournal
+{
+public:
+    BatchJournal(const QString& fileName);
+    ~BatchJournal();
+    QString fileName() const;
+    bool exists() const;
+    QString begin();
+    void addCell(const JournalCell& cell);
+    QString commit();
+    void markDone(const QString& outputFile, const QByteArray& fingerprint);
+    void end(bool isComplete);
+    QString read(QList<JournalCell>& cells,
+                 QHash<QString,QByteArray>& completed) const;
+private:
+    QString fileName_;                  //!< Journal file.
+    QFile file_;                        //!< Open while a batch is running.
+    QSaveFile* pending_;                //!< Outputs of a batch being started.
+};
+
+#endif
@@ -8,7 +8,7 @@ OBJECTS_DIR     = obj
 MOC_DIR         = moc
 UI_DIR          = ui
 RCC_DIR         = ui
-CONFIG	       += qt thread warn_on release
+CONFIG	       += qt thread warn_on release c++14
 QT             += widgets
 
 # Look in the qt installation parent directory under Linux. Use -L to change.
@@ -21,11 +21,49 @@ FORMS          += klamemainformbase.ui \
                   klameoptionsdialoguebase.ui \
                   helpbase.ui
 HEADERS        += klamemainform.h \
+                  converter.h \
+                  conversionengine.h \
+                  wavreader.h \
+                  pcmconvert.h \
+                  mp3writer.h \
+                  lamesettings.h \
+                  lameoptions.h \
+                  project.h \
+                  batchrunner.h \
+                  manifest.h \
+                  encodecache.h \
+                  journal.h \
+                  trace.h \
+                  progress.h \
+                  cancel.h \
+                  jobtable.h \
+                  filematrix.h \
+                  hotfolder.h \
+                  fileimport.h \
                   klameoptionsdialog.h \
                   help.h \
                   lame.h
 SOURCES        += main.cpp \
                   klamemainform.cpp \
+                  converter.cpp \
+                  conversionengine.cpp \
+                  wavreader.cpp \
+                  pcmconvert.cpp \
+                  mp3writer.cpp \
+                  lamesettings.cpp \
+                  lameoptions.cpp \
+                  project.cpp \
+                  batchrunner.cpp \
+                  manifest.cpp \
+                  encodecache.cpp \
+                  journal.cpp \
+                  trace.cpp \
+                  progress.cpp \
+                  cancel.cpp \
+                  jobtable.cpp \
+                  filematrix.cpp \
+                  hotfolder.cpp \
+                  fileimport.cpp \
                   klameoptionsdialog.cpp \
                   help.cpp
 RESOURCES      += icons.qrc
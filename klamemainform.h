@@ -30,13 +30,14 @@ Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
 #include "ui_klamemainformbase.h"
 #include <QMainWindow>
 #include <QCloseEvent>
-#include <QThread>
 #include <QProgressDialog>
-#include "lame.h"
+#include "conversionengine.h"
+#include "progress.h"
+#include "filematrix.h"
+#include "fileimport.h"
 
-const int INPUT_BLOCK_SIZE = 1152;
-// Recommended maximum size to hold conversion from wav to mp3
-const uint OUTPUT_BLOCK_SIZE = 5*INPUT_BLOCK_SIZE/4+7200;
+class ProgressDisplay;
+class QTimer;
 
 //-----------------------------------------------------------------------------
 /** @brief kLAME Main form window
@@ -44,8 +45,10 @@ const uint OUTPUT_BLOCK_SIZE = 5*INPUT_BLOCK_SIZE/4+7200;
 This class provides the main window. The files to be converted and the
 different LAME settings are stored in a display array with files to be
 converted in rows and lame settings in columns, resulting in a matrix of output
-files. The display is established in a QTableWidget, which is an item based
-table view with a default model.
+files. The matrix is held in a FileMatrixModel and shown in a QTableView, which
+only asks for the rows it shows. Folders are imported and the headers of the
+files read in the background by a FileImporter, and the table fills in as the
+results arrive.
 
 This class manages stored directory paths and filenames, ensuring that they
 remain persistent throughout the kLAME session, and are saved and loaded
@@ -69,99 +72,88 @@ class KLameMainForm : public QMainWindow
 public:
     KLameMainForm(QWidget* parent = 0);
     ~KLameMainForm();
+    void setWorkerCount(int workers);
+    void setSegmentLength(int seconds);
+    void setBlockSize(int blockSize);
+    void setFsyncPolicy(const QString& policy);
+    void setIncremental(bool isIncremental);
+    void setContentHash(bool useContentHash);
+    void setCache(const QString& directory, int sizeMegabytes);
+    void setTrace(const QString& fileName);
 private slots:
     void on_actionNewProject_triggered();
     void on_actionOpenProject_triggered();
     void on_actionSaveProject_triggered();
     void on_actionAddFiles_triggered();
+    void on_actionAddFolder_triggered();
     void on_actionRemoveFile_triggered();
     void on_actionOptions_triggered();
     void on_actionAddColumn_triggered();
     void on_actionDeleteColumn_triggered();
     void on_actionConvertFiles_triggered();
+    void on_actionResumeConversion_triggered();
     void on_actionInstructions_triggered();
     void on_actionAbout_triggered();
     void on_actionQuit_triggered();
+    void conversionFinished(const QString& returnCode);
+    void outputSkipped();
+    void sampleProgress();
+    void columnClicked(int column);
+    void filesFound(const QStringList& fileNames);
+    void folderWalked(const QString& directory);
+    void headersProbed(const QVector<HeaderProbe>& probes);
 private:
+    int currentColumn() const;          // Column selected in the table
     void closeEvent(QCloseEvent*);      // subclass: catch any window close
     void saveSettings();                // Saves user's setting on exit
     void loadSettings();                // Load's users settings at start
+    void startConversion();             // Show progress and start the batch
+    void addFiles(const QStringList& fileNames); // Add and probe files
+    void showImportStatus();            // Progress of the import
     QString wavDirectory_;              //!< Directory holding wav files.
     QString settingsDirectory_;         //!< Directory to store settings.
     QString projectsDirectory_;         //!< Directory holding project files.
     QStringList lameOptionsList_;       //!< Options for LAME (each column).
     QString projectFile_;               //!< File with kLAME project details.
-    QStringList headerLabels_;          //!< Headers for the column display.
+    FileMatrixModel* fileMatrix_;       //!< Files and conversion columns.
+    int clickedColumn_;                 //!< Column heading last clicked.
+    FileImporter* importer_;            //!< Walks folders and reads headers.
+    int foldersWalking_;                //!< Folders still being walked.
+    int filesAdded_;                    //!< Files whose headers are wanted.
+    int filesProbed_;                   //!< Files whose headers are read.
+    int filesInvalid_;                  //!< Files found to be invalid.
     QStringList outputDirectoryList_;   //!< Output directories (each column).
     QStringList filenameTagList_;       //!< File name tags (each column).
     QStringList commentList_;           //!< Comments (each column).
+    ConversionEngine* conversionEngine_; //!< Runs the conversion batches.
+    ProgressDisplay* progress_;         //!< Progress of the running batch.
+    QTimer* progressTimer_;             //!< Samples the progress of the batch.
+    ProgressMeter progressMeter_;       //!< Throughput and time remaining.
+    int skippedOutputs_;                //!< Outputs found to be up to date.
+    int skippedInputs_;                 //!< Invalid files left out of a batch.
     Ui::KLameMainFormBase mainFormUi;   // User Interface object
 };
 
-//-----------------------------------------------------------------------------
-/** @brief Converter thread class
-
-The Converter class runs the threaded code for LAME conversion of a single WAV
-file.
- */
-
-class Converter : public QThread
-{
-    Q_OBJECT
-public:
-    Converter(): returnCode_("OK"),isConversionCancelled_(false) {};
-    virtual void run();                     // Reimplemented to do the work
-    QString getReturnCode() const;          // Access to error messages
-    void setLameFlags(lame_global_flags* flags);    // Set thread parameters
-    void setInputFileName(QString inputFile);		// WAV file input
-    void setOutputFileName(QString outputFile);		// mp3 file output
-signals:
-    void progressTotalIncrement(uint increment);	// Update progress total
-    void progressCountIncrement(uint increment);	// Update current progress
-private slots:
-    void setCancelled();                            // Prepare to abort thread
-private:
-    bool isValidWavHeader(QDataStream& stream, uint& numberChannels,
-                      uint& bitsPerSample, uint& chunkSize);
-    bool getWavBuffer(QDataStream& stream, short inBuffer[2][INPUT_BLOCK_SIZE],
-                  const uint numberChannels,
-                  const uint bitsPerSample, const uint blockSize);
-//! A set of configuration data used by LAME. LAME is re-entrant, but
-//! a unique set of flags must be maintained separately for each thread.
-    lame_global_flags* gfp_;
-    QString inputFile_;               //!< WAV input file.
-    QString outputFile_;              //!< Output file for conversion result.
-    QString returnCode_;              //!< Error code to send back to caller.
-    bool isConversionCancelled_;      //!< used to signal thread to abort.
-};
-
 //-----------------------------------------------------------------------------
 /** @brief Display of progress
 
-Subclass the QProgressDialogue class to provide additional progress variables
-and processing. Slots allows us to update the progress dialogue. The total count
-is updated by all threads to get a grand total which is used to set the maximum
-time of the dialogue. The current progress count is also updated by all threads.
+Subclass the QProgressDialogue class to show the progress of a batch as sampled
+from the conversion engine, with its throughput and the time remaining. The
+bar runs over the bytes of WAV data to be encoded, in tenths of a percent, as
+the byte counts are too large for the range of the dialogue.
 */
 class ProgressDisplay : public QProgressDialog
 {
     Q_OBJECT
 public:
     ProgressDisplay(const QString & labelText,
-            const QString & cancelButtonText, int minimum, int maximum,
+            const QString & cancelButtonText,
             QWidget* parent = 0,Qt::WindowFlags f = 0);
-public slots:
-    void bumpProgressTotal(uint increment);
-    void bumpProgressCount(uint increment);
+    void showProgress(const ConversionProgress& progress,
+                      const QString& rateText);
 private:
-    uint progressTotal_;    //! The total time to complete all tasks
-    uint progressCount_;    //! The current progress time.
+    QString labelText_;     //!< Text shown above the throughput.
 };
 //-----------------------------------------------------------------------------
-// LAME general functions
-//-----------------------------------------------------------------------------
-void errorHandler(const char* format, va_list ap);
-QString setLameSetting(lame_global_flags* gfp,QString& option);
-//-----------------------------------------------------------------------------
 
 #endif
@@ -25,6 +25,7 @@ Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
  ***************************************************************************/
 
 #include "klameoptionsdialog.h"
+#include "lamesettings.h"
 #include <QFileDialog>
 #include <QFile>
 #include <QString>
@@ -45,15 +46,13 @@ Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
 //-----------------------------------------------------------------------------
 /** @brief Setup the default display.
 
-A table of valid keywords is created and the initial defaults are set for the
-LAME option variables.
+The initial defaults are set for the LAME option variables.
 */
 
 KLameOptionsDialogue::KLameOptionsDialogue(QWidget* parent) : QDialog(parent)
 {
     optionsDialogueUi.setupUi(this);
 
-    initializeValidKeywords();
     setupInitialDefault();
 }
 
@@ -592,18 +591,23 @@ display is not cleared and the other selected options are kept unchanged.
 
 void KLameOptionsDialogue::setDefaultOptions(QString& options)
 {
-    bool isOk;
-    int parm = 0;
-    short optionNumber = 0;
-    QString option = parseOptions(options, optionNumber);
+    QVector<LameOption> compiled = compileOptions(options);
     QString additionalOpts = "";
-    while (option != "")
+    for (int n = 0; n < compiled.size(); n++)
     {
-        QString keyword = option.section(" ",0,0);  // Pull out option keyword
-        QString parameter = option.section(" ",1,1);// First parameter if any
-        if (parameter != "") parm = parameter.toInt(&isOk,10);
-        if (keyword == "-m")
+        const LameOption& option = compiled[n];
+        const QString& parameter = option.parameter;
+        int parm = option.intValue;
+/* Options that the dialogue has no control for are kept in the additional
+options box, as are any that are not valid so that they can be corrected. */
+        if ((! option.isValid) || (! option.descriptor->isShown))
         {
+            additionalOpts += option.text + " ";
+            continue;
+        }
+        switch (option.descriptor->id)
+        {
+        case OPTION_MODE:
             if (parameter == "m")
                 optionsDialogueUi.mode->setCurrentIndex(1);
             else if (parameter == "s")
@@ -614,88 +618,82 @@ void KLameOptionsDialogue::setDefaultOptions(QString& options)
                 optionsDialogueUi.mode->setCurrentIndex(4);
             else if (parameter == "d")
                 optionsDialogueUi.mode->setCurrentIndex(5);
-        }
-        else if (keyword == "-V")
-        {
+            else
+                additionalOpts += option.text + " ";
+            break;
+        case OPTION_VBR_QUALITY:
             optionsDialogueUi.qualityPref->setChecked(true);
             optionsDialogueUi.qualitySelect->setValue(100-parm*10);
-        }
-        else if (keyword == "--vbr-new")
-        {
+            break;
+        case OPTION_VBR_NEW:
             optionsDialogueUi.qualityPref->setChecked(true);
             optionsDialogueUi.algorithmVbr->setCurrentIndex(1);
-        }
-        else if ((keyword == "--vbr-old") || (keyword == "-v"))
-        {
+            break;
+        case OPTION_VBR_OLD:
+        case OPTION_VBR:
             optionsDialogueUi.qualityPref->setChecked(true);
             optionsDialogueUi.algorithmVbr->setCurrentIndex(0);
-        }
-        else if (keyword == "-B")
-        {
+            break;
+        case OPTION_MAX_BITRATE:
             optionsDialogueUi.useMaxBitrate->setChecked(true);
             optionsDialogueUi.maxBitrateVbr->setValue(parm);
-        }
-        else if (keyword == "-b")
-        {
+            break;
+        case OPTION_MIN_BITRATE:
             optionsDialogueUi.bitrateSelect->setValue(parm);
             optionsDialogueUi.useMinVbrBitrate->setChecked(true);
-        }
-        else if (keyword == "--abr")
-        {
+            break;
+        case OPTION_ABR:
             optionsDialogueUi.bitratePref->setChecked(true);
             optionsDialogueUi.abrBitrateSelect->setValue(parm);
-        }
-        else if (keyword == "--cbr")
-        {
+            break;
+        case OPTION_CBR:
             optionsDialogueUi.bitratePref->setChecked(true);
             optionsDialogueUi.useCbr->setChecked(true);
-        }
-        else if (keyword == "-q")
+            break;
+        case OPTION_QUALITY:
             optionsDialogueUi.qualitySetting->setValue(parm);
-        else if (keyword == "-k")
+            break;
+        case OPTION_NO_FILTERING:
             optionsDialogueUi.noFiltering->setChecked(true);
-// Obsolete keyword
-//      else if (keyword == "-d")
-//          blockSizeDifference->setChecked(true);
-        else if (keyword == "--preset")
-        {
-            optionsDialogueUi.presetSelect->setChecked(true);
+            break;
+        case OPTION_PRESET:
+// Only the named presets are in the list, a bitrate is kept as typed
             if (parameter == "standard")
                 optionsDialogueUi.presetComboBox->setCurrentIndex(0);
-            if (parameter == "medium")
+            else if (parameter == "medium")
                 optionsDialogueUi.presetComboBox->setCurrentIndex(1);
-            if (parameter == "extreme")
+            else if (parameter == "extreme")
                 optionsDialogueUi.presetComboBox->setCurrentIndex(2);
-            if (parameter == "insane")
+            else if (parameter == "insane")
                 optionsDialogueUi.presetComboBox->setCurrentIndex(3);
-        }
-        else if (keyword == "--highpass")
-        {
+            else
+            {
+                additionalOpts += option.text + " ";
+                break;
+            }
+            optionsDialogueUi.presetSelect->setChecked(true);
+            break;
+        case OPTION_HIGHPASS:
             optionsDialogueUi.highpassFreqSelect->setChecked(true);
             optionsDialogueUi.highpassFreq->setText(parameter);
-        }
-        else if (keyword == "--highpass-width")
-        {
+            break;
+        case OPTION_HIGHPASS_WIDTH:
             optionsDialogueUi.highpassWidthSelect->setChecked(true);
             optionsDialogueUi.highpassWidth->setText(parameter);
-        }
-        else if (keyword == "--lowpass")
-        {
+            break;
+        case OPTION_LOWPASS:
             optionsDialogueUi.lowpassFreqSelect->setChecked(true);
             optionsDialogueUi.lowpassFreq->setText(parameter);
-        }
-        else if (keyword == "--lowpass-width")
-        {
+            break;
+        case OPTION_LOWPASS_WIDTH:
             optionsDialogueUi.lowpassWidthSelect->setChecked(true);
             optionsDialogueUi.lowpassWidth->setText(parameter);
-        }
-        else if (keyword == "--cwlimit")
-        {
+            break;
+        case OPTION_CW_LIMIT:
             optionsDialogueUi.useTonalityLimit->setChecked(true);
             optionsDialogueUi.tonalityLimit->setText(parameter);
-        }
-        else if (keyword == "--resample")
-        {
+            break;
+        case OPTION_RESAMPLE:
             optionsDialogueUi.useResampleFrequency->setChecked(true);
             if (parameter == "8")
                 optionsDialogueUi.resampleFrequency->setCurrentIndex(0);
@@ -715,16 +713,15 @@ void KLameOptionsDialogue::setDefaultOptions(QString& options)
                 optionsDialogueUi.resampleFrequency->setCurrentIndex(7);
             else
                 optionsDialogueUi.resampleFrequency->setCurrentIndex(8);
-        }
-        else if (keyword == "-X")
-        {
+            break;
+        case OPTION_QUANT_COMP:
             optionsDialogueUi.changeQualityMeasure->setChecked(true);
             optionsDialogueUi.qualityMeasure->setValue(parm);
+            break;
+// Silent operation is always set when the options are built
+        default:
+            break;
         }
-        else if (keyword != "--silent")
-            additionalOpts += option + " ";
-        optionNumber++;
-        option = parseOptions(options, optionNumber);
     }
     setupDisplay();
     optionsDialogueUi.additionalOptions->setText(additionalOpts);
@@ -852,179 +849,16 @@ void KLameOptionsDialogue::buildOptions()
 //-----------------------------------------------------------------------------
 /** @brief Check the option string and strip it of any that are not valid here.
 
-Use the QStringList of valid options set in the constructor to verify that an
-option is valid. The option list is sent back stripped of any invalid options.
+Each option is looked up in the LAME option table and its argument checked. The
+option list is sent back stripped of any invalid options.
 @param options QString of command-line LAME options.
 */
 
 void KLameOptionsDialogue::stripBadOptions(QString& options)
 {
-    short optionNumber = 0;
-    QString option = parseOptions(options, optionNumber);
+    QVector<LameOption> compiled = compileOptions(options);
     QString goodOptions = "";
-    while (option != "")
-    {
-        QString keyword = option.section(" ",0,0);// Pull out option keyword
-        for ( QStringList::Iterator it = validKeywords.begin();
-                it != validKeywords.end(); ++it)
-        {
-            if (keyword == *it)
-            {
-                goodOptions += option + " ";
-                break;
-            }
-        }
-        optionNumber++;
-        option = parseOptions(options, optionNumber);
-    }
+    for (int n = 0; n < compiled.size(); n++)
+        if (compiled[n].isValid) goodOptions += compiled[n].text + " ";
     options = goodOptions;                  // Send back stripped option string
 }
-//-----------------------------------------------------------------------------
-/** @brief Setup a list of valid keywords recognised by LAME
-*/
-
-void KLameOptionsDialogue::initializeValidKeywords()
-{
-    validKeywords << "-a";
-    validKeywords << "--add-id3v2";
-    validKeywords << "--allshort";
-    validKeywords << "--alt-preset";
-    validKeywords << "--athaa-type";
-    validKeywords << "--athaa-sensitivity";
-    validKeywords << "--athonly";
-    validKeywords << "--athlower";
-    validKeywords << "--athtype";
-    validKeywords << "-b";
-    validKeywords << "-B";
-    validKeywords << "--big-endian";
-    validKeywords << "--bitwidth";
-    validKeywords << "-c";
-    validKeywords << "--cbr";
-    validKeywords << "--clip-detect";
-    validKeywords << "--comp";
-    validKeywords << "--cwlimit";
-//  validKeywords << "-d";              // deprecated? - worse, just not there
-    validKeywords << "--decode";
-    validKeywords << "--disptime";
-    validKeywords << "-e";
-    validKeywords << "-f";
-    validKeywords << "-F";
-    validKeywords << "--freeformat";
-    validKeywords << "--interch";
-    validKeywords << "-g";
-    validKeywords << "--genre-list";
-    validKeywords << "-h";
-    validKeywords << "--highpass";
-    validKeywords << "--highpass-width";
-    validKeywords << "--id3v1-only";
-    validKeywords << "--id3v2-only";
-    validKeywords << "--ignore-tag-errors";
-    validKeywords << "-k";
-    validKeywords << "--little-endian";
-    validKeywords << "--lowpass";
-    validKeywords << "--lowpass-width";
-    validKeywords << "-m";
-    validKeywords << "--mp1input";
-    validKeywords << "--mp2input";
-    validKeywords << "--mp3input";
-    validKeywords << "--noasm";
-    validKeywords << "--nohist";
-    validKeywords << "--nogap";
-    validKeywords << "--nogapout";
-    validKeywords << "--noreplaygain";
-    validKeywords << "--nores";
-    validKeywords << "--noshort";
-    validKeywords << "--notemp";
-    validKeywords << "--ns-alto";
-    validKeywords << "--ns-bass";
-    validKeywords << "--nspsytune";
-    validKeywords << "--nsmsfix";
-    validKeywords << "--nssafejoint";
-    validKeywords << "--nssfb21";
-    validKeywords << "--ns-treble";
-    validKeywords << "-o";
-    validKeywords << "-p";
-    validKeywords << "--pad-id3v2";
-    validKeywords << "--preset";
-    validKeywords << "-q";
-    validKeywords << "--quiet";
-    validKeywords << "-r";
-    validKeywords << "--r3mix";
-    validKeywords << "--replaygain-accurate";
-    validKeywords << "--replaygain-fast";
-    validKeywords << "-s";
-    validKeywords << "-S";
-    validKeywords << "--scale";
-    validKeywords << "--scale-l";
-    validKeywords << "--scale-r";
-    validKeywords << "--short";
-    validKeywords << "--silent";
-    validKeywords << "--signed";
-    validKeywords << "--space-id3v1";
-    validKeywords << "--strictly-enforce-ISO";
-    validKeywords << "--substep";
-    validKeywords << "-t";
-    validKeywords << "-T";
-    validKeywords << "--ta";
-    validKeywords << "--tc";
-    validKeywords << "--tg";
-    validKeywords << "--tl";
-    validKeywords << "--tn";
-    validKeywords << "--tt";
-    validKeywords << "--ty";
-    validKeywords << "--unsigned";
-    validKeywords << "-v";
-    validKeywords << "-V";
-    validKeywords << "--vbr-old";
-    validKeywords << "--vbr-new";
-    validKeywords << "-x";
-    validKeywords << "-X";
-    validKeywords << "-Y";
-    validKeywords << "-Z";
-}
-//-----------------------------------------------------------------------------
-// NON-MEMBER FUNCTIONS useable in other parts of the program
-//-----------------------------------------------------------------------------
-/** @brief Pull out a command-line option from a string
-@ingroup lame
-
-The string is examined for the presence of Unix style command-line options
-(starting with a "-" or "--" symbol and preceded by white space). One of the
-options is separated out and
-returned.
-@param[in] QString of command-line LAME options.
-@param[in] index of the option to check.
-@returns a QString of the nth option (n>=0).
-*/
-
-QString parseOptions(QString& options, short n)
-{
-    short tokenNumber = 0;
-    short optNumber = 0;
-    QString option;
-    options = options.simplified();
-    QString token;
-    bool isOptionFound = false;
-    do
-    {
-        token = options.section(" ",tokenNumber,tokenNumber);
-        tokenNumber++;
-        if (isOptionFound)
-        {
-            if (token[0] == '-') break;
-            option += " " + token;
-        }
-        else if (token[0] == '-')       // token is start of an option string
-        {
-            if (optNumber == n)         // this is the one we want
-            {
-                isOptionFound = true;
-                option = token;         // start our returned option string
-            }
-            optNumber++;
-        }
-    }
-    while (token != "");
-    return option;
-}
-//-----------------------------------------------------------------------------
@@ -76,7 +76,6 @@ public:
     void wipeSettings();
     void setDefaultOptions(QString& options);
     void buildOptions();
-    void initializeValidKeywords();
     void stripBadOptions(QString& options);
 private slots:
     void on_browseDirectory_clicked();
@@ -104,14 +103,7 @@ private:
     QString lameOptions_;                 //!< LAME Options from user input.
     QString fileTag_;                     //!< Tag appended to filename.
     QString conversionDirectory_;         //!< Directory for mp3 output files.
-    QStringList validKeywords;            //!< Table of valid option keywords.
     Ui::KLameOptionsDialogueBase optionsDialogueUi; // User Interface object
 };
 
-//-----------------------------------------------------------------------------
-// General functions
-//-----------------------------------------------------------------------------
-QString parseOptions(QString& options, short n);
-//-----------------------------------------------------------------------------
-
 #endif
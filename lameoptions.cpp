@@ -0,0 +1,1047 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "lameoptions.h"
+#include "lamesettings.h"
+
+//-----------------------------------------------------------------------------
+/** @brief -a Mix a stereo input down to mono
+*/
+
+static bool setDownmix(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_mode(gfp,MONO);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --abr Average bitrate in kbps, or in bps above 8000
+*/
+
+static bool setAbr(lame_global_flags* gfp, const LameOption& option)
+{
+    int bitrate = option.intValue;
+    lame_set_VBR(gfp,vbr_abr);
+// Convert bps to kbps for values > 8000
+    if (bitrate >= 8000)
+        bitrate = (bitrate + 500) / 1000;
+    if (bitrate > 320)
+        bitrate = 320;
+    if (bitrate < 8)
+        bitrate = 8;
+    lame_set_VBR_mean_bitrate_kbps(gfp,bitrate);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --add-id3v2 Always write a version 2 tag
+*/
+
+static bool setAddId3v2(lame_global_flags* gfp, const LameOption&)
+{
+    id3tag_add_v2(gfp);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --allshort Use only short blocks
+*/
+
+static bool setAllShort(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_force_short_blocks(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --preset and --alt-preset Preset name, or an average bitrate in kbps
+*/
+
+static bool setPreset(lame_global_flags* gfp, const LameOption& option)
+{
+    const QString& preset = option.parameter;
+    bool isBitrate;
+    int bitrate = preset.toInt(&isBitrate,10);
+    if (isBitrate)
+    {
+        if ((bitrate < 8) || (bitrate > 320)) return false;
+        lame_set_preset(gfp,bitrate);
+    }
+    else if (preset == "standard")
+        lame_set_preset(gfp,STANDARD);
+    else if (preset == "medium")
+        lame_set_preset(gfp,MEDIUM);
+    else if (preset == "extreme")
+        lame_set_preset(gfp,EXTREME);
+    else if (preset == "insane")
+        lame_set_preset(gfp,INSANE);
+    else return false;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --athaa-type Type of ATH auto adjustment
+*/
+
+static bool setAthaaType(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_athaa_type(gfp,option.intValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --athaa-sensitivity Sensitivity of ATH auto adjustment in dB
+*/
+
+static bool setAthaaSensitivity(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_athaa_sensitivity(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --athonly Use only the ATH for masking
+*/
+
+static bool setAthOnly(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_ATHonly(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --athlower Lower the ATH by so many dB
+*/
+
+static bool setAthLower(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_ATHlower(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --athtype Type of ATH curve
+*/
+
+static bool setAthType(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_ATHtype(gfp,option.intValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -b Bitrate, or the minimum bitrate for VBR
+*/
+
+static bool setMinBitrate(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_brate(gfp,option.intValue);
+    lame_set_VBR_min_bitrate_kbps(gfp,lame_get_brate(gfp));
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -B Maximum bitrate for VBR
+*/
+
+static bool setMaxBitrate(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_VBR_max_bitrate_kbps(gfp,option.intValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -c Mark the stream as copyright
+*/
+
+static bool setCopyright(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_copyright(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --cbr Constant bitrate
+*/
+
+static bool setCbr(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_VBR(gfp,vbr_off);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --comp Compression ratio
+*/
+
+static bool setCompression(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_compression_ratio(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --cwlimit Tonality limit in kHz (<50) or Hz
+*/
+
+static bool setCwLimit(lame_global_flags* gfp, const LameOption& option)
+{
+    float frequency = option.floatValue;
+    if (frequency < 50)
+        frequency *= 1000;                  // kHz specifications below 50
+    if (frequency > 50000)
+        frequency = 50000;
+    if (frequency < 1)
+        frequency = 1;
+    lame_set_cwlimit(gfp,(int)frequency);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -e De-emphasis: n none, 5 50/15 microseconds, c CCITT J.17
+*/
+
+static bool setEmphasis(lame_global_flags* gfp, const LameOption& option)
+{
+    const QString& emphasis = option.parameter;
+    if (emphasis == "n")
+        lame_set_emphasis(gfp,0);
+    else if (emphasis == "5")
+        lame_set_emphasis(gfp,1);
+    else if (emphasis == "c")
+        lame_set_emphasis(gfp,3);
+    else return false;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -f Fast encoding at lower quality
+*/
+
+static bool setFast(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_quality(gfp,7);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -F Enforce the minimum VBR bitrate on silence
+*/
+
+static bool setHardMin(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_VBR_hard_min(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --freeformat Free format bitstream
+*/
+
+static bool setFreeFormat(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_free_format(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -h Higher quality encoding
+*/
+
+static bool setHighQuality(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_quality(gfp,2);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --highpass Highpass frequency in kHz (<16) or Hz
+*/
+
+static bool setHighpass(lame_global_flags* gfp, const LameOption& option)
+{
+    float frequency = option.floatValue;
+    if (frequency < 16)
+        frequency *= 1000;                  // kHz specifications below 16
+    if (frequency > 50000)
+        frequency = 50000;
+    if (frequency < 1)
+        frequency = 1;
+    lame_set_highpassfreq(gfp,(int)frequency);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --highpass-width Width of the highpass transition in kHz
+*/
+
+static bool setHighpassWidth(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_highpasswidth(gfp,(int)(option.floatValue*1000));
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --id3v1-only Write only a version 1 tag
+*/
+
+static bool setId3v1Only(lame_global_flags* gfp, const LameOption&)
+{
+    id3tag_v1_only(gfp);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --id3v2-only Write only a version 2 tag
+*/
+
+static bool setId3v2Only(lame_global_flags* gfp, const LameOption&)
+{
+    id3tag_v2_only(gfp);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --interch Inter-channel masking ratio
+*/
+
+static bool setInterChannel(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_interChRatio(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -k No filtering
+*/
+
+static bool setNoFiltering(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_lowpassfreq(gfp,-1);
+    lame_set_highpassfreq(gfp,-1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --lowpass Lowpass frequency in kHz (<50) or Hz
+*/
+
+static bool setLowpass(lame_global_flags* gfp, const LameOption& option)
+{
+    float frequency = option.floatValue;
+    if (frequency < 50)
+        frequency *= 1000;                  // kHz specifications below 50
+    if (frequency > 50000)
+        frequency = 50000;
+    if (frequency < 1)
+        frequency = 1;
+    lame_set_lowpassfreq(gfp,(int)frequency);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --lowpass-width Width of the lowpass transition in kHz
+*/
+
+static bool setLowpassWidth(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_lowpasswidth(gfp,(int)(option.floatValue*1000));
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -m MP3 mode
+*/
+
+static bool setMode(lame_global_flags* gfp, const LameOption& option)
+{
+    const QString& mode = option.parameter;
+    if (mode == "m")
+        lame_set_mode(gfp,MONO);
+    else if (mode == "s")
+        lame_set_mode(gfp,STEREO);
+    else if ((mode == "j") || (mode == "a"))
+        lame_set_mode(gfp,JOINT_STEREO);
+    else if (mode == "f")
+    {
+        lame_set_force_ms(gfp,1);
+        lame_set_mode(gfp,JOINT_STEREO);
+    }
+    else if (mode == "d")
+        lame_set_mode(gfp,DUAL_CHANNEL);
+    else return false;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --noasm Do not use one set of processor instructions
+*/
+
+static bool setNoAsm(lame_global_flags* gfp, const LameOption& option)
+{
+    const QString& instructions = option.parameter;
+    if (instructions == "mmx")
+        lame_set_asm_optimizations(gfp,MMX,0);
+    else if (instructions == "3dnow")
+        lame_set_asm_optimizations(gfp,AMD_3DNOW,0);
+    else if (instructions == "sse")
+        lame_set_asm_optimizations(gfp,SSE,0);
+    else return false;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --noreplaygain Do not compute the ReplayGain
+*/
+
+static bool setNoReplayGain(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_findReplayGain(gfp,0);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --nores Disable the bit reservoir
+*/
+
+static bool setNoReservoir(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_disable_reservoir(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --noshort Do not use short blocks
+*/
+
+static bool setNoShort(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_no_short_blocks(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --notemp Disable temporal masking
+*/
+
+static bool setNoTemporal(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_useTemporal(gfp,0);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --ns-alto, --ns-bass, --ns-treble and --nssfb21 Noise shaping
+adjustments
+
+The adjustment is held in quarter dB steps in a six bit field of the nspsytune
+settings, at the position given for each band.
+*/
+
+template <int shift>
+static bool setNsTune(lame_global_flags* gfp, const LameOption& option)
+{
+    int steps = (int)(option.floatValue*4);
+    if (steps < -32)
+        steps = -32;
+    if (steps > 31)
+        steps = 31;
+    if (steps < 0)
+        steps += 64;
+    lame_set_exp_nspsytune(gfp,lame_get_exp_nspsytune(gfp) | (steps << shift));
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --nspsytune Use the nspsytune psychoacoustic model
+*/
+
+static bool setNsPsytune(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_exp_nspsytune(gfp,lame_get_exp_nspsytune(gfp) | 1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --nsmsfix M/S switching adjustment
+*/
+
+static bool setNsMsfix(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_msfix(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --nssafejoint Safer joint stereo switching
+*/
+
+static bool setNsSafeJoint(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_exp_nspsytune(gfp,lame_get_exp_nspsytune(gfp) | 2);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -o Mark the stream as a copy
+*/
+
+static bool setNotOriginal(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_original(gfp,0);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -p Add CRC error protection
+*/
+
+static bool setErrorProtection(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_error_protection(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --pad-id3v2 Pad the version 2 tag
+*/
+
+static bool setPadId3v2(lame_global_flags* gfp, const LameOption&)
+{
+    id3tag_pad_v2(gfp);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -q Algorithm quality, 0 best to 9 fastest
+*/
+
+static bool setQuality(lame_global_flags* gfp, const LameOption& option)
+{
+    int quality = option.intValue;
+    if (quality < 0)
+        quality = 0;
+    if (quality > 9)
+        quality = 9;
+    lame_set_quality(gfp,quality);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --quiet and --silent Console output
+
+LAME never writes to the console here, as its messages are already sent to
+errorHandler(), so these have nothing more to do.
+*/
+
+static bool setNothing(lame_global_flags*, const LameOption&)
+{
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --r3mix The r3mix VBR preset
+*/
+
+static bool setR3mix(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_preset(gfp,R3MIX);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --replaygain-accurate Compute the ReplayGain from the decoded output
+*/
+
+static bool setReplayGainAccurate(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_findReplayGain(gfp,1);
+    lame_set_decode_on_the_fly(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --replaygain-fast Compute the ReplayGain from the input
+*/
+
+static bool setReplayGainFast(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_findReplayGain(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --resample Output sampling frequency in kHz
+*/
+
+static bool setResample(lame_global_flags* gfp, const LameOption& option)
+{
+    const QString& frequency = option.parameter;
+    int sampleRate;
+    if (frequency == "8")
+        sampleRate = 8000;
+    else if ((frequency == "11.025") || (frequency == "11"))
+        sampleRate = 11025;
+    else if (frequency == "12")
+        sampleRate = 12000;
+    else if (frequency == "16")
+        sampleRate = 16000;
+    else if ((frequency == "22.05") || (frequency == "22"))
+        sampleRate = 22050;
+    else if (frequency == "24")
+        sampleRate = 24000;
+    else if (frequency == "32")
+        sampleRate = 32000;
+    else if ((frequency == "44.1") || (frequency == "44"))
+        sampleRate = 44100;
+    else if (frequency == "48")
+        sampleRate = 48000;
+    else return false;
+    lame_set_out_samplerate(gfp,sampleRate);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --scale Scale the input
+*/
+
+static bool setScale(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_scale(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --scale-l Scale the left channel of the input
+*/
+
+static bool setScaleLeft(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_scale_left(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --scale-r Scale the right channel of the input
+*/
+
+static bool setScaleRight(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_scale_right(gfp,option.floatValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --short Allow short blocks
+*/
+
+static bool setShort(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_no_short_blocks(gfp,0);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --space-id3v1 Pad the version 1 tag with spaces
+*/
+
+static bool setSpaceId3v1(lame_global_flags* gfp, const LameOption&)
+{
+    id3tag_space_v1(gfp);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --strictly-enforce-ISO Comply strictly with the ISO standard
+*/
+
+static bool setStrictIso(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_strict_ISO(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -t Do not write the VBR tag frame
+*/
+
+static bool setNoVbrTag(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_bWriteVbrTag(gfp,0);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -T Write the VBR tag frame, for CBR also
+*/
+
+static bool setVbrTag(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_bWriteVbrTag(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --ta ID3 tag artist
+*/
+
+static bool setTagArtist(lame_global_flags* gfp, const LameOption& option)
+{
+    id3tag_set_artist(gfp,option.textValue.constData());
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --tc ID3 tag comment
+*/
+
+static bool setTagComment(lame_global_flags* gfp, const LameOption& option)
+{
+    id3tag_set_comment(gfp,option.textValue.constData());
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --tl ID3 tag album
+*/
+
+static bool setTagAlbum(lame_global_flags* gfp, const LameOption& option)
+{
+    id3tag_set_album(gfp,option.textValue.constData());
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --tn ID3 tag track number
+*/
+
+static bool setTagTrack(lame_global_flags* gfp, const LameOption& option)
+{
+    id3tag_set_track(gfp,option.textValue.constData());
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --tt ID3 tag title
+*/
+
+static bool setTagTitle(lame_global_flags* gfp, const LameOption& option)
+{
+    id3tag_set_title(gfp,option.textValue.constData());
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --ty ID3 tag year
+*/
+
+static bool setTagYear(lame_global_flags* gfp, const LameOption& option)
+{
+    id3tag_set_year(gfp,option.textValue.constData());
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --tg ID3 tag genre, by name or number
+*/
+
+static bool setTagGenre(lame_global_flags* gfp, const LameOption& option)
+{
+    return id3tag_set_genre(gfp,option.textValue.constData()) == 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief -v Variable bitrate
+*/
+
+static bool setVbr(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_VBR(gfp,vbr_default);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -V VBR quality, 0 best to 9 smallest
+*/
+
+static bool setVbrQuality(lame_global_flags* gfp, const LameOption& option)
+{
+    int quality = option.intValue;
+// If VBR not turned on, turn it on now
+    if (lame_get_VBR(gfp) == vbr_off) lame_set_VBR(gfp,vbr_default);
+    if (quality < 0)
+        quality = 0;
+    if (quality > 9)
+        quality = 9;
+    lame_set_VBR_q(gfp,quality);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --vbr-old The older VBR algorithm
+*/
+
+static bool setVbrOld(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_VBR(gfp,vbr_rh);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief --vbr-new The newer VBR algorithm
+*/
+
+static bool setVbrNew(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_VBR(gfp,vbr_mtrh);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -X Measure used to choose the best quantization
+*/
+
+static bool setQuantComp(lame_global_flags* gfp, const LameOption& option)
+{
+    lame_set_quant_comp(gfp,option.intValue);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -Y Experimental option Y
+*/
+
+static bool setExperimentalY(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_experimentalY(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief -Z Experimental option Z
+*/
+
+static bool setExperimentalZ(lame_global_flags* gfp, const LameOption&)
+{
+    lame_set_experimentalZ(gfp,1);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief The option table
+
+The entries are in the order of LameOptionId, which is checked below when the
+program is compiled.
+*/
+
+constexpr LameOptionDescriptor lameOptionTable[] =
+{
+// Keyword                  Id                         Argument      Shown  Tag   Setter
+  {"-a",                    OPTION_DOWNMIX,            ARGUMENT_NONE, false,false,setDownmix},
+  {"--abr",                 OPTION_ABR,                ARGUMENT_INT,  true, false,setAbr},
+  {"--add-id3v2",           OPTION_ADD_ID3V2,          ARGUMENT_NONE, false,true, setAddId3v2},
+  {"--allshort",            OPTION_ALL_SHORT,          ARGUMENT_NONE, false,false,setAllShort},
+  {"--alt-preset",          OPTION_ALT_PRESET,         ARGUMENT_WORD, false,false,setPreset},
+  {"--athaa-type",          OPTION_ATHAA_TYPE,         ARGUMENT_INT,  false,false,setAthaaType},
+  {"--athaa-sensitivity",   OPTION_ATHAA_SENSITIVITY,  ARGUMENT_FLOAT,false,false,setAthaaSensitivity},
+  {"--athonly",             OPTION_ATH_ONLY,           ARGUMENT_NONE, false,false,setAthOnly},
+  {"--athlower",            OPTION_ATH_LOWER,          ARGUMENT_FLOAT,false,false,setAthLower},
+  {"--athtype",             OPTION_ATH_TYPE,           ARGUMENT_INT,  false,false,setAthType},
+  {"-b",                    OPTION_MIN_BITRATE,        ARGUMENT_INT,  true, false,setMinBitrate},
+  {"-B",                    OPTION_MAX_BITRATE,        ARGUMENT_INT,  true, false,setMaxBitrate},
+  {"-c",                    OPTION_COPYRIGHT,          ARGUMENT_NONE, false,false,setCopyright},
+  {"--cbr",                 OPTION_CBR,                ARGUMENT_NONE, true, false,setCbr},
+  {"--comp",                OPTION_COMPRESSION,        ARGUMENT_FLOAT,false,false,setCompression},
+  {"--cwlimit",             OPTION_CW_LIMIT,           ARGUMENT_FLOAT,true, false,setCwLimit},
+  {"-e",                    OPTION_EMPHASIS,           ARGUMENT_WORD, false,false,setEmphasis},
+  {"-f",                    OPTION_FAST,               ARGUMENT_NONE, false,false,setFast},
+  {"-F",                    OPTION_HARD_MIN,           ARGUMENT_NONE, false,false,setHardMin},
+  {"--freeformat",          OPTION_FREE_FORMAT,        ARGUMENT_NONE, false,false,setFreeFormat},
+  {"-h",                    OPTION_HIGH_QUALITY,       ARGUMENT_NONE, false,false,setHighQuality},
+  {"--highpass",            OPTION_HIGHPASS,           ARGUMENT_FLOAT,true, false,setHighpass},
+  {"--highpass-width",      OPTION_HIGHPASS_WIDTH,     ARGUMENT_FLOAT,true, false,setHighpassWidth},
+  {"--id3v1-only",          OPTION_ID3V1_ONLY,         ARGUMENT_NONE, false,true, setId3v1Only},
+  {"--id3v2-only",          OPTION_ID3V2_ONLY,         ARGUMENT_NONE, false,true, setId3v2Only},
+  {"--interch",             OPTION_INTER_CHANNEL,      ARGUMENT_FLOAT,false,false,setInterChannel},
+  {"-k",                    OPTION_NO_FILTERING,       ARGUMENT_NONE, true, false,setNoFiltering},
+  {"--lowpass",             OPTION_LOWPASS,            ARGUMENT_FLOAT,true, false,setLowpass},
+  {"--lowpass-width",       OPTION_LOWPASS_WIDTH,      ARGUMENT_FLOAT,true, false,setLowpassWidth},
+  {"-m",                    OPTION_MODE,               ARGUMENT_WORD, true, false,setMode},
+  {"--noasm",               OPTION_NO_ASM,             ARGUMENT_WORD, false,false,setNoAsm},
+  {"--noreplaygain",        OPTION_NO_REPLAY_GAIN,     ARGUMENT_NONE, false,false,setNoReplayGain},
+  {"--nores",               OPTION_NO_RESERVOIR,       ARGUMENT_NONE, false,false,setNoReservoir},
+  {"--noshort",             OPTION_NO_SHORT,           ARGUMENT_NONE, false,false,setNoShort},
+  {"--notemp",              OPTION_NO_TEMPORAL,        ARGUMENT_NONE, false,false,setNoTemporal},
+  {"--ns-alto",             OPTION_NS_ALTO,            ARGUMENT_FLOAT,false,false,setNsTune<8>},
+  {"--ns-bass",             OPTION_NS_BASS,            ARGUMENT_FLOAT,false,false,setNsTune<2>},
+  {"--ns-treble",           OPTION_NS_TREBLE,          ARGUMENT_FLOAT,false,false,setNsTune<14>},
+  {"--nssfb21",             OPTION_NS_SFB21,           ARGUMENT_FLOAT,false,false,setNsTune<20>},
+  {"--nspsytune",           OPTION_NS_PSYTUNE,         ARGUMENT_NONE, false,false,setNsPsytune},
+  {"--nsmsfix",             OPTION_NS_MSFIX,           ARGUMENT_FLOAT,false,false,setNsMsfix},
+  {"--nssafejoint",         OPTION_NS_SAFE_JOINT,      ARGUMENT_NONE, false,false,setNsSafeJoint},
+  {"-o",                    OPTION_NOT_ORIGINAL,       ARGUMENT_NONE, false,false,setNotOriginal},
+  {"-p",                    OPTION_ERROR_PROTECTION,   ARGUMENT_NONE, false,false,setErrorProtection},
+  {"--pad-id3v2",           OPTION_PAD_ID3V2,          ARGUMENT_NONE, false,true, setPadId3v2},
+  {"--preset",              OPTION_PRESET,             ARGUMENT_WORD, true, false,setPreset},
+  {"-q",                    OPTION_QUALITY,            ARGUMENT_INT,  true, false,setQuality},
+  {"--quiet",               OPTION_QUIET,              ARGUMENT_NONE, false,false,setNothing},
+  {"--r3mix",               OPTION_R3MIX,              ARGUMENT_NONE, false,false,setR3mix},
+  {"--replaygain-accurate", OPTION_REPLAY_GAIN_ACCURATE,ARGUMENT_NONE,false,false,setReplayGainAccurate},
+  {"--replaygain-fast",     OPTION_REPLAY_GAIN_FAST,   ARGUMENT_NONE, false,false,setReplayGainFast},
+  {"--resample",            OPTION_RESAMPLE,           ARGUMENT_WORD, true, false,setResample},
+  {"--scale",               OPTION_SCALE,              ARGUMENT_FLOAT,false,false,setScale},
+  {"--scale-l",             OPTION_SCALE_LEFT,         ARGUMENT_FLOAT,false,false,setScaleLeft},
+  {"--scale-r",             OPTION_SCALE_RIGHT,        ARGUMENT_FLOAT,false,false,setScaleRight},
+  {"--short",               OPTION_SHORT,              ARGUMENT_NONE, false,false,setShort},
+  {"--silent",              OPTION_SILENT,             ARGUMENT_NONE, true, false,setNothing},
+  {"--space-id3v1",         OPTION_SPACE_ID3V1,        ARGUMENT_NONE, false,true, setSpaceId3v1},
+  {"--strictly-enforce-ISO",OPTION_STRICT_ISO,         ARGUMENT_NONE, false,false,setStrictIso},
+  {"-t",                    OPTION_NO_VBR_TAG,         ARGUMENT_NONE, false,false,setNoVbrTag},
+  {"-T",                    OPTION_VBR_TAG,            ARGUMENT_NONE, false,false,setVbrTag},
+  {"--ta",                  OPTION_TAG_ARTIST,         ARGUMENT_TEXT, false,true, setTagArtist},
+  {"--tc",                  OPTION_TAG_COMMENT,        ARGUMENT_TEXT, false,true, setTagComment},
+  {"--tg",                  OPTION_TAG_GENRE,          ARGUMENT_TEXT, false,true, setTagGenre},
+  {"--tl",                  OPTION_TAG_ALBUM,          ARGUMENT_TEXT, false,true, setTagAlbum},
+  {"--tn",                  OPTION_TAG_TRACK,          ARGUMENT_TEXT, false,true, setTagTrack},
+  {"--tt",                  OPTION_TAG_TITLE,          ARGUMENT_TEXT, false,true, setTagTitle},
+  {"--ty",                  OPTION_TAG_YEAR,           ARGUMENT_TEXT, false,true, setTagYear},
+  {"-v",                    OPTION_VBR,                ARGUMENT_NONE, true, false,setVbr},
+  {"-V",                    OPTION_VBR_QUALITY,        ARGUMENT_INT,  true, false,setVbrQuality},
+  {"--vbr-old",             OPTION_VBR_OLD,            ARGUMENT_NONE, true, false,setVbrOld},
+  {"--vbr-new",             OPTION_VBR_NEW,            ARGUMENT_NONE, true, false,setVbrNew},
+  {"-X",                    OPTION_QUANT_COMP,         ARGUMENT_INT,  true, false,setQuantComp},
+  {"-Y",                    OPTION_EXPERIMENTAL_Y,     ARGUMENT_NONE, false,false,setExperimentalY},
+  {"-Z",                    OPTION_EXPERIMENTAL_Z,     ARGUMENT_NONE, false,false,setExperimentalZ},
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Check that the table entries are in the order of their identifiers
+*/
+
+constexpr bool isTableInOrder()
+{
+    for (int n = 0; n < NUMBER_OF_OPTIONS; n++)
+        if (lameOptionTable[n].id != n) return false;
+    return true;
+}
+
+static_assert(sizeof(lameOptionTable)/sizeof(lameOptionTable[0]) ==
+              NUMBER_OF_OPTIONS,"The option table is missing an option");
+static_assert(isTableInOrder(),"The option table is out of order");
+
+//-----------------------------------------------------------------------------
+/** @defgroup hash Perfect hash of the option keywords
+
+The hash and displace method is used. Each keyword falls in one of
+HASH_BUCKETS buckets by its plain hash, and a displacement is found for each
+bucket that sends all of its keywords to empty slots when it is used to seed
+the hash. The displacements are found by the compiler, so a change to the table
+can never leave two keywords in one slot.
+*/
+/*@{*/
+//-----------------------------------------------------------------------------
+const int HASH_BUCKETS = 32;
+const int HASH_SLOTS = 128;
+const int MAX_DISPLACEMENT = 10000;
+
+struct LameOptionHash
+{
+    int displacement[HASH_BUCKETS];     //!< Hash seed of each bucket.
+    int slot[HASH_SLOTS];               //!< Option in each slot, or -1.
+    bool isComplete;                    //!< Every keyword has a slot.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief One step of the FNV-1a hash
+*/
+
+constexpr quint32 hashStep(quint32 hash, uint character)
+{
+    return (hash ^ character) * 16777619u;
+}
+//-----------------------------------------------------------------------------
+/** @brief Starting value of the hash for a seed
+*/
+
+constexpr quint32 hashStart(int seed)
+{
+    return 2166136261u ^ ((quint32)seed * 2654435769u);
+}
+//-----------------------------------------------------------------------------
+/** @brief Hash of a keyword in the table
+*/
+
+constexpr quint32 hashKeyword(const char* keyword, int seed)
+{
+    quint32 hash = hashStart(seed);
+    for (int n = 0; keyword[n] != 0; n++)
+        hash = hashStep(hash,(uchar)keyword[n]);
+    return hash;
+}
+//-----------------------------------------------------------------------------
+/** @brief Hash of a keyword to be looked up
+
+This must give the same value as the hash of the same keyword in the table.
+*/
+
+static quint32 hashKeyword(const QString& keyword, int seed)
+{
+    quint32 hash = hashStart(seed);
+    const QChar* character = keyword.constData();
+    for (int n = 0; n < keyword.size(); n++)
+        hash = hashStep(hash,character[n].unicode());
+    return hash;
+}
+//-----------------------------------------------------------------------------
+/** @brief Check that the keywords of a bucket all go to empty slots
+
+@param[in] hash the hash built so far.
+@param[in] bucket the bucket to be placed.
+@param[in] displacement hash seed to try.
+*/
+
+constexpr bool isBucketFree(const LameOptionHash& hash, int bucket,
+                            int displacement)
+{
+    for (int n = 0; n < NUMBER_OF_OPTIONS; n++)
+    {
+        if (hashKeyword(lameOptionTable[n].keyword,0) % HASH_BUCKETS !=
+            (quint32)bucket) continue;
+        quint32 slot = hashKeyword(lameOptionTable[n].keyword,displacement)
+                        % HASH_SLOTS;
+        if (hash.slot[slot] != -1) return false;
+// The other keywords of the bucket must not go to the same slot
+        for (int m = 0; m < n; m++)
+        {
+            if (hashKeyword(lameOptionTable[m].keyword,0) % HASH_BUCKETS !=
+                (quint32)bucket) continue;
+            if (hashKeyword(lameOptionTable[m].keyword,displacement)
+                % HASH_SLOTS == slot) return false;
+        }
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Build the perfect hash of the table
+
+The largest buckets are placed first, while there is the most room.
+*/
+
+constexpr LameOptionHash buildOptionHash()
+{
+    LameOptionHash hash {};
+    int bucketSize[HASH_BUCKETS] = {};
+    for (int n = 0; n < NUMBER_OF_OPTIONS; n++)
+        bucketSize[hashKeyword(lameOptionTable[n].keyword,0) % HASH_BUCKETS]++;
+    for (int n = 0; n < HASH_SLOTS; n++)
+        hash.slot[n] = -1;
+    hash.isComplete = true;
+    for (int size = NUMBER_OF_OPTIONS; size > 0; size--)
+    {
+        for (int bucket = 0; bucket < HASH_BUCKETS; bucket++)
+        {
+            if (bucketSize[bucket] != size) continue;
+            int displacement = 1;
+            while ((displacement < MAX_DISPLACEMENT) &&
+                   (! isBucketFree(hash,bucket,displacement)))
+                displacement++;
+            if (displacement == MAX_DISPLACEMENT)
+            {
+                hash.isComplete = false;
+                return hash;
+            }
+            hash.displacement[bucket] = displacement;
+            for (int n = 0; n < NUMBER_OF_OPTIONS; n++)
+            {
+                const char* keyword = lameOptionTable[n].keyword;
+                if (hashKeyword(keyword,0) % HASH_BUCKETS == (quint32)bucket)
+                    hash.slot[hashKeyword(keyword,displacement) % HASH_SLOTS] = n;
+            }
+        }
+    }
+    return hash;
+}
+
+constexpr LameOptionHash optionHash = buildOptionHash();
+static_assert(optionHash.isComplete,"No perfect hash found for the options");
+/*@}*/
+//-----------------------------------------------------------------------------
+/** @brief Find the table entry of an option keyword
+
+@param[in] keyword option keyword such as "-b".
+@returns the table entry, or NULL if the keyword is not accepted.
+*/
+
+const LameOptionDescriptor* findLameOption(const QString& keyword)
+{
+    quint32 bucket = hashKeyword(keyword,0) % HASH_BUCKETS;
+    quint32 slot = hashKeyword(keyword,optionHash.displacement[bucket])
+                    % HASH_SLOTS;
+    int n = optionHash.slot[slot];
+    if ((n < 0) || (keyword != QLatin1String(lameOptionTable[n].keyword)))
+        return NULL;
+    return &lameOptionTable[n];
+}
+//-----------------------------------------------------------------------------
+/** @brief The table entry of an option
+
+@param[in] id identifier of the option.
+*/
+
+const LameOptionDescriptor* lameOption(LameOptionId id)
+{
+    return &lameOptionTable[id];
+}
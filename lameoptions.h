@@ -0,0 +1,159 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef LAMEOPTIONS_H
+#define LAMEOPTIONS_H
+
+#include <QString>
+#include "lame.h"
+
+struct LameOption;
+
+//-----------------------------------------------------------------------------
+/** @brief LAME option table
+
+Every LAME command-line option that kLAME accepts has one entry in a table that
+is fixed at compile time. The entry gives the keyword, the kind of argument the
+option takes, whether the options dialogue has a control for it, and the
+function that applies it to a set of LAME flags. The tokenizer, the check of
+options typed in by the user, the options dialogue and the setting of the LAME
+flags all work from this one table, so an option is either accepted and
+applied, or rejected everywhere.
+
+Keywords are found through a perfect hash that is also built at compile time,
+so a lookup is one hash of the keyword and one string comparison.
+*/
+
+//! Kind of argument taken by an option
+enum LameArgument
+{
+    ARGUMENT_NONE,                    //!< A switch with no argument.
+    ARGUMENT_INT,                     //!< An integer.
+    ARGUMENT_FLOAT,                   //!< A real number.
+    ARGUMENT_WORD,                    //!< One word from a set of choices.
+    ARGUMENT_TEXT                     //!< Text to the next option.
+};
+
+//! Options in table order
+enum LameOptionId
+{
+    OPTION_DOWNMIX,
+    OPTION_ABR,
+    OPTION_ADD_ID3V2,
+    OPTION_ALL_SHORT,
+    OPTION_ALT_PRESET,
+    OPTION_ATHAA_TYPE,
+    OPTION_ATHAA_SENSITIVITY,
+    OPTION_ATH_ONLY,
+    OPTION_ATH_LOWER,
+    OPTION_ATH_TYPE,
+    OPTION_MIN_BITRATE,
+    OPTION_MAX_BITRATE,
+    OPTION_COPYRIGHT,
+    OPTION_CBR,
+    OPTION_COMPRESSION,
+    OPTION_CW_LIMIT,
+    OPTION_EMPHASIS,
+    OPTION_FAST,
+    OPTION_HARD_MIN,
+    OPTION_FREE_FORMAT,
+    OPTION_HIGH_QUALITY,
+    OPTION_HIGHPASS,
+    OPTION_HIGHPASS_WIDTH,
+    OPTION_ID3V1_ONLY,
+    OPTION_ID3V2_ONLY,
+    OPTION_INTER_CHANNEL,
+    OPTION_NO_FILTERING,
+    OPTION_LOWPASS,
+    OPTION_LOWPASS_WIDTH,
+    OPTION_MODE,
+    OPTION_NO_ASM,
+    OPTION_NO_REPLAY_GAIN,
+    OPTION_NO_RESERVOIR,
+    OPTION_NO_SHORT,
+    OPTION_NO_TEMPORAL,
+    OPTION_NS_ALTO,
+    OPTION_NS_BASS,
+    OPTION_NS_TREBLE,
+    OPTION_NS_SFB21,
+    OPTION_NS_PSYTUNE,
+    OPTION_NS_MSFIX,
+    OPTION_NS_SAFE_JOINT,
+    OPTION_NOT_ORIGINAL,
+    OPTION_ERROR_PROTECTION,
+    OPTION_PAD_ID3V2,
+    OPTION_PRESET,
+    OPTION_QUALITY,
+    OPTION_QUIET,
+    OPTION_R3MIX,
+    OPTION_REPLAY_GAIN_ACCURATE,
+    OPTION_REPLAY_GAIN_FAST,
+    OPTION_RESAMPLE,
+    OPTION_SCALE,
+    OPTION_SCALE_LEFT,
+    OPTION_SCALE_RIGHT,
+    OPTION_SHORT,
+    OPTION_SILENT,
+    OPTION_SPACE_ID3V1,
+    OPTION_STRICT_ISO,
+    OPTION_NO_VBR_TAG,
+    OPTION_VBR_TAG,
+    OPTION_TAG_ARTIST,
+    OPTION_TAG_COMMENT,
+    OPTION_TAG_GENRE,
+    OPTION_TAG_ALBUM,
+    OPTION_TAG_TRACK,
+    OPTION_TAG_TITLE,
+    OPTION_TAG_YEAR,
+    OPTION_VBR,
+    OPTION_VBR_QUALITY,
+    OPTION_VBR_OLD,
+    OPTION_VBR_NEW,
+    OPTION_QUANT_COMP,
+    OPTION_EXPERIMENTAL_Y,
+    OPTION_EXPERIMENTAL_Z,
+    NUMBER_OF_OPTIONS
+};
+
+//! Function that applies an option, returning false if its argument is bad
+typedef bool (*LameOptionSetter)(lame_global_flags* gfp,
+                                 const LameOption& option);
+
+//! Table entry describing an option
+struct LameOptionDescriptor
+{
+    const char* keyword;              //!< Keyword such as "-b".
+    LameOptionId id;                  //!< Position in the table.
+    LameArgument argument;            //!< Kind of argument taken.
+    bool isShown;                     //!< The options dialogue has a control.
+    bool isTag;                       //!< Sets an ID3 tag.
+    LameOptionSetter setter;          //!< Applies the option.
+};
+
+const LameOptionDescriptor* findLameOption(const QString& keyword);
+const LameOptionDescriptor* lameOption(LameOptionId id);
+
+#endif
@@ -0,0 +1,345 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "lamesettings.h"
+#include <QMutexLocker>
+
+/* Rough time to encode a frame at each LAME quality, 0 (best) to 9 (fastest),
+relative to the default quality 3, and for each VBR mode relative to CBR. These
+only need to rank the jobs of a batch, so are not measured closely. */
+static const double qualityCost[10] =
+    {3.0, 2.4, 1.6, 1.0, 1.0, 0.85, 0.8, 0.55, 0.5, 0.45};
+static double vbrCost(vbr_mode mode);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The option string is compiled once into options ready to apply. The options
+are then checked by applying them to a trial set of LAME flags, so
+that a column in error is found before any of its conversions are started.
+@param[in] lameOptions QString of command-line LAME options.
+*/
+
+LameSettings::LameSettings(const QString& lameOptions)
+            : lameOptions_(lameOptions),returnCode_("OK"),hasTags_(false),
+              costWeight_(1.0)
+{
+    compiled_ = compileOptions(lameOptions);
+    for (int n = 0; n < compiled_.size(); n++)
+        if (compiled_[n].isValid && compiled_[n].descriptor->isTag)
+            hasTags_ = true;
+    lame_global_flags* gfp = createFlags(returnCode_);
+    if (gfp != NULL)
+    {
+// Complete LAME initialisation and final check of option validity
+        if (lame_init_params(gfp) < 0) returnCode_ = "Parameter Error";
+        else
+        {
+            int quality = lame_get_quality(gfp);
+            if ((quality < 0) || (quality > 9)) quality = 3;
+            costWeight_ = qualityCost[quality]*vbrCost(lame_get_VBR(gfp));
+        }
+        lame_close(gfp);
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief The option string the settings were compiled from
+*/
+
+QString LameSettings::options() const
+{
+    return lameOptions_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate that the options are valid
+*/
+
+bool LameSettings::isValid() const
+{
+    return returnCode_ == "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief The error found in the options, or "OK"
+*/
+
+QString LameSettings::returnCode() const
+{
+    return returnCode_;
+}
+//-----------------------------------------------------------------------------
+/** @brief The settings in a standard form, to show whether they have changed
+
+Each compiled option is given as its keyword and argument on a line of its own,
+so that a change in the spacing of the options does not count as a change.
+*/
+
+QString LameSettings::fingerprint() const
+{
+    QString fingerprint;
+    for (int n = 0; n < compiled_.size(); n++)
+        fingerprint += compiled_[n].keyword + " " + compiled_[n].parameter + "\n";
+    return fingerprint;
+}
+//-----------------------------------------------------------------------------
+/** @brief Create a set of LAME global flags with these settings
+
+Initialise LAME - this returns a pointer to its global flags if successful. The
+compiled options are applied in turn by calling the appropriate LAME function
+to set each one. Nothing is parsed here, so this is cheap enough to do for each
+output of each file.
+
+LAME has no way to reset a set of flags for reuse, so a new set is made each
+time. The caller must still set the input parameters and call
+lame_init_params() before encoding, and must call lame_close() when done.
+@param[out] returnCode error message if the flags could not be created.
+@returns LAME global flags, or NULL if an error occurred.
+*/
+
+lame_global_flags* LameSettings::createFlags(QString& returnCode) const
+{
+    lame_global_flags* gfp = lame_init();
+    if (gfp == NULL)
+    {
+        returnCode = "LAME Initialise Fail";
+        return NULL;
+    }
+/** Set the error message handlers to direct error messages away from the
+console (which probably doesn't exist). This could be changed to direct
+messages to a log file for example.*/
+    lame_set_errorf(gfp,errorHandler);
+    lame_set_debugf(gfp,errorHandler);
+    lame_set_msgf(gfp,errorHandler);
+    if (hasTags_) id3tag_init(gfp);
+    for (int n = 0; n < compiled_.size(); n++)
+    {
+        QString optionReturnCode = setLameSetting(gfp,compiled_[n]);
+        if (optionReturnCode != "OK")
+        {
+            returnCode = optionReturnCode;
+            lame_close(gfp);
+            return NULL;
+        }
+    }
+    return gfp;
+}
+//-----------------------------------------------------------------------------
+/** @brief Relative cost of encoding a sample frame with these settings
+
+This is 1 for CBR at the default quality. It is only an estimate, good enough
+to order the jobs of a batch by the time they will take.
+*/
+
+double LameSettings::costWeight() const
+{
+    return costWeight_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Relative cost of a VBR mode against CBR
+*/
+
+static double vbrCost(vbr_mode mode)
+{
+    switch (mode)
+    {
+    case vbr_off: return 1.0;
+    case vbr_abr: return 1.1;
+    case vbr_rh: return 1.5;                // The old VBR searches hardest
+    default: return 0.9;                    // The new VBR is quicker than CBR
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Check that an output with these settings can be encoded in segments
+
+The segments are joined frame by frame, which only lines up if LAME does not
+resample the input and the frames have a known size. ID3 tags would be written
+into each segment, so an output with tags is never split. Nor is a VBR or ABR
+output, as its Xing/LAME tag frame holds the frame count, seek table and
+encoder delay of the whole stream, which no segment has. This needs LAME to be
+initialised for the input format, so the answer is kept for each format met.
+@param[in] numberChannels Number of channels in the input.
+@param[in] sampleRate samples per second in the input.
+@returns true if the output can be encoded in segments.
+*/
+
+bool LameSettings::canSplit(uint numberChannels, uint sampleRate) const
+{
+    if (hasTags_) return false;
+    quint64 format = ((quint64)numberChannels << 32) | sampleRate;
+    {
+        QMutexLocker locker(&mutex_);
+        QHash<quint64,bool>::const_iterator known = canSplit_.find(format);
+        if (known != canSplit_.end()) return known.value();
+    }
+    QString returnCode = "OK";
+    bool canSplit = false;
+    lame_global_flags* gfp = createFlags(returnCode);
+    if (gfp != NULL)
+    {
+        lame_set_num_channels(gfp,numberChannels);
+        lame_set_in_samplerate(gfp,sampleRate);
+        lame_set_bWriteVbrTag(gfp,0);
+        canSplit = (lame_init_params(gfp) >= 0) &&
+                   (lame_get_out_samplerate(gfp) == (int)sampleRate) &&
+                   (lame_get_free_format(gfp) == 0) &&
+                   (lame_get_VBR(gfp) == vbr_off);
+        lame_close(gfp);
+    }
+    QMutexLocker locker(&mutex_);
+    canSplit_.insert(format,canSplit);
+    return canSplit;
+}
+//-----------------------------------------------------------------------------
+/** @defgroup lame General functions specific to LAME API.
+*/
+/*@{*/
+//-----------------------------------------------------------------------------
+/** @brief LAME allows an output function for error messages to be defined.
+
+Error messages must go to the right place in a GUI environment. This error
+handler for LAME just returns to give no error output. Write to an error stream
+with a print function such as "(void) vfprintf(stderr, format, ap)". This could
+be used to write to a log file for example.
+*/
+
+void errorHandler(const char* format, va_list ap)
+{
+    return;
+}
+//-----------------------------------------------------------------------------
+/** @brief Check the argument of an option and convert it to its type
+
+@param[in,out] option option with its keyword and argument filled in.
+@param[in] extraWords number of words given after the argument.
+*/
+
+static void finishOption(LameOption& option, int extraWords)
+{
+    option.intValue = 0;
+    option.floatValue = 0;
+    option.isValid = (option.descriptor != NULL) && (extraWords == 0);
+    if (! option.isValid) return;
+    switch (option.descriptor->argument)
+    {
+    case ARGUMENT_NONE:
+        option.isValid = option.parameter.isEmpty();
+        break;
+    case ARGUMENT_INT:
+        option.intValue = option.parameter.toInt(&option.isValid,10);
+        break;
+    case ARGUMENT_FLOAT:
+        option.floatValue = option.parameter.toFloat(&option.isValid);
+        break;
+    case ARGUMENT_WORD:
+        option.isValid = ! option.parameter.isEmpty();
+        break;
+    case ARGUMENT_TEXT:
+        option.isValid = ! option.parameter.isEmpty();
+        option.textValue = option.parameter.toLatin1();
+        break;
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Compile a string of command-line options
+
+The string is scanned once. Each option starts with a word beginning with "-"
+and takes in the words that follow it up to the next option. The keyword is
+looked up in the option table as soon as it is met, which gives the kind of
+argument the option takes. A word beginning with "-" is taken as the argument
+of an option that still needs one, so that negative numbers can be given, and
+a text argument takes in all of the words up to the next option.
+
+An option that is not in the table, that lacks its argument or has one of the
+wrong type, or that is followed by more words than it takes is marked as not
+valid. Words ahead of the first option are kept in the same way, so that
+nothing in the string is silently ignored.
+@param[in] options QString of command-line LAME options.
+@returns the compiled options in the order given.
+*/
+
+QVector<LameOption> compileOptions(const QString& options)
+{
+    QVector<LameOption> compiled;
+    const QChar* text = options.constData();
+    int length = options.size();
+    int position = 0;
+    int extraWords = 0;
+    forever
+    {
+        while ((position < length) && text[position].isSpace()) position++;
+        if (position == length) break;
+        int start = position;
+        while ((position < length) && (! text[position].isSpace())) position++;
+        QString word(text + start,position - start);
+        bool isArgument = false;
+        if (! compiled.isEmpty())
+        {
+            const LameOption& current = compiled.last();
+            isArgument = (word[0] != '-') ||
+                         ((current.descriptor != NULL) &&
+                          (current.descriptor->argument != ARGUMENT_NONE) &&
+                          current.parameter.isEmpty());
+        }
+        if (isArgument)
+        {
+            LameOption& current = compiled.last();
+            current.text += " " + word;
+            if (current.parameter.isEmpty())
+                current.parameter = word;
+            else if ((current.descriptor != NULL) &&
+                     (current.descriptor->argument == ARGUMENT_TEXT))
+                current.parameter += " " + word;
+            else extraWords++;
+            continue;
+        }
+        if (! compiled.isEmpty()) finishOption(compiled.last(),extraWords);
+        extraWords = 0;
+        LameOption option;
+        option.text = word;
+        option.keyword = word;
+        option.descriptor = findLameOption(word);
+        compiled.append(option);
+    }
+    if (! compiled.isEmpty()) finishOption(compiled.last(),extraWords);
+    return compiled;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the LAME setting from the option provided.
+
+Take a single compiled option, and set the corresponding LAME setting by
+calling the setter given for it in the option table. The options recognized
+are in fact the options used by the command line form of LAME.
+@param[in] gfp LAME global flags to be set.
+@param[in] option option compiled by compileOptions().
+@returns "OK", or the text of the option if it is not valid.
+*/
+
+QString setLameSetting(lame_global_flags* gfp, const LameOption& option)
+{
+    if ((! option.isValid) || (! option.descriptor->setter(gfp,option)))
+        return option.text;
+    return "OK";
+}
+/*@}*/
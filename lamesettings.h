@@ -0,0 +1,108 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef LAMESETTINGS_H
+#define LAMESETTINGS_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QByteArray>
+#include <stdarg.h>
+#include "lame.h"
+#include "lameoptions.h"
+
+//-----------------------------------------------------------------------------
+/** @brief A single LAME option ready to be applied
+
+The keyword is looked up in the option table and the argument converted to the
+type the option takes when the option is compiled, so that nothing is parsed
+when it is applied.
+*/
+
+struct LameOption
+{
+    QString text;                     //!< The option as written.
+    QString keyword;                  //!< Option keyword such as "-b".
+    QString parameter;                //!< Argument, or empty.
+    const LameOptionDescriptor* descriptor; //!< Table entry, NULL if unknown.
+    int intValue;                     //!< Integer argument.
+    float floatValue;                 //!< Real number argument.
+    QByteArray textValue;             //!< Text argument for ID3 tags.
+    bool isValid;                     //!< Known, with the argument it takes.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Compiled LAME settings of a column
+
+The option string of a column is compiled once for each batch and checked. The
+settings object is then shared by all of the conversions of the column, which
+create their LAME flags from it without parsing the options again.
+
+The settings do not change once compiled and can be used from any thread. The
+only state kept is a record of which input formats the settings allow to be
+encoded in segments.
+
+The relative cost of encoding with the settings is estimated from the quality
+and VBR mode that LAME settles on, so that the longest jobs can be started
+first.
+*/
+
+class LameSettings
+{
+public:
+    LameSettings(const QString& lameOptions);
+    QString options() const;
+    bool isValid() const;
+    QString returnCode() const;
+    QString fingerprint() const;
+    lame_global_flags* createFlags(QString& returnCode) const;
+    bool canSplit(uint numberChannels, uint sampleRate) const;
+    double costWeight() const;
+private:
+    QString lameOptions_;               //!< Option string as given.
+    QVector<LameOption> compiled_;      //!< Options ready to apply.
+    QString returnCode_;                //!< Error found in the options.
+    bool hasTags_;                      //!< Options set ID3 tags.
+    double costWeight_;                 //!< Relative cost of encoding.
+    mutable QMutex mutex_;              //!< Guards the record of formats.
+//! Input formats (channels, rate) checked for splitting into segments.
+    mutable QHash<quint64,bool> canSplit_;
+};
+
+typedef QSharedPointer<const LameSettings> LameSettingsPointer;
+
+//-----------------------------------------------------------------------------
+// LAME general functions
+//-----------------------------------------------------------------------------
+void errorHandler(const char* format, va_list ap);
+QVector<LameOption> compileOptions(const QString& options);
+QString setLameSetting(lame_global_flags* gfp, const LameOption& option);
+//-----------------------------------------------------------------------------
+
+#endif
@@ -40,12 +40,150 @@ for multiprocessor architectures.
  ***************************************************************************/
 
 #include <qapplication.h>
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QScopedPointer>
+#include <QTextStream>
 #include "klamemainform.h"
+#include "batchrunner.h"
 
 int main(int argc,char ** argv)
 {
-    QApplication a(argc,argv);
+/* The batch mode must run where there is no display, so the GUI application is
+only created when batch mode is not asked for. */
+    bool isBatch = false;
+    for (int n = 1; n < argc; n++)
+        if (QByteArray(argv[n]).startsWith("--batch")) isBatch = true;
+    QScopedPointer<QCoreApplication> a(isBatch ?
+                                    new QCoreApplication(argc,argv) :
+                                    new QApplication(argc,argv));
+    QCommandLineParser parser;
+    parser.addHelpOption();
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+            "Number of conversions to run at the same time.","N");
+    parser.addOption(jobsOption);
+    QCommandLineOption segmentOption("segment-length",
+            "Split files longer than twice this into segments encoded in "
+            "parallel (0 to never split).","seconds");
+    parser.addOption(segmentOption);
+    QCommandLineOption blockSizeOption("block-size",
+            "Number of sample frames read and encoded at a time.","frames");
+    parser.addOption(blockSizeOption);
+    QCommandLineOption fsyncOption("fsync",
+            "Force output files to disk: never, file (as each is closed) "
+            "or every N MB.","policy");
+    parser.addOption(fsyncOption);
+    QCommandLineOption rebuildOption("rebuild",
+            "Convert every output, even those that are up to date.");
+    parser.addOption(rebuildOption);
+    QCommandLineOption contentHashOption("content-hash",
+            "Hash the content of the input files as well as their size and "
+            "time to find those that have changed.");
+    parser.addOption(contentHashOption);
+    QCommandLineOption cacheOption("cache",
+            "Keep encoded files in a cache shared across projects, and place "
+            "outputs from it instead of encoding them again.","directory");
+    parser.addOption(cacheOption);
+    QCommandLineOption cacheSizeOption("cache-size",
+            "Limit on the size of the cache, the least recently used files "
+            "being dropped (default 4096).","MB");
+    parser.addOption(cacheSizeOption);
+    QCommandLineOption traceOption("trace",
+            "Save a timeline of the conversions as Chrome trace event JSON, "
+            "for chrome://tracing or Perfetto.","file");
+    parser.addOption(traceOption);
+    QCommandLineOption batchOption("batch",
+            "Convert the input files with the column settings of a project, "
+            "without the GUI.","project");
+    parser.addOption(batchOption);
+    QCommandLineOption journalOption("journal",
+            "Journal of the batch, by default the project file name with "
+            ".journal added (batch mode).","file");
+    parser.addOption(journalOption);
+    QCommandLineOption resumeOption("resume",
+            "Convert the outputs left unfinished by the last batch of the "
+            "project instead of input files (batch mode).");
+    parser.addOption(resumeOption);
+    QCommandLineOption watchOption("watch",
+            "Watch a directory and convert the WAV files written to it as "
+            "they are completed, until stopped; may be given more than once "
+            "(batch mode).","directory");
+    parser.addOption(watchOption);
+    QCommandLineOption inputsOption("inputs",
+            "The arguments that follow are the input WAV files (batch mode).");
+    parser.addOption(inputsOption);
+    parser.addPositionalArgument("inputs","WAV files to convert in batch mode.",
+                                 "[inputs...]");
+    parser.process(*a);
+    if (isBatch)
+    {
+        QTextStream err(stderr);
+        QStringList inputs = parser.positionalArguments();
+        int sources = (inputs.isEmpty() ? 0 : 1) +
+                      (parser.isSet(resumeOption) ? 1 : 0) +
+                      (parser.isSet(watchOption) ? 1 : 0);
+        if ((! parser.isSet(batchOption)) || (sources != 1))
+        {
+            err << "Batch mode needs a project and one of some input files, "
+                   "--resume or --watch.\n";
+            return BATCH_USAGE_ERROR;
+        }
+        BatchRunner runner;
+        if (parser.isSet(jobsOption))
+            runner.setWorkerCount(parser.value(jobsOption).toInt());
+        if (parser.isSet(segmentOption))
+            runner.setSegmentLength(parser.value(segmentOption).toInt());
+        if (parser.isSet(blockSizeOption))
+            runner.setBlockSize(parser.value(blockSizeOption).toInt());
+        if (parser.isSet(fsyncOption) &&
+            (! runner.setFsyncPolicy(parser.value(fsyncOption))))
+        {
+            err << "Unknown fsync policy " << parser.value(fsyncOption) << "\n";
+            return BATCH_USAGE_ERROR;
+        }
+        if (parser.isSet(rebuildOption)) runner.setIncremental(false);
+        if (parser.isSet(contentHashOption)) runner.setContentHash(true);
+        if (parser.isSet(cacheOption))
+            runner.setCache(parser.value(cacheOption),
+                            parser.isSet(cacheSizeOption) ?
+                            parser.value(cacheSizeOption).toInt() :
+                            DEFAULT_CACHE_SIZE);
+        if (parser.isSet(traceOption))
+            runner.setTrace(parser.value(traceOption));
+        runner.setJournal(parser.isSet(journalOption) ?
+                          parser.value(journalOption) :
+                          parser.value(batchOption) + ".journal");
+/* exit() is a static function rather than a slot, so it is connected through a
+functor. The connection is queued so that the exit always reaches the event
+loop, even if the batch were to finish before exec() is entered. */
+        QObject::connect(&runner,&BatchRunner::finished,a.data(),
+                         [](int status) { QCoreApplication::exit(status); },
+                         Qt::QueuedConnection);
+        BatchStatus status;
+        if (parser.isSet(resumeOption)) status = runner.resume();
+        else if (parser.isSet(watchOption))
+            status = runner.watch(parser.value(batchOption),
+                                  parser.values(watchOption));
+        else status = runner.start(parser.value(batchOption),inputs);
+        if (status != BATCH_OK) return status;
+        return a->exec();
+    }
     KLameMainForm w;
+    if (parser.isSet(jobsOption))
+        w.setWorkerCount(parser.value(jobsOption).toInt());
+    if (parser.isSet(segmentOption))
+        w.setSegmentLength(parser.value(segmentOption).toInt());
+    if (parser.isSet(blockSizeOption))
+        w.setBlockSize(parser.value(blockSizeOption).toInt());
+    if (parser.isSet(fsyncOption))
+        w.setFsyncPolicy(parser.value(fsyncOption));
+    if (parser.isSet(rebuildOption)) w.setIncremental(false);
+    if (parser.isSet(contentHashOption)) w.setContentHash(true);
+    if (parser.isSet(cacheOption))
+        w.setCache(parser.value(cacheOption),
+                   parser.isSet(cacheSizeOption) ?
+                   parser.value(cacheSizeOption).toInt() : DEFAULT_CACHE_SIZE);
+    if (parser.isSet(traceOption)) w.setTrace(parser.value(traceOption));
     w.show();
-   return a.exec();
+   return a->exec();
 }
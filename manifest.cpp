@@ -0,0 +1,199 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "manifest.h"
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+// First line of a manifest file
+const QByteArray MANIFEST_HEADER = "kLAME manifest 1";
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+@param[in] directory Output directory that the manifest covers.
+*/
+
+BuildManifest::BuildManifest(const QString& directory) : directory_(directory),
+            isChanged_(false)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Read the manifest of the directory
+
+A directory with no manifest has nothing up to date, which is not an error. A
+manifest in an unknown format is ignored, and replaced when next saved.
+@returns "OK" or an error message.
+*/
+
+QString BuildManifest::load()
+{
+    fingerprints_.clear();
+    QFile file(QDir(directory_).filePath(MANIFEST_FILE_NAME));
+    if (! file.exists()) return "OK";
+    if (! file.open(QIODevice::ReadOnly))
+        return "Could not read the manifest in " + directory_;
+    if (file.readLine().trimmed() != MANIFEST_HEADER) return "OK";
+    while (! file.atEnd())
+    {
+        QByteArray line = file.readLine();
+        if (line.endsWith('\n')) line.chop(1);
+        int tab = line.indexOf('\t');
+        if (tab <= 0) continue;
+        fingerprints_.insert(QString::fromUtf8(line.mid(tab+1)),
+                             QByteArray::fromHex(line.left(tab)));
+    }
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Write the manifest back to the directory if it has changed
+
+@returns "OK" or an error message.
+*/
+
+QString BuildManifest::save()
+{
+    if (! isChanged_) return "OK";
+    QSaveFile file(QDir(directory_).filePath(MANIFEST_FILE_NAME));
+    if (! file.open(QIODevice::WriteOnly))
+        return "Could not write the manifest in " + directory_;
+    file.write(MANIFEST_HEADER + "\n");
+    QHash<QString,QByteArray>::const_iterator entry;
+    for (entry = fingerprints_.constBegin();
+         entry != fingerprints_.constEnd(); ++entry)
+        file.write(entry.value().toHex() + "\t" + entry.key().toUtf8() + "\n");
+    if (! file.commit())
+        return "Could not write the manifest in " + directory_;
+    isChanged_ = false;
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Check whether an output is up to date
+
+@param[in] fileName name of the output file within the directory.
+@param[in] fingerprint fingerprint the output would be written with now.
+@returns true if the output exists and was written with the same fingerprint.
+*/
+
+bool BuildManifest::isUpToDate(const QString& fileName,
+                               const QByteArray& fingerprint) const
+{
+    QHash<QString,QByteArray>::const_iterator entry =
+                fingerprints_.find(fileName);
+    if ((entry == fingerprints_.constEnd()) || (entry.value() != fingerprint))
+        return false;
+    return QFileInfo(QDir(directory_).filePath(fileName)).isFile();
+}
+//-----------------------------------------------------------------------------
+/** @brief Record an output as written
+
+@param[in] fileName name of the output file within the directory.
+@param[in] fingerprint fingerprint the output was written with.
+*/
+
+void BuildManifest::record(const QString& fileName,
+                           const QByteArray& fingerprint)
+{
+    fingerprints_.insert(fileName,fingerprint);
+    isChanged_ = true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Forget an output
+
+This is done as soon as an output is to be written again, so that an output
+left unfinished is never taken to be up to date.
+@param[in] fileName name of the output file within the directory.
+*/
+
+void BuildManifest::remove(const QString& fileName)
+{
+    if (fingerprints_.remove(fileName) > 0) isChanged_ = true;
+}
+//-----------------------------------------------------------------------------
+/** @defgroup fingerprint Fingerprints of the inputs and outputs
+*/
+/*@{*/
+//-----------------------------------------------------------------------------
+/** @brief Fingerprint of an input file
+
+The path, size and modification time of the file are normally taken to show
+whether it has changed, which needs no more than the directory entry. The
+content can also be hashed where the times cannot be trusted, for example
+after files have been copied without keeping them. To keep this fast only
+blocks of CONTENT_SAMPLE_SIZE bytes from the start, middle and end of the file
+are hashed, which with the size catches any edit of the audio short of one
+that keeps every sample count and leaves those blocks alone.
+@param[in] inputFile WAV file.
+@param[in] useContentHash include a hash of the content.
+@returns the fingerprint, or an empty array if the file cannot be read.
+*/
+
+QByteArray inputFingerprint(const QString& inputFile, bool useContentHash)
+{
+    QFileInfo fileInfo(inputFile);
+    if (! fileInfo.isFile()) return QByteArray();
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(fileInfo.absoluteFilePath().toUtf8());
+    hash.addData(QByteArray::number(fileInfo.size()));
+    hash.addData(QByteArray::number(fileInfo.lastModified().toMSecsSinceEpoch()));
+    if (useContentHash)
+    {
+        QFile file(inputFile);
+        if (! file.open(QIODevice::ReadOnly)) return QByteArray();
+        qint64 size = file.size();
+        qint64 offsets[3] = {0,(size - CONTENT_SAMPLE_SIZE)/2,
+                             size - CONTENT_SAMPLE_SIZE};
+        for (int n = 0; n < 3; n++)
+        {
+            if ((n > 0) && (size <= n*CONTENT_SAMPLE_SIZE)) break;
+            file.seek(qMax(offsets[n],(qint64)0));
+            hash.addData(file.read(CONTENT_SAMPLE_SIZE));
+        }
+    }
+    return hash.result();
+}
+//-----------------------------------------------------------------------------
+/** @brief Fingerprint of an output
+
+@param[in] inputFingerprint fingerprint of the input file.
+@param[in] settings compiled LAME settings of the output's column.
+@returns the fingerprint.
+*/
+
+QByteArray outputFingerprint(const QByteArray& inputFingerprint,
+                             const LameSettings& settings)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    hash.addData(inputFingerprint);
+    hash.addData(settings.fingerprint().toUtf8());
+    hash.addData(QByteArray(get_lame_version()));
+    return hash.result();
+}
+/*@}*/
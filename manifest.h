@@ -0,0 +1,79 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef MANIFEST_H
+#define MANIFEST_H
+
+#include <QString>
+#include <QHash>
+#include <QByteArray>
+#include "lamesettings.h"
+
+// Name of the manifest file kept in each output directory
+const QString MANIFEST_FILE_NAME = ".klame-manifest";
+// Bytes read from each of the start, middle and end of a file for its hash
+const qint64 CONTENT_SAMPLE_SIZE = 64 << 10;
+
+//-----------------------------------------------------------------------------
+/** @brief Record of the outputs in a directory that are up to date
+
+A manifest is kept in each output directory, holding a fingerprint for each mp3
+file that kLAME has written there. The fingerprint covers everything the
+output depends on: the input file, the compiled LAME settings of its column and
+the version of the LAME library. When a batch is run again an output whose
+fingerprint has not changed, and which still exists, is not encoded again.
+
+The manifest is a text file of one line per output, giving the fingerprint in
+hex and the file name separated by a tab, after a line that identifies the
+format. It is written whole to a temporary file which then replaces the old
+one, so that it is never left half written.
+*/
+
+class BuildManifest
+{
+public:
+    BuildManifest(const QString& directory);
+    QString load();
+    QString save();
+    bool isUpToDate(const QString& fileName,
+                    const QByteArray& fingerprint) const;
+    void record(const QString& fileName, const QByteArray& fingerprint);
+    void remove(const QString& fileName);
+private:
+    QString directory_;                 //!< Output directory.
+    QHash<QString,QByteArray> fingerprints_; //!< Fingerprint of each output.
+    bool isChanged_;                    //!< Needs to be saved.
+};
+
+//-----------------------------------------------------------------------------
+// Fingerprint functions
+//-----------------------------------------------------------------------------
+QByteArray inputFingerprint(const QString& inputFile, bool useContentHash);
+QByteArray outputFingerprint(const QByteArray& inputFingerprint,
+                             const LameSettings& settings);
+//-----------------------------------------------------------------------------
+
+#endif
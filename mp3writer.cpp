@@ -0,0 +1,399 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "mp3writer.h"
+#include <QSaveFile>
+#include <QMutexLocker>
+#ifdef Q_OS_WIN
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The thread must be started before anything is written.
+*/
+
+Mp3Writer::Mp3Writer(QObject* parent) : QThread(parent),queuedBytes_(0),
+                        isStopping_(false),fsyncPolicy_(FSYNC_NEVER),
+                        fsyncBytes_(0),trace_(NULL),nextFile_(0)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+Everything queued is written and the files closed before the thread stops.
+*/
+
+Mp3Writer::~Mp3Writer()
+{
+    {
+        QMutexLocker locker(&mutex_);
+        isStopping_ = true;
+        queueNotEmpty_.wakeAll();
+    }
+    wait();
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the fsync policy from its text form
+
+@param[in] policy "never", "file" to sync each file as it is closed, or a
+number of MB to sync after every so many MB written to a file.
+@returns false if the policy is not recognised, in which case it is unchanged.
+*/
+
+bool Mp3Writer::setFsyncPolicy(const QString& policy)
+{
+    if (policy == "never") setFsyncPolicy(FSYNC_NEVER);
+    else if (policy == "file") setFsyncPolicy(FSYNC_PER_FILE);
+    else
+    {
+        bool isNumber;
+        uint megabytes = policy.toUInt(&isNumber);
+        if ((! isNumber) || (megabytes == 0)) return false;
+        setFsyncPolicy(FSYNC_EVERY_N_MB,megabytes);
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the fsync policy
+
+Whatever the policy, a file that is synced at all is also synced when it is
+closed.
+@param[in] policy when data is to be forced out to the disk.
+@param[in] megabytes MB written to a file between syncs for FSYNC_EVERY_N_MB.
+*/
+
+void Mp3Writer::setFsyncPolicy(FsyncPolicy policy, uint megabytes)
+{
+    QMutexLocker locker(&mutex_);
+    fsyncPolicy_ = policy;
+    fsyncBytes_ = (qint64)megabytes << 20;
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the timeline the writer records its work in
+
+@param[in] trace Trace of the batch, or null if the batch is not traced.
+*/
+
+void Mp3Writer::setTrace(ConversionTrace* trace)
+{
+    QMutexLocker locker(&mutex_);
+    trace_ = trace;
+}
+//-----------------------------------------------------------------------------
+/** @brief Open an output file
+
+This is called by an encoder and returns straight away. The file is created by
+the writer thread.
+@param[in] fileName File to be written.
+@returns handle to be used for the file.
+*/
+
+int Mp3Writer::openFile(const QString& fileName)
+{
+    WriteRequest request;
+    request.type = WriteRequest::OPEN;
+    request.file = nextFile_.fetchAndAddRelaxed(1);
+    request.fileName = fileName;
+    emit fileOpened(fileName);
+    enqueue(request);
+    return request.file;
+}
+//-----------------------------------------------------------------------------
+/** @brief Queue data to be written to a file
+
+The data is shared with the caller rather than copied. The caller is held back
+only if the queue is over its limit.
+@param[in] file handle of the file.
+@param[in] data data to be written.
+*/
+
+void Mp3Writer::write(int file, const QByteArray& data)
+{
+    WriteRequest request;
+    request.type = WriteRequest::WRITE;
+    request.file = file;
+    request.data = data;
+    enqueue(request);
+}
+//-----------------------------------------------------------------------------
+/** @brief Close a file once everything queued for it is written
+
+The file takes its own name only when it has been written without error.
+@param[in] file handle of the file.
+*/
+
+void Mp3Writer::closeFile(int file)
+{
+    WriteRequest request;
+    request.type = WriteRequest::CLOSE;
+    request.file = file;
+    enqueue(request);
+}
+//-----------------------------------------------------------------------------
+/** @brief Drop a file, leaving any earlier file of the same name in place
+
+@param[in] file handle of the file.
+*/
+
+void Mp3Writer::discardFile(int file)
+{
+    WriteRequest request;
+    request.type = WriteRequest::DISCARD;
+    request.file = file;
+    enqueue(request);
+}
+//-----------------------------------------------------------------------------
+/** @brief Add a request to the queue
+
+Back-pressure is applied here: while the data waiting is over the limit the
+caller waits for the writer thread to catch up.
+*/
+
+void Mp3Writer::enqueue(const WriteRequest& request)
+{
+    QMutexLocker locker(&mutex_);
+    while ((request.data.size() > 0) && (queuedBytes_ > WRITE_QUEUE_LIMIT))
+        queueNotFull_.wait(&mutex_);
+    queue_.enqueue(request);
+    queuedBytes_ += request.data.size();
+    queueNotEmpty_.wakeOne();
+}
+//-----------------------------------------------------------------------------
+/** @brief Writer thread body
+
+Requests are taken from the queue in order and done. An error on a file is kept
+for it and reported when it is closed, and the rest of its data is discarded.
+A file closed with an error is discarded too.
+*/
+
+void Mp3Writer::run()
+{
+    forever
+    {
+        WriteRequest request;
+        FsyncPolicy fsyncPolicy;
+        qint64 fsyncBytes;
+        ConversionTrace* trace;
+        {
+            QMutexLocker locker(&mutex_);
+            while (queue_.isEmpty() && (! isStopping_))
+                queueNotEmpty_.wait(&mutex_);
+            if (queue_.isEmpty()) return;
+            request = queue_.dequeue();
+            queuedBytes_ -= request.data.size();
+            queueNotFull_.wakeAll();
+            fsyncPolicy = fsyncPolicy_;
+            fsyncBytes = fsyncBytes_;
+            trace = trace_;
+        }
+        if (request.type == WriteRequest::OPEN)
+        {
+            TraceSpan openSpan(trace,"create",request.fileName);
+            OutputFile outputFile;
+            outputFile.file = new QSaveFile(request.fileName);
+            outputFile.fileName = request.fileName;
+            outputFile.returnCode = "OK";
+            outputFile.unsyncedBytes = 0;
+            if (! outputFile.file->open(QIODevice::WriteOnly |
+                                        QIODevice::Unbuffered))
+                outputFile.returnCode = "Could not open an output file.";
+            files_.insert(request.file,outputFile);
+            continue;
+        }
+        QHash<int,OutputFile>::iterator outputFile = files_.find(request.file);
+        if (outputFile == files_.end()) continue;
+        if (request.type == WriteRequest::WRITE)
+        {
+            if (outputFile->returnCode != "OK") continue;
+            TraceSpan writeSpan(trace,"write");
+            if (outputFile->file->write(request.data) != request.data.size())
+                outputFile->returnCode = "Could not write an output file.";
+            outputFile->unsyncedBytes += request.data.size();
+            if ((fsyncPolicy == FSYNC_EVERY_N_MB) &&
+                (outputFile->unsyncedBytes >= fsyncBytes))
+                syncFile(*outputFile);
+        }
+        else if (request.type == WriteRequest::CLOSE)
+        {
+            if ((fsyncPolicy != FSYNC_NEVER) &&
+                (outputFile->returnCode == "OK"))
+            {
+                TraceSpan syncSpan(trace,"fsync");
+                syncFile(*outputFile);
+            }
+            if (outputFile->returnCode == "OK")
+            {
+                TraceSpan renameSpan(trace,"rename",outputFile->fileName);
+                if (! outputFile->file->commit())
+                    outputFile->returnCode = "Could not write an output file.";
+            }
+            else outputFile->file->cancelWriting();
+            emit fileClosed(outputFile->fileName,outputFile->returnCode);
+            delete outputFile->file;
+            files_.erase(outputFile);
+        }
+        else
+        {
+            outputFile->file->cancelWriting();
+            emit fileDiscarded(outputFile->fileName);
+            delete outputFile->file;
+            files_.erase(outputFile);
+        }
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Force the data written to a file out to the disk
+*/
+
+void Mp3Writer::syncFile(OutputFile& outputFile)
+{
+    outputFile.file->flush();
+#ifdef Q_OS_WIN
+    int result = _commit(outputFile.file->handle());
+#else
+    int result = fsync(outputFile.file->handle());
+#endif
+    if (result != 0) outputFile.returnCode = "Could not write an output file.";
+    outputFile.unsyncedBytes = 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Output Stream Class Definitions
+
+@param[in] writer Thread that writes the file.
+@param[in] fileName File to be written.
+*/
+
+Mp3OutputStream::Mp3OutputStream(Mp3Writer* writer, const QString& fileName)
+            : writer_(writer),fileName_(fileName),file_(-1)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+The file is discarded if the stream has not been committed, as a QSaveFile
+would be.
+*/
+
+Mp3OutputStream::~Mp3OutputStream()
+{
+    cancelWriting();
+}
+//-----------------------------------------------------------------------------
+/** @brief Open the stream for writing
+
+The file is opened by the writer thread, so any error in opening it is
+reported when it is closed.
+*/
+
+bool Mp3OutputStream::open(OpenMode mode)
+{
+    if ((mode & ReadOnly) || isOpen()) return false;
+    file_ = writer_->openFile(fileName_);
+    buffer_.reserve(WRITE_BUFFER_SIZE);
+    return QIODevice::open(mode);
+}
+//-----------------------------------------------------------------------------
+/** @brief Pass on what is left and close the file under its own name
+
+Any error in writing the file is reported by the writer when it is closed.
+@returns false if the stream was not open.
+*/
+
+bool Mp3OutputStream::commit()
+{
+    if (! isOpen()) return false;
+    if (buffer_.size() > 0) writer_->write(file_,buffer_);
+    writer_->closeFile(file_);
+    buffer_ = QByteArray();
+    QIODevice::close();
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Drop the file written so far
+*/
+
+void Mp3OutputStream::cancelWriting()
+{
+    if (! isOpen()) return;
+    writer_->discardFile(file_);
+    buffer_ = QByteArray();
+    QIODevice::close();
+}
+//-----------------------------------------------------------------------------
+/** @brief Close the stream without committing it, which discards the file
+*/
+
+void Mp3OutputStream::close()
+{
+    cancelWriting();
+}
+//-----------------------------------------------------------------------------
+/** @brief The stream has no random access
+*/
+
+bool Mp3OutputStream::isSequential() const
+{
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief The stream cannot be read
+*/
+
+qint64 Mp3OutputStream::readData(char*, qint64)
+{
+    return -1;
+}
+//-----------------------------------------------------------------------------
+/** @brief Gather frames into the buffer, passing on each one as it fills
+*/
+
+qint64 Mp3OutputStream::writeData(const char* data, qint64 maxSize)
+{
+    qint64 written = 0;
+    while (written < maxSize)
+    {
+        qint64 space = WRITE_BUFFER_SIZE - buffer_.size();
+        qint64 length = qMin(space,maxSize - written);
+        buffer_.append(data + written,length);
+        written += length;
+        if (buffer_.size() == WRITE_BUFFER_SIZE) sendBuffer();
+    }
+    return written;
+}
+//-----------------------------------------------------------------------------
+/** @brief Hand the buffer over to the writer thread and start a new one
+*/
+
+void Mp3OutputStream::sendBuffer()
+{
+    writer_->write(file_,buffer_);
+    buffer_ = QByteArray();
+    buffer_.reserve(WRITE_BUFFER_SIZE);
+}
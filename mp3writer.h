@@ -0,0 +1,162 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef MP3WRITER_H
+#define MP3WRITER_H
+
+#include <QThread>
+#include <QIODevice>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QQueue>
+#include <QHash>
+#include <QString>
+#include <QByteArray>
+#include <QAtomicInt>
+#include "trace.h"
+
+// Size of the buffers handed to the output thread, and of each file write
+const int WRITE_BUFFER_SIZE = 1 << 20;
+// Bytes queued for writing before the encoders are held back
+const qint64 WRITE_QUEUE_LIMIT = 64 << 20;
+
+class QSaveFile;
+
+//-----------------------------------------------------------------------------
+/** @brief Output writer thread
+
+All mp3 output files are written by this one thread, so that the encoders never
+wait on a write to a slow disk or a network file system. The encoders pass
+their frames in large buffers through a queue, and the writer thread opens,
+writes and closes the files in the order the requests were queued.
+
+If the queue grows beyond WRITE_QUEUE_LIMIT bytes the encoders are held back
+until the writer has caught up, so that a slow output cannot take up all the
+memory.
+
+Files are opened and closed asynchronously. A signal is emitted when a file is
+opened and another when it has been closed, with any error that occurred while
+it was being written. Whether the data is forced out to the disk is set by the
+fsync policy.
+
+Each file is written under a temporary name in its directory and renamed to its
+own name only when it is closed without error, so that a file that is discarded
+or left unfinished by a crash never appears as a dud mp3 file.
+*/
+
+class Mp3Writer : public QThread
+{
+    Q_OBJECT
+public:
+    enum FsyncPolicy
+    {
+        FSYNC_NEVER,                  //!< Leave it to the operating system.
+        FSYNC_PER_FILE,               //!< Sync each file as it is closed.
+        FSYNC_EVERY_N_MB              //!< Sync after every so many MB.
+    };
+    Mp3Writer(QObject* parent = 0);
+    ~Mp3Writer();
+    bool setFsyncPolicy(const QString& policy);
+    void setFsyncPolicy(FsyncPolicy policy, uint megabytes = 0);
+    void setTrace(ConversionTrace* trace);
+    int openFile(const QString& fileName);
+    void write(int file, const QByteArray& data);
+    void closeFile(int file);
+    void discardFile(int file);
+signals:
+    void fileOpened(const QString& fileName);
+    void fileClosed(const QString& fileName, const QString& returnCode);
+    void fileDiscarded(const QString& fileName);
+protected:
+    void run();
+private:
+//! A request to the writer thread
+    struct WriteRequest
+    {
+        enum { OPEN, WRITE, CLOSE, DISCARD } type;
+        int file;
+        QString fileName;
+        QByteArray data;
+    };
+//! A file open in the writer thread
+    struct OutputFile
+    {
+        QSaveFile* file;
+        QString fileName;
+        QString returnCode;
+        qint64 unsyncedBytes;
+    };
+    void enqueue(const WriteRequest& request);
+    void syncFile(OutputFile& outputFile);
+    QMutex mutex_;                      //!< Guards the queue and policy.
+    QWaitCondition queueNotEmpty_;      //!< Wakes the writer thread.
+    QWaitCondition queueNotFull_;       //!< Releases held back encoders.
+    QQueue<WriteRequest> queue_;        //!< Requests waiting to be done.
+    qint64 queuedBytes_;                //!< Data waiting to be written.
+    bool isStopping_;                   //!< Finish the queue then stop.
+    FsyncPolicy fsyncPolicy_;           //!< When to force data to disk.
+    qint64 fsyncBytes_;                 //!< Bytes between syncs.
+    ConversionTrace* trace_;            //!< Timeline of the batch, or null.
+    QAtomicInt nextFile_;               //!< Handle of the next file opened.
+    QHash<int,OutputFile> files_;       //!< Open files, writer thread only.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Output stream to a file written by the writer thread
+
+This is a write-only device that gathers the frames from an encoder into
+buffers of WRITE_BUFFER_SIZE bytes and passes them on to the writer thread
+whole, so that the file is written in large writes at aligned offsets.
+Committing the stream passes on the last part buffer and returns straight away.
+As with a QSaveFile, a stream that is closed or deleted without being committed
+is discarded.
+
+The stream belongs to one encoder and is not shared between threads.
+*/
+
+class Mp3OutputStream : public QIODevice
+{
+    Q_OBJECT
+public:
+    Mp3OutputStream(Mp3Writer* writer, const QString& fileName);
+    ~Mp3OutputStream();
+    bool open(OpenMode mode);
+    bool commit();
+    void cancelWriting();
+    void close();
+    bool isSequential() const;
+protected:
+    qint64 readData(char* data, qint64 maxSize);
+    qint64 writeData(const char* data, qint64 maxSize);
+private:
+    void sendBuffer();
+    Mp3Writer* writer_;                 //!< Thread writing the file.
+    QString fileName_;                  //!< File to be written.
+    int file_;                          //!< Handle given by the writer.
+    QByteArray buffer_;                 //!< Frames not yet passed on.
+};
+
+#endif
@@ -0,0 +1,477 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "pcmconvert.h"
+#include <QAtomicPointer>
+#include <string.h>
+
+// x86 kernels are built for their own instruction set and chosen at run time
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCM_HAS_X86
+#include <immintrin.h>
+#endif
+// NEON is part of the ARM architecture targeted, so is chosen when built
+#if (defined(__ARM_NEON) || defined(__ARM_NEON__)) && \
+    (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#define PCM_HAS_NEON
+#include <arm_neon.h>
+#endif
+
+//-----------------------------------------------------------------------------
+/** @brief One set of conversion kernels
+
+Each kernel converts a block of frames of one sample format. The mono kernels
+ignore the right channel buffer. 24 bit files are rare enough that every set
+uses the scalar kernels for them.
+*/
+
+struct PcmKernels
+{
+    PcmKernelSet kernelSet;
+    void (*stereo16)(const uchar* samples, short* left, short* right,
+                     uint frames);
+    void (*mono16)(const uchar* samples, short* left, uint frames);
+    void (*stereo8)(const uchar* samples, short* left, short* right,
+                    uint frames);
+    void (*mono8)(const uchar* samples, short* left, uint frames);
+    void (*stereo24)(const uchar* samples, short* left, short* right,
+                     uint frames);
+    void (*mono24)(const uchar* samples, short* left, uint frames);
+};
+
+//-----------------------------------------------------------------------------
+/** @defgroup scalar Portable scalar kernels
+
+The samples are built up byte by byte so that these are correct for either byte
+order of the host. 8 bit samples are unsigned with the centre at 128, and are
+moved to the centre of the signed 16 bit range so that the encoder sees the
+same level that a 16 bit file would give. 24 bit samples are cut down to their
+upper 16 bits.
+*/
+/*@{*/
+
+static void stereo16Scalar(const uchar* samples, short* left, short* right,
+                           uint frames)
+{
+    for (uint n = 0; n < frames; n++)
+    {
+        left[n] = (short) (samples[4*n+1]*256 + samples[4*n]);
+        right[n] = (short) (samples[4*n+3]*256 + samples[4*n+2]);
+    }
+}
+
+static void mono16Scalar(const uchar* samples, short* left, uint frames)
+{
+    for (uint n = 0; n < frames; n++)
+        left[n] = (short) (samples[2*n+1]*256 + samples[2*n]);
+}
+
+static void stereo8Scalar(const uchar* samples, short* left, short* right,
+                          uint frames)
+{
+    for (uint n = 0; n < frames; n++)
+    {
+        left[n] = (short) ((samples[2*n] - 128)*256);
+        right[n] = (short) ((samples[2*n+1] - 128)*256);
+    }
+}
+
+static void mono8Scalar(const uchar* samples, short* left, uint frames)
+{
+    for (uint n = 0; n < frames; n++)
+        left[n] = (short) ((samples[n] - 128)*256);
+}
+
+static void stereo24Scalar(const uchar* samples, short* left, short* right,
+                           uint frames)
+{
+    for (uint n = 0; n < frames; n++)
+    {
+        left[n] = (short) (samples[6*n+2]*256 + samples[6*n+1]);
+        right[n] = (short) (samples[6*n+5]*256 + samples[6*n+4]);
+    }
+}
+
+static void mono24Scalar(const uchar* samples, short* left, uint frames)
+{
+    for (uint n = 0; n < frames; n++)
+        left[n] = (short) (samples[3*n+2]*256 + samples[3*n+1]);
+}
+
+static const PcmKernels scalarKernels =
+    {PCM_SCALAR,stereo16Scalar,mono16Scalar,stereo8Scalar,mono8Scalar,
+     stereo24Scalar,mono24Scalar};
+/*@}*/
+
+#ifdef PCM_HAS_X86
+//-----------------------------------------------------------------------------
+/** @defgroup sse2 SSE2 kernels
+
+Interleaved 16 bit pairs are split by treating each pair as a 32 bit word: an
+arithmetic shift right leaves the right sample sign extended and a shift left
+then right leaves the left one, and the words are packed back down to 16 bits.
+8 bit samples are recentred by flipping the top bit, which turns them into
+signed bytes, and are then placed in the upper byte of each 16 bit word.
+*/
+/*@{*/
+
+__attribute__((target("sse2")))
+static inline void splitPairsSse2(__m128i a, __m128i b,
+                                  short* left, short* right)
+{
+    __m128i leftWords = _mm_packs_epi32(
+                    _mm_srai_epi32(_mm_slli_epi32(a,16),16),
+                    _mm_srai_epi32(_mm_slli_epi32(b,16),16));
+    __m128i rightWords = _mm_packs_epi32(_mm_srai_epi32(a,16),
+                                         _mm_srai_epi32(b,16));
+    _mm_storeu_si128((__m128i*) left,leftWords);
+    _mm_storeu_si128((__m128i*) right,rightWords);
+}
+
+__attribute__((target("sse2")))
+static void stereo16Sse2(const uchar* samples, short* left, short* right,
+                         uint frames)
+{
+    uint n = 0;
+    for (; n + 8 <= frames; n += 8)
+    {
+        __m128i a = _mm_loadu_si128((const __m128i*) (samples+4*n));
+        __m128i b = _mm_loadu_si128((const __m128i*) (samples+4*n+16));
+        splitPairsSse2(a,b,left+n,right+n);
+    }
+    stereo16Scalar(samples+4*n,left+n,right+n,frames-n);
+}
+
+static void mono16Copy(const uchar* samples, short* left, uint frames)
+{
+    memcpy(left,samples,2*frames);          // Already in host order
+}
+
+__attribute__((target("sse2")))
+static void stereo8Sse2(const uchar* samples, short* left, short* right,
+                        uint frames)
+{
+    const __m128i centre = _mm_set1_epi8((char) 0x80);
+    const __m128i zero = _mm_setzero_si128();
+    uint n = 0;
+    for (; n + 8 <= frames; n += 8)
+    {
+        __m128i bytes = _mm_xor_si128(centre,
+                    _mm_loadu_si128((const __m128i*) (samples+2*n)));
+        splitPairsSse2(_mm_unpacklo_epi8(zero,bytes),
+                       _mm_unpackhi_epi8(zero,bytes),left+n,right+n);
+    }
+    stereo8Scalar(samples+2*n,left+n,right+n,frames-n);
+}
+
+__attribute__((target("sse2")))
+static void mono8Sse2(const uchar* samples, short* left, uint frames)
+{
+    const __m128i centre = _mm_set1_epi8((char) 0x80);
+    const __m128i zero = _mm_setzero_si128();
+    uint n = 0;
+    for (; n + 16 <= frames; n += 16)
+    {
+        __m128i bytes = _mm_xor_si128(centre,
+                    _mm_loadu_si128((const __m128i*) (samples+n)));
+        _mm_storeu_si128((__m128i*) (left+n),_mm_unpacklo_epi8(zero,bytes));
+        _mm_storeu_si128((__m128i*) (left+n+8),_mm_unpackhi_epi8(zero,bytes));
+    }
+    mono8Scalar(samples+n,left+n,frames-n);
+}
+
+static const PcmKernels sse2Kernels =
+    {PCM_SSE2,stereo16Sse2,mono16Copy,stereo8Sse2,mono8Sse2,
+     stereo24Scalar,mono24Scalar};
+/*@}*/
+
+//-----------------------------------------------------------------------------
+/** @defgroup avx2 AVX2 kernels
+
+These work as the SSE2 kernels on twice as many samples. The AVX2 pack works
+within each 128 bit lane, so the 64 bit quarters are put back in order after
+packing.
+*/
+/*@{*/
+
+__attribute__((target("avx2")))
+static inline void splitPairsAvx2(__m256i a, __m256i b,
+                                  short* left, short* right)
+{
+    __m256i leftWords = _mm256_packs_epi32(
+                    _mm256_srai_epi32(_mm256_slli_epi32(a,16),16),
+                    _mm256_srai_epi32(_mm256_slli_epi32(b,16),16));
+    __m256i rightWords = _mm256_packs_epi32(_mm256_srai_epi32(a,16),
+                                            _mm256_srai_epi32(b,16));
+    _mm256_storeu_si256((__m256i*) left,
+                        _mm256_permute4x64_epi64(leftWords,0xD8));
+    _mm256_storeu_si256((__m256i*) right,
+                        _mm256_permute4x64_epi64(rightWords,0xD8));
+}
+
+__attribute__((target("avx2")))
+static void stereo16Avx2(const uchar* samples, short* left, short* right,
+                         uint frames)
+{
+    uint n = 0;
+    for (; n + 16 <= frames; n += 16)
+    {
+        __m256i a = _mm256_loadu_si256((const __m256i*) (samples+4*n));
+        __m256i b = _mm256_loadu_si256((const __m256i*) (samples+4*n+32));
+        splitPairsAvx2(a,b,left+n,right+n);
+    }
+    stereo16Sse2(samples+4*n,left+n,right+n,frames-n);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i widen8Avx2(__m128i bytes)
+{
+    const __m128i centre = _mm_set1_epi8((char) 0x80);
+    return _mm256_slli_epi16(
+                _mm256_cvtepi8_epi16(_mm_xor_si128(centre,bytes)),8);
+}
+
+__attribute__((target("avx2")))
+static void stereo8Avx2(const uchar* samples, short* left, short* right,
+                        uint frames)
+{
+    uint n = 0;
+    for (; n + 16 <= frames; n += 16)
+    {
+        __m256i a = widen8Avx2(
+                    _mm_loadu_si128((const __m128i*) (samples+2*n)));
+        __m256i b = widen8Avx2(
+                    _mm_loadu_si128((const __m128i*) (samples+2*n+16)));
+        splitPairsAvx2(a,b,left+n,right+n);
+    }
+    stereo8Sse2(samples+2*n,left+n,right+n,frames-n);
+}
+
+__attribute__((target("avx2")))
+static void mono8Avx2(const uchar* samples, short* left, uint frames)
+{
+    uint n = 0;
+    for (; n + 16 <= frames; n += 16)
+        _mm256_storeu_si256((__m256i*) (left+n),widen8Avx2(
+                    _mm_loadu_si128((const __m128i*) (samples+n))));
+    mono8Sse2(samples+n,left+n,frames-n);
+}
+
+static const PcmKernels avx2Kernels =
+    {PCM_AVX2,stereo16Avx2,mono16Copy,stereo8Avx2,mono8Avx2,
+     stereo24Scalar,mono24Scalar};
+/*@}*/
+#endif
+
+#ifdef PCM_HAS_NEON
+//-----------------------------------------------------------------------------
+/** @defgroup neon NEON kernels
+
+The NEON structure loads split interleaved channels directly. 8 bit samples
+are recentred by flipping the top bit and widened with a shift into the upper
+byte.
+*/
+/*@{*/
+
+static void stereo16Neon(const uchar* samples, short* left, short* right,
+                         uint frames)
+{
+    uint n = 0;
+    for (; n + 8 <= frames; n += 8)
+    {
+        int16x8x2_t pairs = vld2q_s16((const int16_t*) (samples+4*n));
+        vst1q_s16(left+n,pairs.val[0]);
+        vst1q_s16(right+n,pairs.val[1]);
+    }
+    stereo16Scalar(samples+4*n,left+n,right+n,frames-n);
+}
+
+static void mono16Neon(const uchar* samples, short* left, uint frames)
+{
+    memcpy(left,samples,2*frames);          // Already in host order
+}
+
+static inline int16x8_t widen8Neon(uint8x8_t bytes)
+{
+    return vshll_n_s8(vreinterpret_s8_u8(veor_u8(bytes,vdup_n_u8(0x80))),8);
+}
+
+static void stereo8Neon(const uchar* samples, short* left, short* right,
+                        uint frames)
+{
+    uint n = 0;
+    for (; n + 8 <= frames; n += 8)
+    {
+        uint8x8x2_t pairs = vld2_u8(samples+2*n);
+        vst1q_s16(left+n,widen8Neon(pairs.val[0]));
+        vst1q_s16(right+n,widen8Neon(pairs.val[1]));
+    }
+    stereo8Scalar(samples+2*n,left+n,right+n,frames-n);
+}
+
+static void mono8Neon(const uchar* samples, short* left, uint frames)
+{
+    uint n = 0;
+    for (; n + 8 <= frames; n += 8)
+        vst1q_s16(left+n,widen8Neon(vld1_u8(samples+n)));
+    mono8Scalar(samples+n,left+n,frames-n);
+}
+
+static const PcmKernels neonKernels =
+    {PCM_NEON,stereo16Neon,mono16Neon,stereo8Neon,mono8Neon,
+     stereo24Scalar,mono24Scalar};
+/*@}*/
+#endif
+
+//-----------------------------------------------------------------------------
+/** @brief Kernels for a kernel set
+
+@param[in] kernelSet Kernel set wanted.
+@returns the kernels, or NULL if the set is not built or not supported by the
+processor.
+*/
+
+static const PcmKernels* kernelsFor(PcmKernelSet kernelSet)
+{
+    switch (kernelSet)
+    {
+    case PCM_SCALAR:
+        return &scalarKernels;
+#ifdef PCM_HAS_X86
+    case PCM_SSE2:
+        if (__builtin_cpu_supports("sse2")) return &sse2Kernels;
+        break;
+    case PCM_AVX2:
+        if (__builtin_cpu_supports("avx2")) return &avx2Kernels;
+        break;
+#endif
+#ifdef PCM_HAS_NEON
+    case PCM_NEON:
+        return &neonKernels;
+#endif
+    default:
+        break;
+    }
+    return NULL;
+}
+
+static QAtomicPointer<const PcmKernels> selectedKernels;
+
+//-----------------------------------------------------------------------------
+/** @brief Kernels in use, selecting the best the first time
+*/
+
+static const PcmKernels* currentKernels()
+{
+    const PcmKernels* kernels = selectedKernels.loadAcquire();
+    if (kernels == NULL)
+    {
+        kernels = kernelsFor(bestPcmKernels());
+        selectedKernels.testAndSetOrdered(NULL,kernels);
+        kernels = selectedKernels.loadAcquire();
+    }
+    return kernels;
+}
+//-----------------------------------------------------------------------------
+/** @brief Convert a block of WAV samples into a buffer for each channel
+
+@param[in] samples Block of interleaved little-endian samples.
+@param[out] left Left channel, or the only channel of a mono file.
+@param[out] right Right channel, not used for a mono file.
+@param[in] numberChannels Number of channels (1,2).
+@param[in] bitsPerSample bits per sample (8,16,24).
+@param[in] frames Number of sample frames in the block.
+*/
+
+void convertPcm(const uchar* samples, short* left, short* right,
+                uint numberChannels, uint bitsPerSample, uint frames)
+{
+    const PcmKernels* kernels = currentKernels();
+    if (bitsPerSample == 8)
+    {
+        if (numberChannels == 2) kernels->stereo8(samples,left,right,frames);
+        else kernels->mono8(samples,left,frames);
+    }
+    else if (bitsPerSample == 24)
+    {
+        if (numberChannels == 2) kernels->stereo24(samples,left,right,frames);
+        else kernels->mono24(samples,left,frames);
+    }
+    else
+    {
+        if (numberChannels == 2) kernels->stereo16(samples,left,right,frames);
+        else kernels->mono16(samples,left,frames);
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief The fastest kernel set supported by this processor
+*/
+
+PcmKernelSet bestPcmKernels()
+{
+    if (kernelsFor(PCM_AVX2) != NULL) return PCM_AVX2;
+    if (kernelsFor(PCM_NEON) != NULL) return PCM_NEON;
+    if (kernelsFor(PCM_SSE2) != NULL) return PCM_SSE2;
+    return PCM_SCALAR;
+}
+//-----------------------------------------------------------------------------
+/** @brief Force the use of a kernel set
+
+This is meant for comparing the kernel sets, and should not be called while
+conversions are running.
+@param[in] kernelSet Kernel set to use from now on.
+@returns false if the set is not supported, in which case nothing is changed.
+*/
+
+bool selectPcmKernels(PcmKernelSet kernelSet)
+{
+    const PcmKernels* kernels = kernelsFor(kernelSet);
+    if (kernels == NULL) return false;
+    selectedKernels.storeRelease(kernels);
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief The kernel set in use
+*/
+
+PcmKernelSet selectedPcmKernels()
+{
+    return currentKernels()->kernelSet;
+}
+//-----------------------------------------------------------------------------
+/** @brief Name of a kernel set for display
+*/
+
+const char* pcmKernelName(PcmKernelSet kernelSet)
+{
+    switch (kernelSet)
+    {
+    case PCM_SSE2: return "sse2";
+    case PCM_AVX2: return "avx2";
+    case PCM_NEON: return "neon";
+    default: return "scalar";
+    }
+}
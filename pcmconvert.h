@@ -0,0 +1,61 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef PCMCONVERT_H
+#define PCMCONVERT_H
+
+#include <QtGlobal>
+
+//-----------------------------------------------------------------------------
+/** @brief PCM sample conversion
+
+WAV samples are stored little-endian with the channels interleaved, and 8 bit
+samples are unsigned. LAME wants a separate buffer of signed 16 bit samples for
+each channel. These functions do that conversion for a block of samples.
+
+Several sets of kernels are provided: a portable scalar set, SSE2 and AVX2 sets
+for x86 and a NEON set for ARM. The best set that the processor supports is
+selected the first time a conversion is made. Each set gives bit-identical
+results to the scalar set, which is the reference; the parity suite of
+klamebench checks this.
+*/
+
+enum PcmKernelSet
+{
+    PCM_SCALAR,                       //!< Portable C++, any byte order.
+    PCM_SSE2,                         //!< x86 SSE2.
+    PCM_AVX2,                         //!< x86 AVX2.
+    PCM_NEON                          //!< ARM Advanced SIMD.
+};
+
+void convertPcm(const uchar* samples, short* left, short* right,
+                uint numberChannels, uint bitsPerSample, uint frames);
+PcmKernelSet bestPcmKernels();
+bool selectPcmKernels(PcmKernelSet kernelSet);
+PcmKernelSet selectedPcmKernels();
+const char* pcmKernelName(PcmKernelSet kernelSet);
+
+#endif
@@ -0,0 +1,178 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#include "progress.h"
+#include <math.h>
+
+// Time over which the throughput is smoothed (s)
+const double RATE_SMOOTHING_TIME = 5.0;
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+The counters start at zero.
+*/
+
+ProgressCounters::ProgressCounters() : framesDone_(0),framesTotal_(0),
+                                       bytesDone_(0),bytesTotal_(0)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Set the work to be done by the job
+
+@param[in] frames Sample frames to be encoded, for all outputs.
+@param[in] bytes Bytes of WAV data to be encoded, for all outputs.
+*/
+
+void ProgressCounters::setTotal(quint64 frames, quint64 bytes)
+{
+    framesTotal_.store(frames);
+    bytesTotal_.store(bytes);
+}
+//-----------------------------------------------------------------------------
+/** @brief Count the job as done
+
+Outputs that were placed from the cache or dropped on an error were never
+counted off, so the counters are brought up to the totals when the job ends.
+*/
+
+void ProgressCounters::complete()
+{
+    framesDone_.store(framesTotal_.load());
+    bytesDone_.store(bytesTotal_.load());
+}
+//-----------------------------------------------------------------------------
+/** @brief Frames encoded so far
+*/
+
+quint64 ProgressCounters::framesDone() const
+{
+    return framesDone_.load();
+}
+//-----------------------------------------------------------------------------
+/** @brief Frames to be encoded
+*/
+
+quint64 ProgressCounters::framesTotal() const
+{
+    return framesTotal_.load();
+}
+//-----------------------------------------------------------------------------
+/** @brief Bytes of WAV data encoded so far
+*/
+
+quint64 ProgressCounters::bytesDone() const
+{
+    return bytesDone_.load();
+}
+//-----------------------------------------------------------------------------
+/** @brief Bytes of WAV data to be encoded
+*/
+
+quint64 ProgressCounters::bytesTotal() const
+{
+    return bytesTotal_.load();
+}
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+*/
+
+ProgressMeter::ProgressMeter() : lastTime_(0),lastBytes_(0),
+                                 remainingBytes_(0),rate_(0)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Start measuring a new batch
+*/
+
+void ProgressMeter::start()
+{
+    timer_.start();
+    lastTime_ = 0;
+    lastBytes_ = 0;
+    remainingBytes_ = 0;
+    rate_ = 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Take a sample of the progress of the batch
+
+The rate over the time since the last sample is blended into the smoothed rate
+with a weight that grows with that time, so that samples that come late are not
+given too little weight.
+@param[in] progress Progress of the batch.
+*/
+
+void ProgressMeter::sample(const ConversionProgress& progress)
+{
+    qint64 now = timer_.elapsed();
+    double interval = (now - lastTime_)/1000.0;
+    if (interval <= 0) return;
+    double sampleRate = 0;
+    if (progress.bytesDone > lastBytes_)
+        sampleRate = (progress.bytesDone - lastBytes_)/interval;
+    double weight = 1.0 - exp(-interval/RATE_SMOOTHING_TIME);
+// The first samples take the rate as it is, rather than blend it with zero
+    if (lastBytes_ == 0) rate_ = sampleRate;
+    else rate_ += weight*(sampleRate - rate_);
+    lastTime_ = now;
+    lastBytes_ = progress.bytesDone;
+    remainingBytes_ = (progress.bytesTotal > progress.bytesDone) ?
+                       progress.bytesTotal - progress.bytesDone : 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Smoothed throughput in bytes of WAV data per second
+*/
+
+double ProgressMeter::rate() const
+{
+    return rate_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Estimate of the time to finish the batch
+
+@returns seconds remaining, or -1 if nothing has been done yet.
+*/
+
+double ProgressMeter::remainingSeconds() const
+{
+    if (rate_ <= 0) return -1;
+    return remainingBytes_/rate_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Throughput and time remaining as text for display
+*/
+
+QString ProgressMeter::text() const
+{
+    double remaining = remainingSeconds();
+    if (remaining < 0) return "Starting";
+    qint64 seconds = (qint64)(remaining + 0.5);
+    return QString("%1 MB/s, %2:%3 remaining")
+            .arg(rate_/1e6,0,'f',1)
+            .arg(seconds/60)
+            .arg(seconds%60,2,10,QChar('0'));
+}
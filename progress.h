@@ -0,0 +1,111 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef PROGRESS_H
+#define PROGRESS_H
+
+#include <QAtomicInteger>
+#include <QElapsedTimer>
+#include <QString>
+
+// Time between samples of the progress of a batch (ms), about 15 times a second
+const int PROGRESS_SAMPLE_INTERVAL = 66;
+// Size of a processor cache line
+const int CACHE_LINE_SIZE = 64;
+
+//-----------------------------------------------------------------------------
+/** @brief Progress counters of one conversion job
+
+The counters are written only by the worker running the job, with no lock and
+no signal, and are read by the GUI or the batch runner whenever it samples the
+progress of the batch. They are padded out to whole cache lines, so that the
+counters of jobs running on different workers never share a line.
+
+The work is counted in sample frames and in bytes of WAV data, each for every
+output encoded from them, so that a file converted for three columns counts
+three times.
+*/
+
+class ProgressCounters
+{
+public:
+    ProgressCounters();
+    void setTotal(quint64 frames, quint64 bytes);
+    void add(quint64 frames, quint64 bytes)
+    {
+        framesDone_.fetchAndAddRelaxed(frames);
+        bytesDone_.fetchAndAddRelaxed(bytes);
+    }
+    void complete();
+    quint64 framesDone() const;
+    quint64 framesTotal() const;
+    quint64 bytesDone() const;
+    quint64 bytesTotal() const;
+private:
+    char leadingPad_[CACHE_LINE_SIZE];  //!< Keeps other data off the line.
+    QAtomicInteger<quint64> framesDone_; //!< Frames encoded.
+    QAtomicInteger<quint64> framesTotal_; //!< Frames to be encoded.
+    QAtomicInteger<quint64> bytesDone_; //!< Bytes of WAV data encoded.
+    QAtomicInteger<quint64> bytesTotal_; //!< Bytes of WAV data to be encoded.
+    char trailingPad_[CACHE_LINE_SIZE]; //!< Keeps other data off the line.
+};
+
+//! Progress of a batch, summed over its jobs
+struct ConversionProgress
+{
+    quint64 framesDone;               //!< Frames encoded.
+    quint64 framesTotal;              //!< Frames to be encoded.
+    quint64 bytesDone;                //!< Bytes of WAV data encoded.
+    quint64 bytesTotal;               //!< Bytes of WAV data to be encoded.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Throughput and time remaining of a batch
+
+The progress of the batch is given to the meter each time it is sampled. The
+throughput is smoothed over the last few seconds, so that it follows changes in
+the speed of the batch without jumping about from sample to sample.
+*/
+
+class ProgressMeter
+{
+public:
+    ProgressMeter();
+    void start();
+    void sample(const ConversionProgress& progress);
+    double rate() const;
+    double remainingSeconds() const;
+    QString text() const;
+private:
+    QElapsedTimer timer_;               //!< Time since the batch started.
+    qint64 lastTime_;                   //!< Time of the last sample (ms).
+    quint64 lastBytes_;                 //!< Bytes done at the last sample.
+    quint64 remainingBytes_;            //!< Bytes still to be done.
+    double rate_;                       //!< Smoothed bytes per second.
+};
+
+#endif
@@ -0,0 +1,125 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "project.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+
+//-----------------------------------------------------------------------------
+/** @brief Load a project file
+
+The project file uses a binary format according to QDataStream.
+- header: A string giving version and author information (not used).
+- numberColumns: number of columns in the conversion matrix.
+- wavDirectory: Location of the WAV files to convert.
+- commentList: List of comments for each column.
+- filenameTagList: List of filename tags for each column
+- outputDirectoryList: List of output directories for each column.
+- lameOptionsList: List of LAME options for each column.
+- headerLabels: List of labels for each column.
+@param[in] fileName project file to be read.
+@param[out] project settings read from the file.
+@returns "OK" or an error message.
+*/
+
+QString loadProject(const QString& fileName, Project& project)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::ReadOnly))
+        return "Could not open the project file.";
+    QDataStream stream(&file);
+    stream >> project.header;
+    stream >> project.numberColumns;
+    stream >> project.wavDirectory;
+    stream >> project.commentList;
+    stream >> project.filenameTagList;
+    stream >> project.outputDirectoryList;
+    stream >> project.lameOptionsList;
+    stream >> project.headerLabels;
+    if (stream.status() != QDataStream::Ok)
+        return "The project file is not complete.";
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Save a project file
+
+@param[in] fileName project file to be written.
+@param[in] project settings to be saved, in the form read by loadProject().
+@returns "OK" or an error message.
+*/
+
+QString saveProject(const QString& fileName, const Project& project)
+{
+    QFile file(fileName);
+    if (! file.open(QIODevice::WriteOnly))
+        return "Could not create the project file.";
+    QDataStream stream(&file);
+    stream << project.header;
+    stream << project.numberColumns;
+    stream << project.wavDirectory;
+    stream << project.commentList;
+    stream << project.filenameTagList;
+    stream << project.outputDirectoryList;
+    stream << project.lameOptionsList;
+    stream << project.headerLabels;
+    file.close();
+    if (file.error() != QFile::NoError)
+        return "Could not write the project file.";
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of conversion columns of a project
+
+The lists of column settings are not shortened when a column is deleted from
+the table, so only as many are used as there are conversion columns in the
+table, and never more than there are settings for.
+*/
+
+int conversionColumns(const Project& project)
+{
+    int columns = project.numberColumns-2;
+    columns = qMin(columns,project.lameOptionsList.size());
+    columns = qMin(columns,project.filenameTagList.size());
+    columns = qMin(columns,project.outputDirectoryList.size());
+    return qMax(columns,0);
+}
+//-----------------------------------------------------------------------------
+/** @brief Name of an mp3 output file
+
+The name is built from the name of the input file, without its path or
+extension, with the filename tag of the column appended.
+@param[in] inputFile WAV file, with or without its path.
+@param[in] filenameTag tag of the column.
+@returns file name of the output, without a path.
+*/
+
+QString mp3FileName(const QString& inputFile, const QString& filenameTag)
+{
+    return QFileInfo(inputFile).fileName().section(".",0,0,
+                                                   QString::SectionSkipEmpty)
+            + filenameTag + ".mp3";
+}
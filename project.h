@@ -0,0 +1,67 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef PROJECT_H
+#define PROJECT_H
+
+#include <QString>
+#include <QStringList>
+
+//-----------------------------------------------------------------------------
+/** @brief kLAME project settings
+
+A project holds the settings of the columns of the conversion matrix: for each
+column the LAME options, the filename tag, the output directory, a comment and
+the column heading. The lists are kept in the order and form in which they are
+stored in the project file, which both the main form and the batch mode use.
+
+The number of columns counts two filename columns ahead of the conversion
+columns, as the main form table once had, so that older project files are still
+read.
+*/
+
+struct Project
+{
+    QString header;                   //!< Version and author (not used).
+    int numberColumns;                //!< Columns of the table.
+    QString wavDirectory;             //!< Location of the WAV files.
+    QStringList commentList;          //!< Comments (each column).
+    QStringList filenameTagList;      //!< File name tags (each column).
+    QStringList outputDirectoryList;  //!< Output directories (each column).
+    QStringList lameOptionsList;      //!< Options for LAME (each column).
+    QStringList headerLabels;         //!< Headings from the filename column.
+};
+
+//-----------------------------------------------------------------------------
+// Project functions
+//-----------------------------------------------------------------------------
+QString loadProject(const QString& fileName, Project& project);
+QString saveProject(const QString& fileName, const Project& project);
+int conversionColumns(const Project& project);
+QString mp3FileName(const QString& inputFile, const QString& filenameTag);
+//-----------------------------------------------------------------------------
+
+#endif
@@ -0,0 +1,21 @@
+PROJECT =       pcmparity
+TEMPLATE        = app
+TARGET          = pcmparity
+DEPENDPATH     += . ../.. ../../bench
+INCLUDEPATH    += . ../.. ../../bench
+LANGUAGE	    = C++
+OBJECTS_DIR     = obj
+MOC_DIR         = moc
+CONFIG	       += qt thread warn_on release console c++14 testcase
+CONFIG         -= app_bundle
+QT             += testlib
+QT             -= gui
+
+# Input
+HEADERS        += ../../pcmconvert.h \
+                  ../../bench/benchreport.h \
+                  ../../bench/paritybench.h
+SOURCES        += tst_pcmparity.cpp \
+                  ../../pcmconvert.cpp \
+                  ../../bench/benchreport.cpp \
+                  ../../bench/paritybench.cpp
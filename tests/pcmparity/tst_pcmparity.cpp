@@ -0,0 +1,119 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - kernel parity test
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+/** @brief Kernel parity test
+
+Runs the parity check of the bench for every SIMD kernel set and sample format,
+one test row each, so that "make check" fails on any kernel whose output
+differs from the scalar kernels. Kernel sets that are not built or not
+supported by the processor are skipped.
+*/
+
+#include <QtTest>
+#include "paritybench.h"
+
+class PcmParityTest : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void parity_data();
+    void parity();
+
+private:
+    PcmKernelSet selected_;          //!< Kernel set selected before the test
+};
+
+//-----------------------------------------------------------------------------
+/** @brief Note the kernel set selected at startup so that it can be restored
+*/
+
+void PcmParityTest::initTestCase()
+{
+    selected_ = selectedPcmKernels();
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Select the kernel set that was selected at startup
+*/
+
+void PcmParityTest::cleanupTestCase()
+{
+    selectPcmKernels(selected_);
+}
+
+//-----------------------------------------------------------------------------
+/** @brief One row for each kernel set, sample size and number of channels
+*/
+
+void PcmParityTest::parity_data()
+{
+    static const PcmKernelSet kernelSets[] = {PCM_SSE2,PCM_AVX2,PCM_NEON};
+    static const uint bits[] = {8,16,24};
+    QTest::addColumn<int>("kernelSet");
+    QTest::addColumn<uint>("bitsPerSample");
+    QTest::addColumn<uint>("numberChannels");
+    for (uint set = 0; set < sizeof(kernelSets)/sizeof(kernelSets[0]); set++)
+    {
+        for (uint size = 0; size < sizeof(bits)/sizeof(bits[0]); size++)
+        {
+            for (uint channels = 1; channels <= 2; channels++)
+            {
+                QString name = QString("%1 %2 bit %3 channel")
+                                   .arg(pcmKernelName(kernelSets[set]))
+                                   .arg(bits[size]).arg(channels);
+                QTest::newRow(qPrintable(name))
+                    << (int)kernelSets[set] << bits[size] << channels;
+            }
+        }
+    }
+}
+
+//-----------------------------------------------------------------------------
+/** @brief Compare a kernel set with the scalar kernels for one sample format
+*/
+
+void PcmParityTest::parity()
+{
+    QFETCH(int,kernelSet);
+    QFETCH(uint,bitsPerSample);
+    QFETCH(uint,numberChannels);
+    PcmKernelSet set = (PcmKernelSet)kernelSet;
+    if (! selectPcmKernels(set))
+        QSKIP("kernel set not built or not supported by the processor");
+    int cases = 0;
+    int mismatches = comparePcmKernels(set,numberChannels,bitsPerSample,cases);
+    QVERIFY(cases > 0);
+    QVERIFY2(mismatches == 0,
+             qPrintable(QString("%1 of %2 cases differ from the scalar kernels")
+                            .arg(mismatches).arg(cases)));
+}
+
+QTEST_APPLESS_MAIN(PcmParityTest)
+
+#include "tst_pcmparity.moc"
@@ -0,0 +1,186 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#include "trace.h"
+#include <QThread>
+#include <QSaveFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+#include <QMutexLocker>
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+
+@param[in] fileName File the trace is to be saved to.
+*/
+
+ConversionTrace::ConversionTrace(const QString& fileName)
+            : fileName_(fileName),numberWorkers_(0)
+{
+    clock_.start();
+}
+//-----------------------------------------------------------------------------
+/** @brief File the trace is saved to
+*/
+
+QString ConversionTrace::fileName() const
+{
+    return fileName_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Start the trace of a new batch
+
+The spans of any earlier batch are dropped and the clock is started again.
+Names given to threads are kept.
+*/
+
+void ConversionTrace::start()
+{
+    QMutexLocker locker(&mutex_);
+    events_.clear();
+    clock_.restart();
+}
+//-----------------------------------------------------------------------------
+/** @brief Time since the batch started in microseconds
+*/
+
+qint64 ConversionTrace::now() const
+{
+    return clock_.nsecsElapsed()/1000;
+}
+//-----------------------------------------------------------------------------
+/** @brief Name the track of a thread
+
+Threads that are not named, such as the workers of a pool, are numbered in the
+order they first record a span.
+@param[in] thread Thread to be named.
+@param[in] name Name shown for its track.
+*/
+
+void ConversionTrace::nameThread(QThread* thread, const QString& name)
+{
+    QMutexLocker locker(&mutex_);
+    int id = threads_.value(thread);
+    if (id == 0)
+    {
+        id = threads_.size() + 1;
+        threads_.insert(thread,id);
+    }
+    threadNames_.insert(id,name);
+}
+//-----------------------------------------------------------------------------
+/** @brief Record a span of work by the current thread
+
+@param[in] name Name of the span, a string that lives as long as the program.
+@param[in] detail File or segment worked on, or empty.
+@param[in] start Start time (us).
+@param[in] end End time (us).
+*/
+
+void ConversionTrace::addSpan(const char* name, const QString& detail,
+                              qint64 start, qint64 end)
+{
+    TraceEvent event;
+    event.name = name;
+    event.detail = detail;
+    event.start = start;
+    event.duration = end - start;
+    QMutexLocker locker(&mutex_);
+    event.thread = threadId(QThread::currentThread());
+    events_.append(event);
+}
+//-----------------------------------------------------------------------------
+/** @brief Save the trace as Chrome trace event JSON
+
+Spans are written as complete events and the track names as metadata events.
+@returns "OK" or an error message.
+*/
+
+QString ConversionTrace::save()
+{
+    QMutexLocker locker(&mutex_);
+    QJsonArray traceEvents;
+    QHash<int,QString>::const_iterator threadName;
+    for (threadName = threadNames_.constBegin();
+         threadName != threadNames_.constEnd(); ++threadName)
+    {
+        QJsonObject args;
+        args.insert("name",threadName.value());
+        QJsonObject event;
+        event.insert("name",QString("thread_name"));
+        event.insert("ph",QString("M"));
+        event.insert("pid",1);
+        event.insert("tid",threadName.key());
+        event.insert("args",args);
+        traceEvents.append(event);
+    }
+    for (int n = 0; n < events_.size(); n++)
+    {
+        QJsonObject event;
+        event.insert("name",QString(events_[n].name));
+        event.insert("cat",QString("klame"));
+        event.insert("ph",QString("X"));
+        event.insert("ts",(double)events_[n].start);
+        event.insert("dur",(double)events_[n].duration);
+        event.insert("pid",1);
+        event.insert("tid",events_[n].thread);
+        if (! events_[n].detail.isEmpty())
+        {
+            QJsonObject args;
+            args.insert("file",events_[n].detail);
+            event.insert("args",args);
+        }
+        traceEvents.append(event);
+    }
+    QJsonObject trace;
+    trace.insert("traceEvents",traceEvents);
+    trace.insert("displayTimeUnit",QString("ms"));
+    QSaveFile file(fileName_);
+    if (! file.open(QIODevice::WriteOnly))
+        return "Could not write the trace file " + fileName_;
+    file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact));
+    if (! file.commit()) return "Could not write the trace file " + fileName_;
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Track of a thread, given when the thread is first met
+
+A thread met here has not been named, and is taken to be a worker. The mutex
+must be held.
+*/
+
+int ConversionTrace::threadId(QThread* thread)
+{
+    QHash<QThread*,int>::const_iterator found = threads_.constFind(thread);
+    if (found != threads_.constEnd()) return found.value();
+    int id = threads_.size() + 1;
+    threads_.insert(thread,id);
+    numberWorkers_++;
+    threadNames_.insert(id,QString("worker %1").arg(numberWorkers_));
+    return id;
+}
@@ -0,0 +1,120 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+class QThread;
+
+//-----------------------------------------------------------------------------
+/** @brief Timeline of a conversion batch
+
+Spans of work are recorded from any thread with the thread that did them, and
+the timeline is saved as Chrome trace event JSON, to be viewed with
+chrome://tracing or Perfetto. Each thread is shown as a track, so that idle
+workers, waits on the disk and a long file finishing last can be seen.
+
+Tracing is off unless a trace is given to the engine. The code being traced
+holds a pointer to the trace that is null when tracing is off, and a TraceSpan
+then costs one test of that pointer at each end.
+*/
+
+class ConversionTrace
+{
+public:
+    ConversionTrace(const QString& fileName);
+    QString fileName() const;
+    void start();
+    qint64 now() const;
+    void nameThread(QThread* thread, const QString& name);
+    void addSpan(const char* name, const QString& detail, qint64 start,
+                 qint64 end);
+    QString save();
+private:
+//! A span of work done by one thread
+    struct TraceEvent
+    {
+        const char* name;
+        QString detail;
+        qint64 start;
+        qint64 duration;
+        int thread;
+    };
+    int threadId(QThread* thread);
+    QString fileName_;                  //!< File the trace is saved to.
+    QElapsedTimer clock_;               //!< Time since the batch started.
+    QMutex mutex_;                      //!< Guards the events and threads.
+    QVector<TraceEvent> events_;        //!< Spans recorded so far.
+    QHash<QThread*,int> threads_;       //!< Track of each thread.
+    QHash<int,QString> threadNames_;    //!< Names of the tracks.
+    int numberWorkers_;                 //!< Worker threads met so far.
+};
+
+//-----------------------------------------------------------------------------
+/** @brief A span of work recorded from construction to destruction
+
+The span can be ended early with end(). Nothing is done if the trace is null.
+*/
+
+class TraceSpan
+{
+public:
+    TraceSpan(ConversionTrace* trace, const char* name,
+              const QString& detail = QString())
+            : trace_(trace)
+    {
+        if (Q_UNLIKELY(trace_ != NULL))
+        {
+            name_ = name;
+            detail_ = detail;
+            start_ = trace_->now();
+        }
+    }
+    ~TraceSpan()
+    {
+        if (Q_UNLIKELY(trace_ != NULL)) end();
+    }
+    void end()
+    {
+        if (trace_ == NULL) return;
+        trace_->addSpan(name_,detail_,start_,trace_->now());
+        trace_ = NULL;
+    }
+private:
+    ConversionTrace* trace_;            //!< Trace, or null if not traced.
+    const char* name_;                  //!< Name of the span.
+    QString detail_;                    //!< File or segment worked on.
+    qint64 start_;                      //!< Start time (us).
+};
+
+#endif
@@ -0,0 +1,372 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#include "wavreader.h"
+#include <QStorageInfo>
+#include <QtEndian>
+#include <string.h>
+#ifdef Q_OS_UNIX
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static bool isNetworkFileSystem(const QString& fileName);
+
+//-----------------------------------------------------------------------------
+/** @brief Constructor.
+*/
+
+WavReader::WavReader() : numberChannels_(0),bitsPerSample_(0),sampleRate_(0),
+                         numberFrames_(0),dataOffset_(0),position_(0),
+                         map_(NULL),bufferStart_(0),bufferEnd_(0)
+{
+}
+//-----------------------------------------------------------------------------
+/** @brief Destructor.
+
+The mapping is released and the file closed.
+*/
+
+WavReader::~WavReader()
+{
+    close();
+}
+//-----------------------------------------------------------------------------
+/** @brief Open a WAV file and check its header
+
+The header is checked and the file is positioned at the first sample frame.
+The samples are then mapped into memory unless the file is a pipe or is on a
+network file system, or the mapping fails, in which case they are read through
+the buffer.
+@param[in] fileName WAV file to be read.
+@returns error message, or "OK".
+*/
+
+QString WavReader::open(const QString& fileName)
+{
+    close();
+    file_.setFileName(fileName);
+    if (! file_.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return "Could not open an input file.";
+    if (! readHeader())
+    {
+        close();
+        return "Invalid or unsupported WAV file.";
+    }
+    qint64 dataSize = (qint64)numberFrames_*bytesPerFrame();
+    if (file_.isSequential() || isNetworkFileSystem(fileName) ||
+        (dataSize == 0)) return "OK";
+    map_ = file_.map(dataOffset_,dataSize);
+#ifdef Q_OS_UNIX
+/* Tell the kernel that the samples are read in order so that it reads well
+ahead of the encoder. The advice must start on a page boundary. */
+    if (map_ != NULL)
+    {
+        quintptr pageSize = sysconf(_SC_PAGESIZE);
+        quintptr start = (quintptr)map_ & ~(pageSize-1);
+        madvise((void*)start,dataSize+((quintptr)map_-start),MADV_SEQUENTIAL);
+    }
+#endif
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Check the header of a WAV file without opening it for reading
+
+Only the header is read, and the file is closed again, so that the format of
+many files can be found cheaply. The format is then given as for open().
+@param[in] fileName WAV file to be checked.
+@returns error message, or "OK".
+*/
+
+QString WavReader::probe(const QString& fileName)
+{
+    close();
+    file_.setFileName(fileName);
+    if (! file_.open(QIODevice::ReadOnly))
+        return "Could not open an input file.";
+    bool isValid = readHeader();
+    ulong numberFrames = numberFrames_;
+    close();
+    if (! isValid) return "Invalid or unsupported WAV file.";
+    numberFrames_ = numberFrames;
+    return "OK";
+}
+//-----------------------------------------------------------------------------
+/** @brief Release the mapping and close the file
+*/
+
+void WavReader::close()
+{
+    if (map_ != NULL) file_.unmap(map_);
+    map_ = NULL;
+    if (file_.isOpen()) file_.close();
+    buffer_.clear();
+    bufferStart_ = 0;
+    bufferEnd_ = 0;
+    position_ = 0;
+    numberFrames_ = 0;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of channels (1,2)
+*/
+
+uint WavReader::numberChannels() const
+{
+    return numberChannels_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Bits per sample (8,16,24)
+*/
+
+uint WavReader::bitsPerSample() const
+{
+    return bitsPerSample_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Samples per second in each channel
+*/
+
+uint WavReader::sampleRate() const
+{
+    return sampleRate_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Bytes in one sample frame of all channels
+*/
+
+uint WavReader::bytesPerFrame() const
+{
+    return numberChannels_*bitsPerSample_/8;
+}
+//-----------------------------------------------------------------------------
+/** @brief Number of sample frames in the file
+*/
+
+ulong WavReader::numberFrames() const
+{
+    return numberFrames_;
+}
+//-----------------------------------------------------------------------------
+/** @brief Indicate if the samples are mapped into memory
+*/
+
+bool WavReader::isMapped() const
+{
+    return map_ != NULL;
+}
+//-----------------------------------------------------------------------------
+/** @brief Move to a sample frame
+
+A pipe can only be moved forwards, by reading and discarding the samples.
+@param[in] frame Sample frame to be read next.
+@returns false if the frame is beyond the end of the file or cannot be reached.
+*/
+
+bool WavReader::seekFrame(ulong frame)
+{
+    if (frame > numberFrames_) return false;
+    if (map_ == NULL)
+    {
+        if (file_.isSequential())
+        {
+            if (frame < position_) return false;
+            ulong bufferFrames = READ_BUFFER_SIZE/bytesPerFrame();
+            while (position_ < frame)
+            {
+                ulong frames = frame - position_;
+                if (frames > bufferFrames) frames = bufferFrames;
+                if (readFrames(frames) == NULL) return false;
+            }
+            return true;
+        }
+        if (! file_.seek(dataOffset_ + (qint64)frame*bytesPerFrame()))
+            return false;
+        bufferStart_ = 0;
+        bufferEnd_ = 0;
+    }
+    position_ = frame;
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Access the next block of sample frames
+
+The frames are raw little-endian PCM as they are stored in the file, with the
+channels interleaved. When the file is mapped nothing is copied at all.
+@param[in] frames Number of sample frames wanted.
+@returns pointer to the frames, or NULL if the file ends before all of them.
+*/
+
+const uchar* WavReader::readFrames(ulong frames)
+{
+    if (frames > numberFrames_ - position_) return NULL;
+    qint64 bytes = (qint64)frames*bytesPerFrame();
+    const uchar* samples;
+    if (map_ != NULL) samples = map_ + (qint64)position_*bytesPerFrame();
+    else
+    {
+        if ((bufferEnd_ - bufferStart_ < bytes) && (! fillBuffer(bytes)))
+            return NULL;
+        samples = (const uchar*) buffer_.constData() + bufferStart_;
+        bufferStart_ += bytes;
+    }
+    position_ += frames;
+    return samples;
+}
+//-----------------------------------------------------------------------------
+/** @brief Read and check the header of the WAV file
+
+The RIFF chunks are walked until the data chunk is found, skipping any chunks
+that are not needed such as LIST or fact. Only uncompressed PCM is accepted,
+including the extensible format where its subformat is PCM. See for example
+http://www.sonicspot.com/guide/wavefiles.html.
+
+If the data chunk claims to be longer than the file, as happens when the file
+was written by a recorder that did not finish, only the samples present are
+used.
+@returns true if the header is valid and the file is at the first sample.
+*/
+
+bool WavReader::readHeader()
+{
+    uchar header[12];
+    if (file_.read((char*) header,12) != 12) return false;
+    if ((memcmp(header,"RIFF",4) != 0) || (memcmp(header+8,"WAVE",4) != 0))
+        return false;
+    bool isFormatFound = false;
+    forever
+    {
+        uchar chunk[8];
+        if (file_.read((char*) chunk,8) != 8) return false;
+        qint64 chunkSize = qFromLittleEndian<quint32>(chunk+4);
+        if (memcmp(chunk,"fmt ",4) == 0)
+        {
+            uchar format[40];
+            if (chunkSize < 16) return false;
+            qint64 formatSize = qMin<qint64>(chunkSize,sizeof(format));
+            if (file_.read((char*) format,formatSize) != formatSize)
+                return false;
+            uint compressionCode = qFromLittleEndian<quint16>(format);
+// Extensible format gives the real format code at the start of the subformat
+            if ((compressionCode == 0xFFFE) && (formatSize == 40))
+                compressionCode = qFromLittleEndian<quint16>(format+24);
+            if (compressionCode != 1) return false;
+            numberChannels_ = qFromLittleEndian<quint16>(format+2);
+            sampleRate_ = qFromLittleEndian<quint32>(format+4);
+            bitsPerSample_ = qFromLittleEndian<quint16>(format+14);
+// Only allow these two for now
+            if ((numberChannels_ != 1) && (numberChannels_ != 2)) return false;
+            if ((bitsPerSample_ != 8) && (bitsPerSample_ != 16) &&
+                (bitsPerSample_ != 24)) return false;
+            if (! skipBytes(chunkSize - formatSize + (chunkSize & 1)))
+                return false;
+            isFormatFound = true;
+        }
+        else if (memcmp(chunk,"data",4) == 0)
+        {
+            if (! isFormatFound) return false;
+            dataOffset_ = file_.pos();
+            if (! file_.isSequential() &&
+                (chunkSize > file_.size() - dataOffset_))
+                chunkSize = file_.size() - dataOffset_;
+            numberFrames_ = chunkSize/bytesPerFrame();
+            position_ = 0;
+            return true;
+        }
+// Chunks are padded to an even length
+        else if (! skipBytes(chunkSize + (chunkSize & 1))) return false;
+    }
+}
+//-----------------------------------------------------------------------------
+/** @brief Skip over part of the file
+
+@param[in] bytes Number of bytes to skip.
+@returns false if the file ends first.
+*/
+
+bool WavReader::skipBytes(qint64 bytes)
+{
+    if (bytes == 0) return true;
+    if (! file_.isSequential())
+    {
+        if (file_.pos() + bytes > file_.size()) return false;
+        return file_.seek(file_.pos() + bytes);
+    }
+    char dummy[4096];
+    while (bytes > 0)
+    {
+        qint64 length = (bytes < (qint64)sizeof(dummy)) ? bytes : sizeof(dummy);
+        if (file_.read(dummy,length) != length) return false;
+        bytes -= length;
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Refill the read buffer
+
+Any unread bytes are moved to the front of the buffer and it is topped up with
+reads as large as the buffer allows. A pipe may return less than is asked for,
+so the reads are repeated until enough is held.
+@param[in] bytes Number of unread bytes needed in the buffer.
+@returns false if the file ends first.
+*/
+
+bool WavReader::fillBuffer(qint64 bytes)
+{
+    int unread = bufferEnd_ - bufferStart_;
+    if (buffer_.size() < qMax<qint64>(bytes,READ_BUFFER_SIZE))
+    {
+        QByteArray larger(qMax<qint64>(bytes,READ_BUFFER_SIZE),0);
+        memcpy(larger.data(),buffer_.constData()+bufferStart_,unread);
+        buffer_ = larger;
+    }
+    else memmove(buffer_.data(),buffer_.constData()+bufferStart_,unread);
+    bufferStart_ = 0;
+    bufferEnd_ = unread;
+    while (bufferEnd_ < bytes)
+    {
+        qint64 length = file_.read(buffer_.data()+bufferEnd_,
+                                   buffer_.size()-bufferEnd_);
+        if (length <= 0) return false;
+        bufferEnd_ += length;
+    }
+    return true;
+}
+//-----------------------------------------------------------------------------
+/** @brief Check if a file lies on a network file system
+
+Mapping a file on a network file system gives no benefit and a page fault can
+hang the worker if the server goes away.
+@param[in] fileName File to check.
+@returns true if the file system is known to be a network one.
+*/
+
+static bool isNetworkFileSystem(const QString& fileName)
+{
+    QByteArray type = QStorageInfo(fileName).fileSystemType();
+    return type.startsWith("nfs") || (type == "cifs") ||
+           type.startsWith("smb") || (type == "fuse.sshfs") ||
+           (type == "9p") || (type == "afs");
+}
@@ -0,0 +1,86 @@
+/*
+Title:    kLAME GUI frontend wrapper for LAME - conversion control wav to mp3
+*/
+
+/***************************************************************************
+ *   Copyright (C) 2006 by Ken Sarkies                                     *
+ *   ksarkies@trinity.asn.au                                               *
+ *                                                                         *
+ *   This file is part of kLAME.                                           *
+ *                                                                         *
+ *   kLAME is free software; you can redistribute it and/or modify         *
+ *   it under the terms of the GNU General Public License as published by  *
+ *   the Free Software Foundation; either version 2 of the License, or     *
+ *   (at your option) any later version.                                   *
+ *                                                                         *
+ *   kLAME is distributed in the hope that it will be useful,              *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the         *
+ *   GNU General Public License for more details.                          *
+ *                                                                         *
+ *   You should have received a copy of the GNU General Public License     *
+ *   along with kLAME if not, write to the                                 *
+ *   Free Software Foundation, Inc.,                                       *
+ *   51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA.             *
+ ***************************************************************************/
+
+#ifndef WAVREADER_H
+#define WAVREADER_H
+
+#include <QFile>
+#include <QString>
+#include <QByteArray>
+
+// Size of the reads (bytes) made when the file cannot be mapped
+const int READ_BUFFER_SIZE = 1 << 20;
+
+//-----------------------------------------------------------------------------
+/** @brief WAV file reader
+
+The reader checks the header of a WAV file and gives access to its samples as
+raw little-endian PCM frames. Where possible the file is mapped into memory and
+the pointers handed out point straight into the mapping, so that no data is
+copied and no call is made per sample. The operating system pages the file in
+as it is used.
+
+Pipes and files on network file systems are not mapped, as a mapping of these
+is either impossible or may fault badly if the server goes away. For these the
+samples are read in large blocks into a buffer held by the reader.
+
+A pointer returned by readFrames() is valid until the next call to the reader.
+*/
+
+class WavReader
+{
+public:
+    WavReader();
+    ~WavReader();
+    QString open(const QString& fileName);
+    QString probe(const QString& fileName);
+    void close();
+    uint numberChannels() const;
+    uint bitsPerSample() const;
+    uint sampleRate() const;
+    uint bytesPerFrame() const;
+    ulong numberFrames() const;
+    bool isMapped() const;
+    bool seekFrame(ulong frame);
+    const uchar* readFrames(ulong frames);
+private:
+    bool readHeader();
+    bool skipBytes(qint64 bytes);
+    bool fillBuffer(qint64 bytes);
+    QFile file_;                      //!< WAV input file.
+    uint numberChannels_;             //!< Number of channels (1,2).
+    uint bitsPerSample_;              //!< Bits per sample (8,16,24).
+    uint sampleRate_;                 //!< Samples per second in each channel.
+    ulong numberFrames_;              //!< Sample frames in the data chunk.
+    qint64 dataOffset_;               //!< File position of the first sample.
+    ulong position_;                  //!< Next frame to be read.
+    uchar* map_;                      //!< Mapping of the samples, or null.
+    QByteArray buffer_;               //!< Read buffer when not mapped.
+    int bufferStart_;                 //!< First unread byte in the buffer.
+    int bufferEnd_;                   //!< End of the valid bytes.
+};
+
+#endif